@@ -0,0 +1,250 @@
+// bcache.c — кэш буферов: хеш по (устройство, блок), LRU, отложенная запись
+#include "bcache.h"
+#include "../malloc/malloc.h"
+#include "../sync/spinlock.h"
+
+extern volatile uint32_t seconds;
+
+/* Все буферы — один массив, данные — одна выровненная по странице область.
+   Свободные от ссылок буферы стоят в LRU; вытесняется голова. Устройства
+   пока синхронные, поэтому чтение и запись идут прямо под замком. */
+static buf_t *bufs = NULL;
+static size_t nbufs = 0;
+static buf_t **hash_head = NULL;
+static size_t hash_mask = 0;
+static buf_t lru = {.prev = &lru, .next = &lru};
+static spinlock_t bcache_lock = SPINLOCK_INIT;
+static bcache_stats_t stats;
+
+static inline size_t buf_hash(const blkdev_t *dev, uint64_t blkno)
+{
+    uint64_t h = (blkno ^ ((uint64_t)(uintptr_t)dev >> 4)) * 0x9E3779B97F4A7C15ULL;
+    return (size_t)(h >> 32) & hash_mask;
+}
+
+static inline void lru_unlink(buf_t *b)
+{
+    b->prev->next = b->next;
+    b->next->prev = b->prev;
+    b->prev = b->next = NULL;
+}
+
+static inline void lru_append(buf_t *b)
+{
+    b->prev = lru.prev;
+    b->next = &lru;
+    lru.prev->next = b;
+    lru.prev = b;
+}
+
+static void hash_remove(buf_t *b)
+{
+    buf_t **link = &hash_head[buf_hash(b->dev, b->blkno)];
+    while (*link && *link != b)
+        link = &(*link)->hnext;
+    if (*link)
+        *link = b->hnext;
+    b->hnext = NULL;
+}
+
+/* Секторы блока; последний блок устройства может быть неполным */
+static inline uint32_t block_sectors(const blkdev_t *dev, uint64_t blkno)
+{
+    uint64_t first = blkno * BCACHE_BLOCK_SECTORS;
+    if (first >= dev->sectors)
+        return 0;
+    uint64_t left = dev->sectors - first;
+    return left < BCACHE_BLOCK_SECTORS ? (uint32_t)left : BCACHE_BLOCK_SECTORS;
+}
+
+static int buf_write(buf_t *b)
+{
+    uint32_t n = block_sectors(b->dev, b->blkno);
+    if (n && b->dev->ops->write(b->dev, b->blkno * BCACHE_BLOCK_SECTORS, n, b->data) != 0)
+        return -1;
+    b->dirty = 0;
+    stats.dirty--;
+    stats.writes++;
+    return 0;
+}
+
+int bcache_init(size_t n)
+{
+    if (bufs || n == 0)
+        return -1;
+    size_t buckets = 1;
+    while (buckets < n)
+        buckets <<= 1;
+
+    buf_t *b = kmalloc_flags(n * sizeof(buf_t), KM_ZERO);
+    uint8_t *data = memalign(BCACHE_BLOCK, n * BCACHE_BLOCK);
+    buf_t **heads = kmalloc_flags(buckets * sizeof(buf_t *), KM_ZERO);
+    if (!b || !data || !heads)
+    {
+        free(b);
+        free(data);
+        free(heads);
+        return -1;
+    }
+
+    bufs = b;
+    nbufs = n;
+    hash_head = heads;
+    hash_mask = buckets - 1;
+    for (size_t i = 0; i < n; ++i)
+    {
+        bufs[i].data = data + i * BCACHE_BLOCK;
+        lru_append(&bufs[i]);
+    }
+    stats.nbufs = (uint32_t)n;
+    return 0;
+}
+
+int bcache_enabled(void)
+{
+    return bufs != NULL;
+}
+
+/* Под замком: найти буфер или занять давно не нужный. Грязный при
+   вытеснении пишется сразу; если запись не удалась — берём следующий. */
+static buf_t *bcache_lookup(blkdev_t *dev, uint64_t blkno)
+{
+    for (buf_t *b = hash_head[buf_hash(dev, blkno)]; b; b = b->hnext)
+    {
+        if (b->dev == dev && b->blkno == blkno)
+        {
+            if (b->refs++ == 0)
+                lru_unlink(b);
+            stats.hits++;
+            return b;
+        }
+    }
+
+    stats.misses++;
+    for (buf_t *b = lru.next; b != &lru; b = b->next)
+    {
+        if (b->dirty)
+        {
+            if (buf_write(b) != 0)
+                continue;
+            stats.evictions++;
+        }
+        lru_unlink(b);
+        if (b->dev)
+            hash_remove(b);
+        b->dev = dev;
+        b->blkno = blkno;
+        b->valid = 0;
+        b->refs = 1;
+        size_t h = buf_hash(dev, blkno);
+        b->hnext = hash_head[h];
+        hash_head[h] = b;
+        return b;
+    }
+    return NULL;
+}
+
+static void bput_locked(buf_t *b)
+{
+    if (--b->refs == 0)
+        lru_append(b);
+}
+
+buf_t *bread(blkdev_t *dev, uint64_t blkno)
+{
+    if (!bufs || !dev)
+        return NULL;
+    unsigned long flags = spin_lock_irqsave(&bcache_lock);
+    buf_t *b = bcache_lookup(dev, blkno);
+    if (b && !b->valid)
+    {
+        uint32_t n = block_sectors(dev, blkno);
+        if (n == 0 || dev->ops->read(dev, blkno * BCACHE_BLOCK_SECTORS, n, b->data) != 0)
+        {
+            bput_locked(b);
+            b = NULL;
+        }
+        else
+        {
+            if (n < BCACHE_BLOCK_SECTORS)
+                memset(b->data + n * BLK_SECTOR_SIZE, 0, (BCACHE_BLOCK_SECTORS - n) * BLK_SECTOR_SIZE);
+            b->valid = 1;
+            stats.reads++;
+        }
+    }
+    spin_unlock_irqrestore(&bcache_lock, flags);
+    return b;
+}
+
+buf_t *bget(blkdev_t *dev, uint64_t blkno)
+{
+    if (!bufs || !dev || block_sectors(dev, blkno) == 0)
+        return NULL;
+    unsigned long flags = spin_lock_irqsave(&bcache_lock);
+    buf_t *b = bcache_lookup(dev, blkno);
+    if (b)
+        b->valid = 1; // содержимое даст вызывающий
+    spin_unlock_irqrestore(&bcache_lock, flags);
+    return b;
+}
+
+void bdirty(buf_t *b)
+{
+    unsigned long flags = spin_lock_irqsave(&bcache_lock);
+    if (!b->dirty)
+    {
+        b->dirty = 1;
+        b->dirtied = seconds;
+        stats.dirty++;
+    }
+    spin_unlock_irqrestore(&bcache_lock, flags);
+}
+
+void brelse(buf_t *b)
+{
+    if (!b)
+        return;
+    unsigned long flags = spin_lock_irqsave(&bcache_lock);
+    bput_locked(b);
+    spin_unlock_irqrestore(&bcache_lock, flags);
+}
+
+int bsync(blkdev_t *dev)
+{
+    int rc = 0;
+    unsigned long flags = spin_lock_irqsave(&bcache_lock);
+    for (size_t i = 0; i < nbufs; ++i)
+        if (bufs[i].dirty && (!dev || bufs[i].dev == dev) && buf_write(&bufs[i]) != 0)
+            rc = -1;
+    spin_unlock_irqrestore(&bcache_lock, flags);
+    return rc;
+}
+
+size_t bcache_writeback(size_t max)
+{
+    size_t done = 0;
+    unsigned long flags = spin_lock_irqsave(&bcache_lock);
+    int pressure = stats.dirty > nbufs / 2;
+    uint32_t now = seconds;
+    for (size_t i = 0; i < nbufs && done < max && stats.dirty; ++i)
+    {
+        buf_t *b = &bufs[i];
+        if (!b->dirty || b->refs)
+            continue;
+        if (!pressure && now - b->dirtied < BCACHE_DIRTY_SECS)
+            continue;
+        if (buf_write(b) == 0)
+            done++;
+    }
+    spin_unlock_irqrestore(&bcache_lock, flags);
+    return done;
+}
+
+void bcache_get_stats(bcache_stats_t *st)
+{
+    if (!st)
+        return;
+    unsigned long flags = spin_lock_irqsave(&bcache_lock);
+    *st = stats;
+    spin_unlock_irqrestore(&bcache_lock, flags);
+}
@@ -0,0 +1,62 @@
+// bcache.h — кэш буферов блочных устройств (write-back)
+#ifndef BCACHE_H
+#define BCACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "blkdev.h"
+
+/* Блок кэша — 4 KiB (8 секторов) для любого устройства: одна страница на
+   буфер, у одного и того же места на диске не бывает двух копий разного размера */
+#define BCACHE_BLOCK 4096
+#define BCACHE_BLOCK_SECTORS (BCACHE_BLOCK / BLK_SECTOR_SIZE)
+#define BCACHE_NBUFS 256      /* 1 MiB */
+#define BCACHE_DIRTY_SECS 2   /* грязный буфер старше — пишет фоновая задача */
+#define BCACHE_FLUSH_BATCH 16 /* буферов за один проход фоновой задачи */
+
+typedef struct buf
+{
+    blkdev_t *dev;
+    uint64_t blkno; /* в блоках BCACHE_BLOCK */
+    uint8_t *data;
+    uint32_t refs;
+    uint8_t valid;
+    uint8_t dirty;
+    uint32_t dirtied; /* секунда, когда буфер стал грязным */
+    struct buf *hnext;
+    struct buf *prev, *next; /* LRU буферов без ссылок: голова — давно не нужный */
+} buf_t;
+
+typedef struct
+{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t reads;     /* блоков прочитано с устройств */
+    uint64_t writes;    /* блоков записано на устройства */
+    uint64_t evictions; /* грязных буферов записано при вытеснении */
+    uint32_t nbufs;
+    uint32_t dirty;
+} bcache_stats_t;
+
+/* Выделить nbufs буферов. 0 — ок */
+int bcache_init(size_t nbufs);
+/* 1 — буферы выделены (bcache_init прошёл) */
+int bcache_enabled(void);
+
+/* Буфер блока с содержимым (со ссылкой) или NULL: ошибка чтения или все
+   буферы заняты. Отпускать через brelse. */
+buf_t *bread(blkdev_t *dev, uint64_t blkno);
+/* То же без чтения с устройства: блок будет перезаписан целиком */
+buf_t *bget(blkdev_t *dev, uint64_t blkno);
+void bdirty(buf_t *b);
+void brelse(buf_t *b);
+
+/* Записать все грязные буферы устройства (NULL — всех). 0 — без ошибок */
+int bsync(blkdev_t *dev);
+/* Шаг фоновой записи: до max буферов, грязных дольше BCACHE_DIRTY_SECS
+   (или любых, если грязных больше половины кэша). Возвращает число записанных */
+size_t bcache_writeback(size_t max);
+
+void bcache_get_stats(bcache_stats_t *st);
+
+#endif // BCACHE_H
@@ -0,0 +1,36 @@
+// blkdev.c — реестр блочных устройств
+#include "blkdev.h"
+#include "../libc/string.h"
+
+static blkdev_t *devices[BLK_MAX_DEVICES];
+
+int blkdev_register(blkdev_t *dev)
+{
+    if (!dev || !dev->ops || !dev->ops->read || !dev->ops->write || blkdev_find(dev->name))
+        return -1;
+    for (int i = 0; i < BLK_MAX_DEVICES; ++i)
+    {
+        if (!devices[i])
+        {
+            devices[i] = dev;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+blkdev_t *blkdev_find(const char *name)
+{
+    for (int i = 0; i < BLK_MAX_DEVICES; ++i)
+        if (devices[i] && strncmp(devices[i]->name, name, BLK_NAME_MAX) == 0)
+            return devices[i];
+    return NULL;
+}
+
+int blkdev_need_cache(void)
+{
+    for (int i = 0; i < BLK_MAX_DEVICES; ++i)
+        if (devices[i] && !devices[i]->ops->map)
+            return 1;
+    return 0;
+}
@@ -0,0 +1,49 @@
+// blkdev.h — блочные устройства: секторы по 512 байт, чтение/запись пачкой
+#ifndef BLKDEV_H
+#define BLKDEV_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define BLK_SECTOR_SIZE 512
+#define BLK_MAX_DEVICES 8
+#define BLK_NAME_MAX 16
+
+typedef struct blkdev blkdev_t;
+
+typedef struct
+{
+    /* 0 — ок, <0 — ошибка устройства */
+    int (*read)(blkdev_t *dev, uint64_t sector, uint32_t count, void *buf);
+    int (*write)(blkdev_t *dev, uint64_t sector, uint32_t count, const void *buf);
+    /* Устройство в памяти (RAM-диск): адрес сектора, всё устройство подряд.
+       NULL в ops — доступ только через read/write и кэш буферов. */
+    void *(*map)(blkdev_t *dev, uint64_t sector);
+} blkdev_ops_t;
+
+struct blkdev
+{
+    char name[BLK_NAME_MAX];
+    uint64_t sectors;
+    const blkdev_ops_t *ops;
+    void *priv;
+};
+
+/* 0 при успехе, -1 — таблица полна или имя занято */
+int blkdev_register(blkdev_t *dev);
+blkdev_t *blkdev_find(const char *name);
+/* 1 — зарегистрировано устройство без map: ему нужен кэш буферов */
+int blkdev_need_cache(void);
+
+/* Адрес начала устройства в памяти или NULL, если оно не отображено */
+static inline uint8_t *blkdev_map(blkdev_t *dev)
+{
+    return (dev && dev->ops->map) ? (uint8_t *)dev->ops->map(dev, 0) : NULL;
+}
+
+static inline uint64_t blkdev_bytes(const blkdev_t *dev)
+{
+    return dev->sectors * BLK_SECTOR_SIZE;
+}
+
+#endif // BLKDEV_H
@@ -0,0 +1,76 @@
+// cpu.c — определение возможностей процессора через CPUID
+#include "cpu.h"
+
+#define CR0_EM (1ULL << 2)
+#define CR0_MP (1ULL << 1)
+#define CR4_OSFXSR (1ULL << 9)
+#define CR4_OSXMMEXCPT (1ULL << 10)
+#define CR4_OSXSAVE (1ULL << 18)
+#define XCR0_SSE_AVX 0x7ULL /* x87 | SSE | AVX */
+
+cpu_features_t cpu_features;
+
+static inline uint64_t xgetbv(uint32_t idx)
+{
+    uint32_t lo, hi;
+    asm volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(idx));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline void xsetbv(uint32_t idx, uint64_t v)
+{
+    asm volatile("xsetbv" ::"c"(idx), "a"((uint32_t)v), "d"((uint32_t)(v >> 32)));
+}
+
+/* SSE без эмуляции x87 и, если есть XSAVE, ymm в XCR0. Состояние FPU при
+   переключении задач не сохраняется: векторный код ядра (libc/string.c)
+   работает короткими участками с запретом прерываний. */
+static void simd_enable(int xsave)
+{
+    uint64_t cr0, cr4;
+    asm volatile("mov %%cr0, %0" : "=r"(cr0));
+    cr0 = (cr0 & ~CR0_EM) | CR0_MP;
+    asm volatile("mov %0, %%cr0" ::"r"(cr0));
+
+    asm volatile("mov %%cr4, %0" : "=r"(cr4));
+    cr4 |= CR4_OSFXSR | CR4_OSXMMEXCPT;
+    if (xsave)
+        cr4 |= CR4_OSXSAVE;
+    asm volatile("mov %0, %%cr4" ::"r"(cr4));
+
+    if (xsave)
+        xsetbv(0, xgetbv(0) | XCR0_SSE_AVX);
+}
+
+void cpu_init(void)
+{
+    uint32_t a, b, c, d;
+
+    cpuid(0, 0, &a, &b, &c, &d);
+    uint32_t max_leaf = a;
+
+    int xsave = 0, avx = 0;
+    if (max_leaf >= 1)
+    {
+        cpuid(1, 0, &a, &b, &c, &d);
+        cpu_features.pge = (d >> 13) & 1;
+        cpu_features.pcid = (c >> 17) & 1;
+        cpu_features.sse2 = (d >> 26) & 1;
+        xsave = (c >> 26) & 1;
+        avx = (c >> 28) & 1;
+    }
+
+    if (max_leaf >= 7)
+    {
+        cpuid(7, 0, &a, &b, &c, &d);
+        cpu_features.invpcid = (b >> 10) & 1;
+        cpu_features.erms = (b >> 9) & 1;
+        cpu_features.fsrm = (d >> 4) & 1;
+        cpu_features.avx2 = (b >> 5) & 1;
+    }
+
+    simd_enable(xsave);
+    /* AVX2 годится, только если XCR0 действительно включил состояние ymm */
+    if (!avx || !xsave || (xgetbv(0) & 0x6) != 0x6)
+        cpu_features.avx2 = 0;
+}
@@ -0,0 +1,38 @@
+#ifndef CPU_H
+#define CPU_H
+
+#include <stdint.h>
+
+/* Возможности CPU, определяемые один раз при загрузке через CPUID */
+typedef struct
+{
+    uint8_t pge;     /* глобальные страницы (CR4.PGE) */
+    uint8_t pcid;    /* process-context identifiers (CR4.PCIDE) */
+    uint8_t invpcid; /* инструкция INVPCID */
+    uint8_t sse2;    /* SSE2 (на x86_64 есть всегда) */
+    uint8_t avx2;    /* AVX2, и ОС сохраняет ymm (XCR0) */
+    uint8_t erms;    /* Enhanced REP MOVSB/STOSB */
+    uint8_t fsrm;    /* Fast Short REP MOVSB */
+} cpu_features_t;
+
+extern cpu_features_t cpu_features;
+
+/* CPUID + включение SSE/AVX (CR0/CR4/XCR0) — до первого вызова string_init */
+void cpu_init(void);
+
+static inline void cpuid(uint32_t leaf, uint32_t subleaf,
+                         uint32_t *a, uint32_t *b, uint32_t *c, uint32_t *d)
+{
+    asm volatile("cpuid"
+                 : "=a"(*a), "=b"(*b), "=c"(*c), "=d"(*d)
+                 : "a"(leaf), "c"(subleaf));
+}
+
+static inline uint64_t rdtsc(void)
+{
+    uint32_t lo, hi;
+    asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+#endif // CPU_H
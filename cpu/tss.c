@@ -0,0 +1,46 @@
+// tss.c — GDT с дескриптором TSS и стеки IST для #PF/#DF
+#include "tss.h"
+
+struct __attribute__((packed)) gdt_ptr
+{
+    uint16_t limit;
+    uint64_t base;
+};
+
+static tss_t tss;
+
+/* Селекторы 0x08..0x20 совпадают с kernel.asm; системный дескриптор TSS
+   в long mode занимает два слота */
+static uint64_t gdt[7] __attribute__((aligned(16))) = {
+    0x0000000000000000ULL, /* Null */
+    0x00AF9A000000FFFFULL, /* 0x08: Kernel Code (L=1, DPL=0) */
+    0x00AF92000000FFFFULL, /* 0x10: Kernel Data */
+    0x00AFFA000000FFFFULL, /* 0x18: User Code (L=1, DPL=3) */
+    0x00AFF2000000FFFFULL, /* 0x20: User Data */
+    0,                     /* 0x28: TSS, младшая половина */
+    0,                     /*       старшие 32 бита базы */
+};
+
+static uint8_t ist_pf_stack[IST_PF_STACK_SIZE] __attribute__((aligned(16)));
+static uint8_t ist_df_stack[IST_DF_STACK_SIZE] __attribute__((aligned(16)));
+
+void tss_init(void)
+{
+    tss.ist[IST_PAGE_FAULT - 1] = (uint64_t)(uintptr_t)(ist_pf_stack + sizeof(ist_pf_stack));
+    tss.ist[IST_DOUBLE_FAULT - 1] = (uint64_t)(uintptr_t)(ist_df_stack + sizeof(ist_df_stack));
+    tss.iomap_base = sizeof(tss); /* карты портов нет */
+
+    uint64_t base = (uint64_t)(uintptr_t)&tss;
+    uint64_t limit = sizeof(tss) - 1;
+    gdt[TSS_SELECTOR / 8] = (limit & 0xFFFF) |
+                            ((base & 0xFFFFFF) << 16) |
+                            (0x89ULL << 40) | /* present, 64-bit TSS (available) */
+                            (((limit >> 16) & 0xF) << 48) |
+                            (((base >> 24) & 0xFF) << 56);
+    gdt[TSS_SELECTOR / 8 + 1] = base >> 32;
+
+    /* Значения селекторов не меняются, поэтому CS/SS перезагружать не нужно */
+    struct gdt_ptr p = {(uint16_t)(sizeof(gdt) - 1), (uint64_t)(uintptr_t)gdt};
+    asm volatile("lgdt %0" ::"m"(p) : "memory");
+    asm volatile("ltr %w0" ::"r"((uint16_t)TSS_SELECTOR));
+}
@@ -0,0 +1,31 @@
+#ifndef TSS_H
+#define TSS_H
+
+#include <stdint.h>
+
+/* GDT ядра с дескриптором TSS. В long mode TSS нужен только ради стеков IST:
+   #PF и #DF переключаются на свой стек, даже если стек задачи кончился. */
+#define TSS_SELECTOR 0x28
+
+#define IST_PAGE_FAULT 1   /* номер в IDT-записи (1..7), 0 — без переключения */
+#define IST_DOUBLE_FAULT 2
+
+#define IST_PF_STACK_SIZE (16 * 1024)
+#define IST_DF_STACK_SIZE (8 * 1024)
+
+/* 64-bit TSS (Intel SDM, том 3, 8.7) */
+typedef struct __attribute__((packed))
+{
+    uint32_t reserved0;
+    uint64_t rsp[3]; /* стеки для перехода из ring 3 в ring 0..2 */
+    uint64_t reserved1;
+    uint64_t ist[7];
+    uint64_t reserved2;
+    uint16_t reserved3;
+    uint16_t iomap_base;
+} tss_t;
+
+/* Перезагрузить GDT (селекторы как в kernel.asm + TSS) и выполнить ltr */
+void tss_init(void);
+
+#endif // TSS_H
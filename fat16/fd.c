@@ -0,0 +1,272 @@
+// fd.c — таблицы дескрипторов задач: open/close/read/write/lseek/ftruncate
+#include "fd.h"
+#include "../multitask/multitask.h"
+#include "../malloc/malloc.h"
+#include "../sync/spinlock.h"
+
+/* Дескриптор — смещение и режим поверх общего fs_file_t. Таблица
+   выделяется при первом open задачи. */
+typedef struct
+{
+    fs_file_t *file; /* NULL — свободен */
+    uint64_t off;
+    int flags;
+} fd_entry_t;
+
+struct fd_table
+{
+    fd_entry_t fds[TASK_MAX_FDS];
+};
+
+/* У ФС своего замка нет: обращения к ней — с запретом прерываний, как и в
+   syscall.c. Большие копии режутся на куски, между ними прерывания открыты. */
+#define FD_IO_CHUNK (64 * 1024)
+
+static fd_entry_t *fd_get(int fd)
+{
+    task_t *t = get_current_task();
+    if (!t || !t->fds || fd < 0 || fd >= TASK_MAX_FDS || !t->fds->fds[fd].file)
+        return NULL;
+    return &t->fds->fds[fd];
+}
+
+/* Следующий компонент пути в name (без '/'), 0 — компонентов больше нет,
+   -1 — слишком длинный */
+static int path_next(const char **p, char *name)
+{
+    const char *s = *p;
+    while (*s == '/')
+        s++;
+    size_t n = 0;
+    while (s[n] && s[n] != '/')
+        n++;
+    if (n == 0)
+        return 0;
+    if (n >= FS_NAME_MAX)
+        return -1;
+    memcpy(name, s, n);
+    name[n] = '\0';
+    *p = s + n;
+    return 1;
+}
+
+/* Найти (или с O_CREAT — создать) файл по пути, вернуть индекс записи */
+static int path_lookup(const char *path, int flags)
+{
+    char name[FS_NAME_MAX];
+    int dir = FS_ROOT_IDX;
+    const char *p = path;
+    int r = path_next(&p, name);
+    if (r <= 0)
+        return -1;
+
+    for (;;)
+    {
+        char next[FS_NAME_MAX];
+        const char *q = p;
+        int more = path_next(&q, next);
+        if (more < 0)
+            return -1;
+        if (!more)
+            break;
+        fs_entry_t e;
+        dir = fs_find_in_dir(name, NULL, dir, &e);
+        if (dir < 0 || !e.is_dir)
+            return -1;
+        memcpy(name, next, FS_NAME_MAX);
+        p = q;
+    }
+
+    /* "prog.bin" -> имя "prog", расширение "bin" */
+    const char *ext = "";
+    char *dot = NULL;
+    for (char *c = name; *c; ++c)
+        if (*c == '.')
+            dot = c;
+    if (dot && dot != name)
+    {
+        *dot = '\0';
+        ext = dot + 1;
+    }
+
+    fs_entry_t e;
+    int idx = fs_find_in_dir(name, ext, dir, &e);
+    if (idx >= 0 && e.is_dir)
+        return -1;
+    if (idx < 0 && (flags & O_CREAT))
+        idx = fs_create_file(name, ext, dir, NULL);
+    return idx;
+}
+
+int fd_open(const char *path, int flags)
+{
+    task_t *t = get_current_task();
+    if (!t || !path)
+        return -1;
+    if (!t->fds)
+    {
+        t->fds = kmalloc_flags(sizeof(struct fd_table), KM_ZERO);
+        if (!t->fds)
+            return -1;
+    }
+
+    int fd = 0;
+    while (fd < TASK_MAX_FDS && t->fds->fds[fd].file)
+        fd++;
+    if (fd == TASK_MAX_FDS)
+        return -1;
+
+    unsigned long irq = local_irq_save();
+    int idx = path_lookup(path, flags);
+    fs_file_t *f = idx >= 0 ? fs_file_open(idx) : NULL;
+    if (f && (flags & O_TRUNC) && (flags & O_ACCMODE) != O_RDONLY && fs_ftruncate(f, 0) != 0)
+    {
+        fs_file_close(f); // запись запрещена (образ запущенной программы)
+        f = NULL;
+    }
+    local_irq_restore(irq);
+    if (!f)
+        return -1;
+
+    t->fds->fds[fd] = (fd_entry_t){f, 0, flags};
+    return fd;
+}
+
+int fd_close(int fd)
+{
+    fd_entry_t *d = fd_get(fd);
+    if (!d)
+        return -1;
+    unsigned long irq = local_irq_save();
+    fs_file_close(d->file);
+    local_irq_restore(irq);
+    d->file = NULL;
+    return 0;
+}
+
+void fd_close_all(task_t *t)
+{
+    if (!t || !t->fds)
+        return;
+    unsigned long irq = local_irq_save();
+    for (int i = 0; i < TASK_MAX_FDS; ++i)
+        if (t->fds->fds[i].file)
+            fs_file_close(t->fds->fds[i].file);
+    local_irq_restore(irq);
+    free(t->fds);
+    t->fds = NULL;
+}
+
+static int64_t io_read(fd_entry_t *d, void *buf, size_t n, uint64_t off)
+{
+    if ((d->flags & O_ACCMODE) == O_WRONLY)
+        return -1;
+    size_t done = 0;
+    while (done < n)
+    {
+        size_t chunk = n - done < FD_IO_CHUNK ? n - done : FD_IO_CHUNK;
+        unsigned long irq = local_irq_save();
+        int64_t r = fs_pread(d->file, (uint8_t *)buf + done, chunk, off + done);
+        local_irq_restore(irq);
+        if (r < 0)
+            return done ? (int64_t)done : -1;
+        done += (size_t)r;
+        if ((size_t)r < chunk)
+            break; // конец файла
+    }
+    return (int64_t)done;
+}
+
+static int64_t io_write(fd_entry_t *d, const void *buf, size_t n, uint64_t off)
+{
+    if ((d->flags & O_ACCMODE) == O_RDONLY)
+        return -1;
+    size_t done = 0;
+    while (done < n)
+    {
+        size_t chunk = n - done < FD_IO_CHUNK ? n - done : FD_IO_CHUNK;
+        unsigned long irq = local_irq_save();
+        int64_t r = fs_pwrite(d->file, (const uint8_t *)buf + done, chunk, off + done);
+        local_irq_restore(irq);
+        if (r < 0)
+            return done ? (int64_t)done : -1;
+        done += (size_t)r;
+        if ((size_t)r < chunk)
+            break; // место кончилось
+    }
+    return (int64_t)done;
+}
+
+int64_t fd_pread(int fd, void *buf, size_t n, uint64_t off)
+{
+    fd_entry_t *d = fd_get(fd);
+    return (d && buf) ? io_read(d, buf, n, off) : -1;
+}
+
+int64_t fd_pwrite(int fd, const void *buf, size_t n, uint64_t off)
+{
+    fd_entry_t *d = fd_get(fd);
+    return (d && buf) ? io_write(d, buf, n, off) : -1;
+}
+
+int64_t fd_read(int fd, void *buf, size_t n)
+{
+    fd_entry_t *d = fd_get(fd);
+    if (!d || !buf)
+        return -1;
+    int64_t r = io_read(d, buf, n, d->off);
+    if (r > 0)
+        d->off += (uint64_t)r;
+    return r;
+}
+
+int64_t fd_write(int fd, const void *buf, size_t n)
+{
+    fd_entry_t *d = fd_get(fd);
+    if (!d || !buf)
+        return -1;
+    if (d->flags & O_APPEND)
+        d->off = fs_file_size(d->file);
+    int64_t r = io_write(d, buf, n, d->off);
+    if (r > 0)
+        d->off += (uint64_t)r;
+    return r;
+}
+
+int64_t fd_lseek(int fd, int64_t off, int whence)
+{
+    fd_entry_t *d = fd_get(fd);
+    if (!d)
+        return -1;
+    int64_t base;
+    switch (whence)
+    {
+    case SEEK_SET:
+        base = 0;
+        break;
+    case SEEK_CUR:
+        base = (int64_t)d->off;
+        break;
+    case SEEK_END:
+        base = (int64_t)fs_file_size(d->file);
+        break;
+    default:
+        return -1;
+    }
+    /* За конец файла можно: запись туда заполнит дыру нулями */
+    if (base + off < 0)
+        return -1;
+    d->off = (uint64_t)(base + off);
+    return (int64_t)d->off;
+}
+
+int fd_ftruncate(int fd, uint64_t len)
+{
+    fd_entry_t *d = fd_get(fd);
+    if (!d || (d->flags & O_ACCMODE) == O_RDONLY)
+        return -1;
+    unsigned long irq = local_irq_save();
+    int r = fs_ftruncate(d->file, len);
+    local_irq_restore(irq);
+    return r;
+}
@@ -0,0 +1,40 @@
+// fd.h — файловые дескрипторы задач поверх fs_file_t
+#ifndef FD_H
+#define FD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "fs.h"
+
+#define TASK_MAX_FDS 16
+
+/* Флаги open (значения как в Linux) */
+#define O_RDONLY 0x0
+#define O_WRONLY 0x1
+#define O_RDWR 0x2
+#define O_ACCMODE 0x3
+#define O_CREAT 0x40
+#define O_TRUNC 0x200
+#define O_APPEND 0x400
+
+#define SEEK_SET 0
+#define SEEK_CUR 1
+#define SEEK_END 2
+
+struct task;
+
+/* Путь от корня: "/bin/prog.bin", "docs/readme.txt". Расширение — после
+   последней точки последнего компонента. Возвращают -1 при ошибке. */
+int fd_open(const char *path, int flags);
+int fd_close(int fd);
+int64_t fd_read(int fd, void *buf, size_t n);
+int64_t fd_write(int fd, const void *buf, size_t n);
+int64_t fd_pread(int fd, void *buf, size_t n, uint64_t off);
+int64_t fd_pwrite(int fd, const void *buf, size_t n, uint64_t off);
+int64_t fd_lseek(int fd, int64_t off, int whence);
+int fd_ftruncate(int fd, uint64_t len);
+
+/* Закрыть всё, что осталось открытым у завершённой задачи */
+void fd_close_all(struct task *t);
+
+#endif // FD_H
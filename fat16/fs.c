@@ -1,74 +1,603 @@
 #include "fs.h"
-#include "../ramdisk/ramdisk.h"
+#include "../block/bcache.h"
+#include "../malloc/malloc.h"
 #include <string.h>
 #include <stdint.h>
 #include <stddef.h>
 
-#define BYTES_PER_SECTOR 512
-#define SECTORS_PER_CLUSTER 1
-#define RESERVED_SECTORS 1
-#define NUM_FATS 2
-#define SECTORS_PER_FAT 32
+#define FS_DIR_OFF BCACHE_BLOCK
+#define FS_DIR_BYTES (FS_MAX_ENTRIES * sizeof(fs_entry_t))
+#define FS_DIR_BLOCKS ((FS_DIR_BYTES + BCACHE_BLOCK - 1) / BCACHE_BLOCK)
 
-#define FAT_ENTRIES (BYTES_PER_SECTOR * SECTORS_PER_FAT)
+/* Раскладка тома (всё блочное устройство) — в fs.h: суперблок, таблица
+   записей, одна FAT, область данных с начала, кратного размеру кластера.
+   FAT16 — до FAT16_MAX_CLUSTERS кластеров, дальше FAT32. */
+#define FAT16_MAX_CLUSTERS 65524u
+#define FAT32_MAX_CLUSTERS 0x0FFFFFF5u
+#define FAT16_EOC 0xFFF8u /* и выше — конец цепочки */
+#define FAT32_EOC 0x0FFFFFF8u
+#define FAT32_MASK 0x0FFFFFFFu /* старшие 4 бита записи FAT32 зарезервированы */
+#define FAT_EOC 0xFFFFFFFFu    /* конец цепочки в коде — независимо от типа FAT */
 
+/* FAT целиком держится в памяти (читается без обращений к устройству),
+   изменённые блоки по BCACHE_BLOCK помечаются и переносятся в кэш буферов
+   в fs_sync. Данные файлов идут через кэш, а у устройства в памяти
+   (RAM-диск) — прямо из него, одним memcpy на серию. */
 typedef struct
 {
-    uint16_t entries[FAT_ENTRIES]; // 0 = свободно, 0xFFFF = EOF, иначе номер следующего кластера
-} fat16_table_t;
+    blkdev_t *dev;
+    uint8_t *direct;       /* начало устройства, если оно отображено, иначе NULL */
+    uint32_t cluster_size;
+    uint32_t cluster_shift;
+    uint8_t fat_type;      /* 16 или 32 */
+    uint32_t clusters_end; /* номера кластеров данных: [2, clusters_end) */
+    uint64_t volume_bytes;
+    uint64_t dir_off;      /* байтовые смещения на устройстве */
+    uint64_t fat_off;
+    uint64_t data_off;     /* кластер 2 */
+    uint8_t *fat;          /* копия FAT в памяти */
+    uint64_t *fat_dirty;   /* блоки кэша с изменённой FAT, от блока fat_off */
+    uint32_t fat_blocks;
+} fs_volume_t;
 
-static fat16_table_t fat;
+static fs_volume_t vol;
 static fs_entry_t entries[FS_MAX_ENTRIES];
+static uint64_t dir_dirty[(FS_DIR_BLOCKS + 63) / 64]; /* блоки таблицы записей, ждущие fs_sync */
 
-static uint16_t alloc_cluster(void);
-static void free_cluster_chain(uint16_t first);
+/* Карта занятости кластеров рядом с FAT: 1 — занят (0 и 1 зарезервированы).
+   Поиск свободного — по 64 кластера за слово с места последнего выделения.
+   Размер — по числу кластеров тома, выделяется при форматировании */
+static uint64_t *fat_bitmap = NULL;
+static uint32_t fat_words = 0;
+static uint32_t fat_free_count = 0;
+static uint32_t fat_hint = 2;     /* next-fit: отсюда начинается поиск */
+static uint32_t entries_used = 0; /* занятые записи, включая корень */
+
+/* Индекс каталогов: хеш (parent, name, ext) -> запись и список детей
+   у каждого каталога. Поиск, проверка дубликата и пустоты — без прохода
+   по всей таблице. -1 — конец цепочки/списка; пустой индекс корректен и
+   до монтирования (0 — тоже индекс записи). */
+#define FS_HASH_BUCKETS (FS_MAX_ENTRIES * 2) /* степень двойки: FS_MAX_ENTRIES — тоже */
+
+static int16_t hash_head[FS_HASH_BUCKETS] = {[0 ... FS_HASH_BUCKETS - 1] = -1};
+static int16_t hash_next[FS_MAX_ENTRIES];
+static uint32_t hash_val[FS_MAX_ENTRIES];
+static int16_t child_head[FS_MAX_ENTRIES] = {[0 ... FS_MAX_ENTRIES - 1] = -1}; /* дети в порядке создания */
+static int16_t child_tail[FS_MAX_ENTRIES] = {[0 ... FS_MAX_ENTRIES - 1] = -1};
+static int16_t sib_next[FS_MAX_ENTRIES];
+static int16_t sib_prev[FS_MAX_ENTRIES];
+static uint16_t child_count[FS_MAX_ENTRIES];
+
+static uint32_t alloc_cluster(void);
+static void free_cluster_chain(uint32_t first);
 static int nameeq(const char *a, const char *b, size_t n);
 static int find_free_entry(void);
 static int has_children(int idx);
+static void file_refresh(int idx);
+static int file_is_open(int idx);
+static int file_write_denied(int idx);
+static void index_insert(int idx);
+static void index_remove(int idx);
+static int fsck_run(int repair, int reindex, fs_fsck_t *out);
+
+/* Смещение кластера на устройстве */
+static inline uint64_t cluster_off(uint32_t cluster)
+{
+    return vol.data_off + ((uint64_t)(cluster - 2) << vol.cluster_shift);
+}
+
+#define IO_READ 0
+#define IO_WRITE 1
+#define IO_ZERO 2
+
+/* [off, off+n) тома: у отображённого устройства — один memcpy/memset,
+   иначе по блокам кэша (целый блок под запись не читается). 0 — ок */
+static int vol_io(uint64_t off, size_t n, void *buf, int op)
+{
+    uint8_t *p = (uint8_t *)buf;
+    if (vol.direct)
+    {
+        if (op == IO_READ)
+            memcpy(p, vol.direct + off, n);
+        else if (op == IO_WRITE)
+            memcpy(vol.direct + off, p, n);
+        else
+            memset(vol.direct + off, 0, n);
+        return 0;
+    }
+    while (n)
+    {
+        uint64_t blk = off / BCACHE_BLOCK;
+        size_t in = (size_t)(off % BCACHE_BLOCK);
+        size_t chunk = BCACHE_BLOCK - in < n ? BCACHE_BLOCK - in : n;
+        buf_t *b = (op != IO_READ && chunk == BCACHE_BLOCK) ? bget(vol.dev, blk) : bread(vol.dev, blk);
+        if (!b)
+            return -1;
+        if (op == IO_READ)
+            memcpy(p, b->data + in, chunk);
+        else if (op == IO_WRITE)
+            memcpy(b->data + in, p, chunk);
+        else
+            memset(b->data + in, 0, chunk);
+        if (op != IO_READ)
+            bdirty(b);
+        brelse(b);
+        if (p)
+            p += chunk;
+        off += chunk;
+        n -= chunk;
+    }
+    return 0;
+}
 
-/* Возвращает указатель на кластер */
-uint8_t *get_cluster(uint16_t cluster)
+/* Следующий кластер цепочки; любой маркер конца — FAT_EOC */
+static inline uint32_t fat_get(uint32_t c)
 {
-    uint8_t *base = ramdisk_base();
-    uint32_t first_data_sector = RESERVED_SECTORS + NUM_FATS * SECTORS_PER_FAT;
-    return base + first_data_sector * BYTES_PER_SECTOR + (cluster - 2) * SECTORS_PER_CLUSTER * BYTES_PER_SECTOR;
+    if (vol.fat_type == 16)
+    {
+        uint32_t v = ((uint16_t *)vol.fat)[c];
+        return v >= FAT16_EOC ? FAT_EOC : v;
+    }
+    uint32_t v = ((uint32_t *)vol.fat)[c] & FAT32_MASK;
+    return v >= FAT32_EOC ? FAT_EOC : v;
 }
 
-/* Найти свободный кластер */
-static uint16_t alloc_cluster(void)
+static inline void fat_set(uint32_t c, uint32_t next)
 {
-    for (uint16_t i = 2; i < FAT_ENTRIES; i++)
+    uint64_t pos;
+    if (vol.fat_type == 16)
+    {
+        ((uint16_t *)vol.fat)[c] = next == FAT_EOC ? 0xFFFF : (uint16_t)next;
+        pos = vol.fat_off + (uint64_t)c * 2;
+    }
+    else
     {
-        if (fat.entries[i] == 0)
+        ((uint32_t *)vol.fat)[c] = next == FAT_EOC ? FAT32_MASK : next;
+        pos = vol.fat_off + (uint64_t)c * 4;
+    }
+    uint32_t blk = (uint32_t)(pos / BCACHE_BLOCK - vol.fat_off / BCACHE_BLOCK);
+    vol.fat_dirty[blk / 64] |= 1ULL << (blk % 64);
+}
+
+/* Запись изменилась: её блоки таблицы уйдут на устройство в fs_sync */
+static inline void entry_dirty(int idx)
+{
+    size_t lo = (size_t)idx * sizeof(fs_entry_t) / BCACHE_BLOCK;
+    size_t hi = ((size_t)idx + 1) * sizeof(fs_entry_t) - 1;
+    for (hi /= BCACHE_BLOCK; lo <= hi; ++lo)
+        dir_dirty[lo / 64] |= 1ULL << (lo % 64);
+}
+
+static inline int cluster_valid(uint32_t c)
+{
+    return c >= 2 && c < vol.clusters_end;
+}
+
+static inline void cluster_mark(uint32_t c)
+{
+    fat_bitmap[c / 64] |= 1ULL << (c % 64);
+    fat_free_count--;
+}
+
+static inline void cluster_clear(uint32_t c)
+{
+    fat_bitmap[c / 64] &= ~(1ULL << (c % 64));
+    fat_free_count++;
+}
+
+/* Первый свободный кластер >= c (без перехода через конец), clusters_end — нет */
+static uint32_t next_free(uint32_t c)
+{
+    uint32_t w = c / 64;
+    if (w >= fat_words)
+        return vol.clusters_end;
+    uint64_t avail = ~fat_bitmap[w] & ~((1ULL << (c % 64)) - 1);
+    while (!avail)
+    {
+        if (++w == fat_words)
+            return vol.clusters_end;
+        avail = ~fat_bitmap[w];
+    }
+    return w * 64 + (uint32_t)__builtin_ctzll(avail);
+}
+
+/* Длина свободной серии с кластера c (c свободен), не больше max */
+static uint32_t free_run_len(uint32_t c, uint32_t max)
+{
+    uint32_t n = 0;
+    while (n < max && c + n < vol.clusters_end)
+    {
+        uint32_t b = (c + n) % 64;
+        uint64_t used = fat_bitmap[(c + n) / 64] >> b;
+        if (used)
         {
-            fat.entries[i] = 0xFFFF; // помечаем как EOF на момент выделения
-            return i;
+            n += (uint32_t)__builtin_ctzll(used);
+            break;
         }
+        n += 64 - b;
     }
-    return 0; // нет места
+    return n < max ? n : max;
+}
+
+/* Выделить серию подряд идущих кластеров под запись want кластеров.
+   Next-fit с подсказки: первая серия длиной want (или хотя бы FS_RUN_GOOD)
+   берётся сразу, иначе — самая длинная за полный проход. Кластеры серии
+   связываются в FAT по порядку, последний — EOF. Возвращает первый кластер
+   (0 — места нет), длину — в *got. */
+#define FS_RUN_GOOD_BYTES (32 * 1024) /* дальше длина серии на скорость почти не влияет */
+
+static uint32_t alloc_run(uint32_t want, uint32_t *got)
+{
+    *got = 0;
+    if (fat_free_count == 0 || want == 0)
+        return 0;
+
+    uint32_t good = FS_RUN_GOOD_BYTES >> vol.cluster_shift;
+    if (good == 0)
+        good = 1;
+    uint32_t enough = want < good ? want : good;
+    uint32_t best = 0, best_len = 0;
+    uint32_t pos = fat_hint;
+    int wrapped = 0;
+    for (;;)
+    {
+        uint32_t c = next_free(pos);
+        if (wrapped && c >= fat_hint)
+            break;
+        if (c >= vol.clusters_end)
+        {
+            if (wrapped)
+                break;
+            wrapped = 1;
+            pos = 2;
+            continue;
+        }
+        uint32_t len = free_run_len(c, want);
+        if (len > best_len)
+        {
+            best = c;
+            best_len = len;
+            if (len >= enough)
+                break;
+        }
+        pos = c + len;
+    }
+
+    for (uint32_t i = 0; i < best_len; ++i)
+    {
+        cluster_mark(best + i);
+        fat_set(best + i, (i + 1 < best_len) ? best + i + 1 : FAT_EOC);
+    }
+    fat_hint = (best + best_len < vol.clusters_end) ? best + best_len : 2;
+    *got = best_len;
+    return best;
+}
+
+/* Один кластер (помечен как EOF) */
+static uint32_t alloc_cluster(void)
+{
+    uint32_t got;
+    return alloc_run(1, &got);
+}
+
+/* Сколько кластеров цепочки с cur идут подряд (cur, cur+1, ...), не больше max */
+static uint32_t chain_run(uint32_t cur, uint32_t max)
+{
+    uint32_t n = 1;
+    while (n < max && fat_get(cur + n - 1) == cur + n)
+        n++;
+    return n;
 }
 
 /* Освободить цепочку кластеров */
-static void free_cluster_chain(uint16_t first)
+static void free_cluster_chain(uint32_t first)
 {
-    if (first < 2 || first >= FAT_ENTRIES)
-        return;
-    uint16_t cur = first;
-    while (cur != 0 && cur < FAT_ENTRIES && fat.entries[cur] != 0)
+    uint32_t cur = first;
+    while (cluster_valid(cur) && fat_get(cur) != 0)
     {
-        uint16_t next = fat.entries[cur];
-        fat.entries[cur] = 0;
-        if (next == 0xFFFF)
+        uint32_t next = fat_get(cur);
+        fat_set(cur, 0);
+        cluster_clear(cur);
+        if (next == FAT_EOC)
             break;
         cur = next;
     }
 }
 
-/* Инициализация FS */
-void fs_init(void)
+/* FNV-1a по имени, расширению (не длиннее хранимых) и родителю */
+static uint32_t entry_hash(const char *name, const char *ext, int parent)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < FS_NAME_MAX - 1 && name[i]; ++i)
+        h = (h ^ (uint8_t)name[i]) * 16777619u;
+    h = (h ^ 0xFF) * 16777619u; /* разделитель: "ab"+"c" != "a"+"bc" */
+    for (size_t i = 0; ext && i < FS_EXT_MAX - 1 && ext[i]; ++i)
+        h = (h ^ (uint8_t)ext[i]) * 16777619u;
+    return (h ^ (uint32_t)parent) * 16777619u;
+}
+
+/* Запись уже заполнена (name, ext, parent): в хеш и в конец списка детей */
+static void index_insert(int idx)
+{
+    fs_entry_t *e = &entries[idx];
+    uint32_t h = entry_hash(e->name, e->ext, e->parent);
+    hash_val[idx] = h;
+    hash_next[idx] = hash_head[h & (FS_HASH_BUCKETS - 1)];
+    hash_head[h & (FS_HASH_BUCKETS - 1)] = (int16_t)idx;
+
+    int p = e->parent;
+    sib_next[idx] = -1;
+    sib_prev[idx] = child_tail[p];
+    if (child_tail[p] >= 0)
+        sib_next[child_tail[p]] = (int16_t)idx;
+    else
+        child_head[p] = (int16_t)idx;
+    child_tail[p] = (int16_t)idx;
+    child_count[p]++;
+    entries_used++;
+    entry_dirty(idx);
+}
+
+static void index_remove(int idx)
+{
+    int16_t *link = &hash_head[hash_val[idx] & (FS_HASH_BUCKETS - 1)];
+    while (*link >= 0 && *link != idx)
+        link = &hash_next[*link];
+    if (*link == idx)
+        *link = hash_next[idx];
+
+    int p = entries[idx].parent;
+    if (sib_prev[idx] >= 0)
+        sib_next[sib_prev[idx]] = sib_next[idx];
+    else
+        child_head[p] = sib_next[idx];
+    if (sib_next[idx] >= 0)
+        sib_prev[sib_next[idx]] = sib_prev[idx];
+    else
+        child_tail[p] = sib_prev[idx];
+    child_count[p]--;
+    entries_used--;
+    entry_dirty(idx);
+}
+
+/* Поиск по индексу. want_dir: 1 — только каталог, 0 — только файл,
+   -1 — любой. Совпадений может быть два (каталог и файл без расширения) —
+   как и прежний проход по таблице, отдаём меньший индекс. */
+static int index_lookup(const char *name, const char *ext, int parent, int want_dir)
+{
+    if (!ext)
+        ext = "";
+    uint32_t h = entry_hash(name, ext, parent);
+    int best = -1;
+    for (int i = hash_head[h & (FS_HASH_BUCKETS - 1)]; i >= 0; i = hash_next[i])
+    {
+        fs_entry_t *e = &entries[i];
+        if (hash_val[i] != h || e->parent != parent)
+            continue;
+        if (want_dir >= 0 && e->is_dir != want_dir)
+            continue;
+        if (nameeq(e->name, name, FS_NAME_MAX) && nameeq(e->ext, ext, FS_EXT_MAX) && (best < 0 || i < best))
+            best = i;
+    }
+    return best;
+}
+
+/* Разметить том: число кластеров — сколько влезает вместе с FAT и
+   выравниванием области данных. 0 при успехе */
+static int volume_layout(fs_volume_t *v, uint64_t size, const fs_geometry_t *geo)
+{
+    uint32_t cs = (geo && geo->cluster_size) ? geo->cluster_size : FS_CLUSTER_DEFAULT;
+    if (cs < FS_CLUSTER_MIN || cs > FS_CLUSTER_MAX || (cs & (cs - 1)))
+        return -1;
+    uint8_t type = geo ? geo->fat_type : 0;
+    if (type != 0 && type != 16 && type != 32)
+        return -1;
+
+    uint64_t fat_off = (FS_DIR_OFF + FS_DIR_BYTES + BCACHE_BLOCK - 1) & ~(uint64_t)(BCACHE_BLOCK - 1);
+    if (size <= fat_off + cs)
+        return -1;
+
+    /* Оценка сверху: каждый кластер стоит cs байт данных и запись FAT */
+    uint64_t n = (size - fat_off) / (cs + (type == 16 ? 2 : 4));
+    if (type == 0)
+        type = n > FAT16_MAX_CLUSTERS ? 32 : 16;
+    uint64_t limit = type == 16 ? FAT16_MAX_CLUSTERS : FAT32_MAX_CLUSTERS;
+    if (n > limit)
+        n = limit;
+
+    uint64_t width = type == 16 ? 2 : 4;
+    uint64_t data_off;
+    for (;; --n)
+    {
+        if (n == 0)
+            return -1;
+        data_off = (fat_off + (n + 2) * width + cs - 1) & ~(uint64_t)(cs - 1);
+        if (data_off + n * cs <= size)
+            break;
+    }
+
+    v->cluster_size = cs;
+    v->cluster_shift = (uint32_t)__builtin_ctz(cs);
+    v->fat_type = type;
+    v->clusters_end = (uint32_t)n + 2;
+    v->volume_bytes = size;
+    v->dir_off = FS_DIR_OFF;
+    v->fat_off = fat_off;
+    v->data_off = data_off;
+    return 0;
+}
+
+static inline size_t fat_bytes(const fs_volume_t *v)
+{
+    return (size_t)v->clusters_end * (v->fat_type == 16 ? 2 : 4);
+}
+
+static uint32_t super_checksum(const fs_super_t *sb)
+{
+    const uint8_t *p = (const uint8_t *)sb;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < offsetof(fs_super_t, checksum); ++i)
+        h = (h ^ p[i]) * 16777619u;
+    return h;
+}
+
+/* Суперблок -> геометрия тома с проверкой, что всё помещается на устройство */
+static int volume_from_super(fs_volume_t *v, const fs_super_t *sb, uint64_t dev_bytes)
+{
+    if (sb->magic != FS_MAGIC || sb->version != FS_VERSION || sb->checksum != super_checksum(sb))
+        return -1;
+    uint32_t cs = sb->cluster_size;
+    if (cs < FS_CLUSTER_MIN || cs > FS_CLUSTER_MAX || (cs & (cs - 1)))
+        return -2;
+    if (sb->fat_type != 16 && sb->fat_type != 32)
+        return -2;
+    if (sb->max_entries != FS_MAX_ENTRIES || sb->entry_size != sizeof(fs_entry_t))
+        return -2;
+    uint64_t limit = sb->fat_type == 16 ? FAT16_MAX_CLUSTERS : FAT32_MAX_CLUSTERS;
+    if (sb->clusters_end < 3 || sb->clusters_end - 2 > limit)
+        return -2;
+
+    v->cluster_size = cs;
+    v->cluster_shift = (uint32_t)__builtin_ctz(cs);
+    v->fat_type = (uint8_t)sb->fat_type;
+    v->clusters_end = sb->clusters_end;
+    v->volume_bytes = sb->volume_bytes;
+    v->dir_off = sb->dir_off;
+    v->fat_off = sb->fat_off;
+    v->data_off = sb->data_off;
+
+    /* Области по порядку, без перекрытий, данные — в пределах устройства */
+    if (v->volume_bytes > dev_bytes || v->dir_off < BLK_SECTOR_SIZE || v->dir_off % BLK_SECTOR_SIZE ||
+        v->dir_off + FS_DIR_BYTES > v->fat_off || v->fat_off + fat_bytes(v) > v->data_off ||
+        v->data_off % cs || v->data_off + ((uint64_t)(v->clusters_end - 2) << v->cluster_shift) > v->volume_bytes)
+        return -2;
+    return 0;
+}
+
+static void super_fill(fs_super_t *sb, const fs_volume_t *v)
+{
+    memset(sb, 0, sizeof(*sb));
+    sb->magic = FS_MAGIC;
+    sb->version = FS_VERSION;
+    sb->volume_bytes = v->volume_bytes;
+    sb->cluster_size = v->cluster_size;
+    sb->fat_type = v->fat_type;
+    sb->clusters_end = v->clusters_end;
+    sb->max_entries = FS_MAX_ENTRIES;
+    sb->entry_size = sizeof(fs_entry_t);
+    sb->dir_off = v->dir_off;
+    sb->fat_off = v->fat_off;
+    sb->data_off = v->data_off;
+    sb->checksum = super_checksum(sb);
+}
+
+/* Помеченные блоки области [off, off+bytes) из копии в памяти mem — в кэш */
+static int sync_region(uint64_t *dirty, uint32_t nblocks, uint64_t off, const uint8_t *mem, size_t bytes)
+{
+    uint64_t first = off / BCACHE_BLOCK;
+    for (uint32_t w = 0; w < (nblocks + 63) / 64; ++w)
+    {
+        while (dirty[w])
+        {
+            uint32_t i = w * 64 + (uint32_t)__builtin_ctzll(dirty[w]);
+            /* Первый и последний блоки области могут быть неполными */
+            uint64_t lo = (first + i) * BCACHE_BLOCK, hi = lo + BCACHE_BLOCK;
+            if (lo < off)
+                lo = off;
+            if (hi > off + bytes)
+                hi = off + bytes;
+            if (lo < hi && vol_io(lo, (size_t)(hi - lo), (void *)(mem + (lo - off)), IO_WRITE) != 0)
+                return -1;
+            dirty[w] &= dirty[w] - 1;
+        }
+    }
+    return 0;
+}
+
+/* Перенести изменённые блоки таблицы записей и FAT в кэш буферов; wait —
+   дождаться записи всех грязных буферов тома на устройство */
+int fs_sync(int wait)
 {
+    if (!vol.dev)
+        return -1;
+    int rc = 0;
+    if (sync_region(dir_dirty, FS_DIR_BLOCKS, vol.dir_off, (const uint8_t *)entries, FS_DIR_BYTES) != 0)
+        rc = -1;
+    if (sync_region(vol.fat_dirty, vol.fat_blocks, vol.fat_off, vol.fat, fat_bytes(&vol)) != 0)
+        rc = -1;
+    if (wait && !vol.direct && bsync(vol.dev) != 0)
+        rc = -1;
+    return rc;
+}
+
+static void index_reset(void)
+{
+    memset(hash_head, 0xFF, sizeof(hash_head));
+    memset(child_head, 0xFF, sizeof(child_head));
+    memset(child_tail, 0xFF, sizeof(child_tail));
+    memset(child_count, 0, sizeof(child_count));
+    entries_used = 1; // корень
+}
+
+/* Память под FAT, её грязные блоки и карту занятости — под геометрию nv.
+   Старые буферы освобождаются, nv становится текущим томом */
+static int volume_attach(fs_volume_t *nv, blkdev_t *dev)
+{
+    nv->fat_blocks = (uint32_t)((nv->fat_off + fat_bytes(nv) - 1) / BCACHE_BLOCK - nv->fat_off / BCACHE_BLOCK + 1);
+    uint32_t words = (nv->clusters_end + 63) / 64;
+    size_t dirty_bytes = (size_t)((nv->fat_blocks + 63) / 64) * sizeof(uint64_t);
+    uint64_t *bm = malloc((size_t)words * sizeof(uint64_t));
+    nv->fat = malloc(fat_bytes(nv));
+    nv->fat_dirty = malloc(dirty_bytes);
+    if (!bm || !nv->fat || !nv->fat_dirty)
+    {
+        free(bm);
+        free(nv->fat);
+        free(nv->fat_dirty);
+        return -1;
+    }
+    free(fat_bitmap);
+    free(vol.fat);
+    free(vol.fat_dirty);
+    fat_bitmap = bm;
+    fat_words = words;
+    memset(fat_bitmap, 0, (size_t)words * sizeof(uint64_t));
+    memset(nv->fat_dirty, 0, dirty_bytes);
+    memset(dir_dirty, 0, sizeof(dir_dirty));
+    nv->dev = dev;
+    nv->direct = blkdev_map(dev);
+    vol = *nv;
+    return 0;
+}
+
+/* Карта занятости по FAT: кластеры 0 и 1 и хвост за концом тома заняты */
+static void bitmap_rebuild(void)
+{
+    memset(fat_bitmap, 0, (size_t)fat_words * sizeof(uint64_t));
+    fat_bitmap[0] = 0x3;
+    if (vol.clusters_end % 64)
+        fat_bitmap[fat_words - 1] |= ~0ULL << (vol.clusters_end % 64);
+    fat_free_count = vol.clusters_end - 2;
+    for (uint32_t c = 2; c < vol.clusters_end; ++c)
+        if (fat_get(c) != 0)
+            cluster_mark(c);
+    fat_hint = 2;
+}
+
+int fs_format(blkdev_t *dev, const fs_geometry_t *geo)
+{
+    if (!dev)
+        return -1;
+    fs_volume_t nv = {0};
+    if (volume_layout(&nv, blkdev_bytes(dev), geo) != 0)
+        return -1;
+    if (volume_attach(&nv, dev) != 0)
+        return -2;
+
     memset(entries, 0, sizeof(entries));
-    memset(&fat, 0, sizeof(fat));
+    memset(vol.fat, 0, fat_bytes(&vol));
+    index_reset();
+    bitmap_rebuild();
 
     /* Создадим запись корня */
     entries[FS_ROOT_IDX].used = 1;
@@ -76,9 +605,58 @@ void fs_init(void)
     entries[FS_ROOT_IDX].parent = -1;
     strncpy(entries[FS_ROOT_IDX].name, "/", FS_NAME_MAX - 1);
     entries[FS_ROOT_IDX].name[FS_NAME_MAX - 1] = '\0';
-    entries[FS_ROOT_IDX].ext[0] = '\0';
-    entries[FS_ROOT_IDX].first_cluster = 0;
-    entries[FS_ROOT_IDX].size = 0;
+
+    /* Суперблок, пустые таблица и FAT — на устройство целиком */
+    uint8_t sector[BLK_SECTOR_SIZE] = {0};
+    super_fill((fs_super_t *)sector, &vol);
+    if (vol_io(0, sizeof(sector), sector, IO_WRITE) != 0)
+        return -3;
+    memset(dir_dirty, 0xFF, sizeof(dir_dirty));
+    memset(vol.fat_dirty, 0xFF, (size_t)((vol.fat_blocks + 63) / 64) * sizeof(uint64_t));
+    return fs_sync(0) == 0 ? 0 : -3;
+}
+
+int fs_mount(blkdev_t *dev, int repair, fs_fsck_t *report)
+{
+    if (!dev)
+        return -1;
+    /* Суперблок читаем через временный том: vol_io знает только текущий */
+    fs_volume_t saved = vol;
+    vol.dev = dev;
+    vol.direct = blkdev_map(dev);
+    uint8_t sector[BLK_SECTOR_SIZE];
+    fs_volume_t nv = {0};
+    int rc = vol_io(0, sizeof(sector), sector, IO_READ);
+    if (rc == 0)
+        rc = volume_from_super(&nv, (const fs_super_t *)sector, blkdev_bytes(dev));
+    vol = saved;
+    if (rc != 0)
+        return -1;
+    if (volume_attach(&nv, dev) != 0)
+        return -2;
+
+    if (vol_io(vol.dir_off, FS_DIR_BYTES, entries, IO_READ) != 0 ||
+        vol_io(vol.fat_off, fat_bytes(&vol), vol.fat, IO_READ) != 0)
+    {
+        /* Том наполовину прочитан — не оставлять его текущим */
+        memset(entries, 0, sizeof(entries));
+        index_reset();
+        vol.dev = NULL;
+        return -3;
+    }
+
+    /* Индексы и карту занятости строит проверка; исправления помечены
+       грязными и уйдут на устройство с ближайшим fs_sync */
+    memset(dir_dirty, 0, sizeof(dir_dirty));
+    return fsck_run(repair, 1, report);
+}
+
+/* Инициализация FS: том с устройства или, если его там нет, пустой том на
+   всё устройство с геометрией по умолчанию */
+void fs_init(blkdev_t *dev)
+{
+    if (fs_mount(dev, 1, NULL) < 0)
+        fs_format(dev, NULL);
 }
 
 /* Найти свободную запись в таблице */
@@ -97,26 +675,13 @@ static int has_children(int idx)
 {
     if (idx < 0 || idx >= FS_MAX_ENTRIES)
         return 0;
-    for (int i = 0; i < FS_MAX_ENTRIES; ++i)
-    {
-        if (entries[i].used && entries[i].parent == idx)
-            return 1;
-    }
-    return 0;
+    return child_count[idx] != 0;
 }
 
 /* Сравнение имён (безопасно до n символов) */
 static int nameeq(const char *a, const char *b, size_t n)
 {
-    for (size_t i = 0; i < n; ++i)
-    {
-        char ca = a[i], cb = b[i];
-        if (!ca && !cb)
-            return 1;
-        if (ca != cb)
-            return 0;
-    }
-    return 1;
+    return strncmp(a, b, n) == 0;
 }
 
 /* Создать директорию */
@@ -127,12 +692,8 @@ int fs_mkdir(const char *name, int parent)
     if (!entries[parent].used || !entries[parent].is_dir)
         return -2; // родитель не существует или не каталог
 
-    // Проверим дубликат
-    for (int i = 0; i < FS_MAX_ENTRIES; ++i)
-    {
-        if (entries[i].used && entries[i].parent == parent && entries[i].is_dir && nameeq(entries[i].name, name, FS_NAME_MAX))
-            return -3; // уже существует
-    }
+    if (index_lookup(name, "", parent, 1) >= 0)
+        return -3; // уже существует
 
     int idx = find_free_entry();
     if (idx < 0)
@@ -147,6 +708,7 @@ int fs_mkdir(const char *name, int parent)
     entries[idx].used = 1;
     entries[idx].first_cluster = 0;
     entries[idx].size = 0;
+    index_insert(idx);
     return idx;
 }
 
@@ -159,30 +721,27 @@ int fs_rmdir(int dir_idx)
         return -2; // не существует или не директория
     if (has_children(dir_idx))
         return -3; // директория не пуста
+    index_remove(dir_idx);
     entries[dir_idx].used = 0;
     return 0;
 }
 
 /* Создать файл в каталоге parent */
-int fs_create_file(const char *name, const char *ext, int parent, uint16_t *out_cluster)
+int fs_create_file(const char *name, const char *ext, int parent, uint32_t *out_cluster)
 {
     if (!name || parent < 0 || parent >= FS_MAX_ENTRIES)
         return -1;
     if (!entries[parent].used || !entries[parent].is_dir)
         return -2;
 
-    // Проверим дубликат
-    for (int i = 0; i < FS_MAX_ENTRIES; ++i)
-    {
-        if (entries[i].used && entries[i].parent == parent && !entries[i].is_dir && nameeq(entries[i].name, name, FS_NAME_MAX) && nameeq(entries[i].ext, ext, FS_EXT_MAX))
-            return -3; // уже существует
-    }
+    if (index_lookup(name, ext, parent, 0) >= 0)
+        return -3; // уже существует
 
     int idx = find_free_entry();
     if (idx < 0)
         return -4; // нет места
 
-    uint16_t c = alloc_cluster();
+    uint32_t c = alloc_cluster();
     if (c == 0)
         return -5; // нет места в FAT
 
@@ -197,7 +756,7 @@ int fs_create_file(const char *name, const char *ext, int parent, uint16_t *out_
     entries[idx].used = 1;
     entries[idx].first_cluster = c;
     entries[idx].size = 0;
-    fat.entries[c] = 0xFFFF; // пометить EOF до записи
+    index_insert(idx);
     if (out_cluster)
         *out_cluster = c;
     return idx;
@@ -214,152 +773,152 @@ int fs_remove_entry(int idx)
     {
         if (has_children(idx))
             return -3; // не пустая
+        index_remove(idx);
         entries[idx].used = 0;
         return 0;
     }
     else
     {
-        uint16_t first = entries[idx].first_cluster;
-        free_cluster_chain(first);
+        if (file_is_open(idx))
+            return -4; // открыт через дескриптор
+        free_cluster_chain(entries[idx].first_cluster);
+        index_remove(idx);
         entries[idx].used = 0;
         return 0;
     }
 }
 
-/* Найти запись по имени/ext в каталоге parent */
+/* Найти запись по имени/ext в каталоге parent. С непустым ext — только
+   файл, иначе каталог или файл без расширения */
 int fs_find_in_dir(const char *name, const char *ext, int parent, fs_entry_t *out)
 {
     if (!name || parent < 0 || parent >= FS_MAX_ENTRIES)
         return -1;
-    for (int i = 0; i < FS_MAX_ENTRIES; ++i)
-    {
-        if (entries[i].used && entries[i].parent == parent)
-        {
-            if (entries[i].is_dir)
-            {
-                if (ext && ext[0] != '\0')
-                    continue; // искали файл, а это директория
-                if (nameeq(entries[i].name, name, FS_NAME_MAX))
-                {
-                    if (out)
-                        *out = entries[i];
-                    return i;
-                }
-            }
-            else
-            {
-                if (nameeq(entries[i].name, name, FS_NAME_MAX) && nameeq(entries[i].ext, ext ? ext : "", FS_EXT_MAX))
-                {
-                    if (out)
-                        *out = entries[i];
-                    return i;
-                }
-            }
-        }
-    }
-    return -1;
+    int i = index_lookup(name, ext, parent, (ext && ext[0] != '\0') ? 0 : -1);
+    if (i >= 0 && out)
+        *out = entries[i];
+    return i;
+}
+
+/* Запись по индексу таблицы (для обхода всего тома) */
+int fs_get_entry(int idx, fs_entry_t *out)
+{
+    if (idx < 0 || idx >= FS_MAX_ENTRIES || !entries[idx].used)
+        return -1;
+    if (out)
+        *out = entries[idx];
+    return 0;
 }
 
-/* Получить список файлов/директорий в каталоге parent */
+/* Получить список файлов/директорий в каталоге parent (в порядке создания) */
 int fs_get_all_in_dir(fs_entry_t *out_files, int max_files, int parent)
 {
     int count = 0;
     if (parent < 0 || parent >= FS_MAX_ENTRIES)
         return 0;
 
-    for (int i = 0; i < FS_MAX_ENTRIES && count < max_files; ++i)
+    for (int i = child_head[parent]; i >= 0 && count < max_files; i = sib_next[i])
     {
-        if (entries[i].used && entries[i].parent == parent)
-        {
-            out_files[count] = entries[i]; // копируем запись
+        out_files[count] = entries[i]; // копируем запись
 
-            // Для директорий добавляем '/' только в копии
-            if (out_files[count].is_dir)
+        // Для директорий добавляем '/' только в копии
+        if (out_files[count].is_dir)
+        {
+            size_t len = strlen(out_files[count].name);
+            if (len < FS_NAME_MAX - 1)
             {
-                size_t len = strlen(out_files[count].name);
-                if (len < FS_NAME_MAX - 1)
-                {
-                    out_files[count].name[len] = '/';
-                    out_files[count].name[len + 1] = '\0';
-                }
+                out_files[count].name[len] = '/';
+                out_files[count].name[len + 1] = '\0';
             }
-
-            count++;
         }
+
+        count++;
     }
     return count;
 }
 
+void fs_statfs(fs_statfs_t *st)
+{
+    if (!st)
+        return;
+    st->cluster_size = vol.cluster_size;
+    st->total_clusters = vol.dev ? vol.clusters_end - 2 : 0; // тома нет — пусто
+    st->free_clusters = fat_free_count;
+    st->max_entries = FS_MAX_ENTRIES;
+    st->used_entries = entries_used;
+    st->fat_type = vol.fat_type;
+}
+
 /* НИЗКОУРОВНЕВЫЕ ЧТЕНИЕ/ЗАПИСЬ*/
-size_t fs_read(uint16_t first_cluster, void *buf, size_t size)
+/* Подряд идущие кластеры цепочки копируются одним memcpy */
+size_t fs_read(uint32_t first_cluster, void *buf, size_t size)
 {
-    if (first_cluster < 2 || first_cluster >= FAT_ENTRIES)
+    if (!cluster_valid(first_cluster))
         return 0;
-    size_t cluster_size = BYTES_PER_SECTOR * SECTORS_PER_CLUSTER;
-    uint16_t cur = first_cluster;
+    size_t cluster_size = vol.cluster_size;
+    uint32_t cur = first_cluster;
     size_t read = 0;
     uint8_t *out = (uint8_t *)buf;
 
-    while (cur != 0 && cur < FAT_ENTRIES && read < size)
+    while (cluster_valid(cur) && read < size)
     {
-        uint8_t *clptr = get_cluster(cur);
+        uint32_t need = (uint32_t)((size - read + cluster_size - 1) / cluster_size);
+        uint32_t run = chain_run(cur, need);
         size_t to_copy = size - read;
-        if (to_copy > cluster_size)
-            to_copy = cluster_size;
-        memcpy(out + read, clptr, to_copy);
+        if (to_copy > run * cluster_size)
+            to_copy = run * cluster_size;
+        if (vol_io(cluster_off(cur), to_copy, out + read, IO_READ) != 0)
+            break;
         read += to_copy;
 
-        if (fat.entries[cur] == 0xFFFF)
-            break;
-        cur = fat.entries[cur];
+        cur = fat_get(cur + run - 1);
     }
 
     return read;
 }
 
-size_t fs_write(uint16_t first_cluster, const void *buf, size_t size)
+/* Пишет поверх цепочки, продлевая её сериями под остаток записи; лишний
+   хвост прежней цепочки освобождается */
+size_t fs_write(uint32_t first_cluster, const void *buf, size_t size)
 {
-    uint8_t *data = (uint8_t *)buf;
-    size_t cluster_size = BYTES_PER_SECTOR * SECTORS_PER_CLUSTER;
+    const uint8_t *data = (const uint8_t *)buf;
+    size_t cluster_size = vol.cluster_size;
 
-    if (first_cluster < 2 || first_cluster >= FAT_ENTRIES)
+    if (!cluster_valid(first_cluster))
         return 0;
 
-    uint16_t cur = first_cluster;
+    uint32_t cur = first_cluster;
     size_t written = 0;
 
     while (written < size)
     {
-        uint8_t *clptr = get_cluster(cur);
+        uint32_t need = (uint32_t)((size - written + cluster_size - 1) / cluster_size);
+        uint32_t run = chain_run(cur, need);
         size_t to_write = size - written;
-        if (to_write > cluster_size)
-            to_write = cluster_size;
-        memcpy(clptr, data + written, to_write);
+        if (to_write > run * cluster_size)
+            to_write = run * cluster_size;
+        if (vol_io(cluster_off(cur), to_write, (void *)(data + written), IO_WRITE) != 0)
+            return written;
         written += to_write;
 
-        if (written < size)
+        uint32_t last = cur + run - 1;
+        uint32_t next = fat_get(last);
+        if (written >= size)
         {
-            if (fat.entries[cur] == 0xFFFF)
-            {
-                uint16_t nc = alloc_cluster();
-                if (nc == 0)
-                {
-                    fat.entries[cur] = 0xFFFF;
-                    return written;
-                }
-                fat.entries[cur] = nc;
-                cur = nc;
-            }
-            else
-            {
-                cur = fat.entries[cur];
-            }
+            fat_set(last, FAT_EOC);
+            if (next != FAT_EOC)
+                free_cluster_chain(next);
+            break;
         }
-        else
+        if (next == FAT_EOC)
         {
-            fat.entries[cur] = 0xFFFF;
-            break;
+            uint32_t got;
+            next = alloc_run(need - run, &got);
+            if (next == 0)
+                return written;
+            fat_set(last, next);
         }
+        cur = next;
     }
 
     return written;
@@ -377,7 +936,9 @@ int fs_write_file_in_dir(const char *name, const char *ext, int parent, const vo
 
     fs_entry_t f;
     int idx = fs_find_in_dir(name, ext, parent, &f);
-    uint16_t cluster;
+    uint32_t cluster;
+    if (idx >= 0 && file_write_denied(idx))
+        return -7; // файл — образ запущенной программы
 
     if (idx < 0)
     {
@@ -388,24 +949,32 @@ int fs_write_file_in_dir(const char *name, const char *ext, int parent, const vo
     }
     else
     {
-        // файл уже есть — освобождаем старую цепочку и выделяем новый кластер стартовый
-        uint16_t old = entries[idx].first_cluster;
-        free_cluster_chain(old);
-        cluster = alloc_cluster();
-        if (cluster == 0)
+        // файл уже есть — сначала серия под весь размер, потом освобождаем
+        // старую цепочку: при ошибке запись и дескрипторы не смотрят в пустоту
+        uint32_t old = entries[idx].first_cluster;
+        uint32_t want = (uint32_t)((size + vol.cluster_size - 1) >> vol.cluster_shift);
+        uint32_t got;
+        cluster = alloc_run(want ? want : 1, &got);
+        if (cluster != 0)
+            free_cluster_chain(old);
+        else if (cluster_valid(old))
+            cluster = old; // свободных нет — fs_write пишет поверх старой цепочки
+        else
             return -5; // нет места
         entries[idx].first_cluster = cluster;
-        fat.entries[cluster] = 0xFFFF;
     }
+    entry_dirty(idx);
 
     if (size == 0)
     {
         entries[idx].size = 0;
-        fat.entries[entries[idx].first_cluster] = 0xFFFF;
+        fat_set(entries[idx].first_cluster, FAT_EOC);
+        file_refresh(idx);
         return 0;
     }
 
     size_t written = fs_write(entries[idx].first_cluster, data, size);
+    file_refresh(idx); // цепочка новая — кэш серий открытых дескрипторов устарел
     if (written != size)
     {
         entries[idx].size = (uint32_t)written;
@@ -428,3 +997,614 @@ int fs_read_file_in_dir(const char *name, const char *ext, int parent, void *buf
         *out_size = r;
     return 0;
 }
+
+/* ==================== открытые файлы ==================== */
+/* Один объект на запись, общий для всех дескрипторов: цепочка кластеров
+   разобрана в список серий (file_cl — номер кластера внутри файла), так что
+   доступ по смещению не ходит по FAT. */
+
+typedef struct
+{
+    uint32_t file_cl; /* первый кластер серии — по счёту внутри файла */
+    uint32_t start;   /* номер кластера на диске */
+    uint32_t len;
+} fs_run_t;
+
+struct fs_file
+{
+    int idx; /* запись каталога, -1 — слот свободен */
+    int refs;
+    fs_run_t *runs;
+    uint32_t nruns;
+    uint32_t cap;
+    uint32_t hint; /* серия последнего обращения: последовательный доступ — O(1) */
+    int deny_write; /* образ запущенных программ: содержимое отображено в задачи */
+};
+
+static fs_file_t open_files[FS_MAX_OPEN] = {[0 ... FS_MAX_OPEN - 1] = {.idx = -1}};
+
+#define CLUSTER_BYTES ((uint64_t)vol.cluster_size)
+
+static int file_is_open(int idx)
+{
+    for (int i = 0; i < FS_MAX_OPEN; ++i)
+        if (open_files[i].idx == idx)
+            return 1;
+    return 0;
+}
+
+static int file_write_denied(int idx)
+{
+    for (int i = 0; i < FS_MAX_OPEN; ++i)
+        if (open_files[i].idx == idx)
+            return open_files[i].deny_write > 0;
+    return 0;
+}
+
+static int runs_push(fs_file_t *f, uint32_t cl)
+{
+    if (f->nruns)
+    {
+        fs_run_t *r = &f->runs[f->nruns - 1];
+        if (cl == r->start + r->len)
+        {
+            r->len++;
+            return 0;
+        }
+    }
+    if (f->nruns == f->cap)
+    {
+        uint32_t cap = f->cap ? f->cap * 2 : 4;
+        fs_run_t *nr = realloc(f->runs, cap * sizeof(fs_run_t));
+        if (!nr)
+            return -1;
+        f->runs = nr;
+        f->cap = cap;
+    }
+    uint32_t file_cl = f->nruns ? f->runs[f->nruns - 1].file_cl + f->runs[f->nruns - 1].len : 0;
+    f->runs[f->nruns++] = (fs_run_t){file_cl, cl, 1};
+    return 0;
+}
+
+/* Разобрать цепочку записи в список серий */
+static int runs_build(fs_file_t *f)
+{
+    f->nruns = 0;
+    f->hint = 0;
+    uint32_t cur = entries[f->idx].first_cluster;
+    for (uint32_t steps = 0; cluster_valid(cur) && steps < vol.clusters_end; ++steps)
+    {
+        if (runs_push(f, cur) != 0)
+            return -1;
+        cur = fat_get(cur);
+    }
+    return 0;
+}
+
+static void file_refresh(int idx)
+{
+    for (int i = 0; i < FS_MAX_OPEN; ++i)
+        if (open_files[i].idx == idx)
+            runs_build(&open_files[i]);
+}
+
+static inline uint32_t file_clusters(const fs_file_t *f)
+{
+    return f->nruns ? f->runs[f->nruns - 1].file_cl + f->runs[f->nruns - 1].len : 0;
+}
+
+/* Серия, содержащая кластер файла file_cl (он должен существовать) */
+static fs_run_t *run_find(fs_file_t *f, uint32_t file_cl)
+{
+    fs_run_t *r = &f->runs[f->hint];
+    if (file_cl >= r->file_cl && file_cl < r->file_cl + r->len)
+        return r;
+    if (f->hint + 1 < f->nruns && file_cl >= r[1].file_cl && file_cl < r[1].file_cl + r[1].len)
+    {
+        f->hint++;
+        return r + 1;
+    }
+    uint32_t lo = 0, hi = f->nruns;
+    while (hi - lo > 1)
+    {
+        uint32_t mid = (lo + hi) / 2;
+        if (f->runs[mid].file_cl <= file_cl)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    f->hint = lo;
+    return &f->runs[lo];
+}
+
+/* Дорастить цепочку до clusters кластеров сериями под весь недостающий объём */
+static int file_grow(fs_file_t *f, uint32_t clusters)
+{
+    uint32_t have = file_clusters(f);
+    while (have < clusters)
+    {
+        uint32_t got;
+        uint32_t c = alloc_run(clusters - have, &got);
+        if (c == 0)
+            return -1;
+        fs_run_t *last = &f->runs[f->nruns - 1];
+        fat_set(last->start + last->len - 1, c);
+        for (uint32_t i = 0; i < got; ++i)
+        {
+            if (runs_push(f, c + i) != 0)
+            {
+                runs_build(f); // FAT уже связана — пересобрать, что успели
+                return -1;
+            }
+        }
+        have += got;
+    }
+    return 0;
+}
+
+/* Копирование [off, off+n) по сериям: одна серия — один vol_io. 0 — ок */
+static int file_io(fs_file_t *f, uint64_t off, size_t n, void *buf, int op)
+{
+    uint8_t *p = (uint8_t *)buf;
+    while (n)
+    {
+        uint32_t file_cl = (uint32_t)(off >> vol.cluster_shift);
+        fs_run_t *r = run_find(f, file_cl);
+        uint64_t run_end = (uint64_t)(r->file_cl + r->len) * CLUSTER_BYTES;
+        size_t chunk = (run_end - off < n) ? (size_t)(run_end - off) : n;
+        uint64_t disk = cluster_off(r->start + (file_cl - r->file_cl)) + (off & (CLUSTER_BYTES - 1));
+        if (vol_io(disk, chunk, p, op) != 0)
+            return -1;
+        if (p)
+            p += chunk;
+        off += chunk;
+        n -= chunk;
+    }
+    return 0;
+}
+
+fs_file_t *fs_file_open(int idx)
+{
+    if (idx <= 0 || idx >= FS_MAX_ENTRIES || !entries[idx].used || entries[idx].is_dir)
+        return NULL;
+
+    fs_file_t *free_slot = NULL;
+    for (int i = 0; i < FS_MAX_OPEN; ++i)
+    {
+        if (open_files[i].idx == idx)
+        {
+            open_files[i].refs++;
+            return &open_files[i];
+        }
+        if (open_files[i].idx < 0 && !free_slot)
+            free_slot = &open_files[i];
+    }
+    if (!free_slot)
+        return NULL;
+
+    free_slot->idx = idx;
+    free_slot->refs = 1;
+    if (runs_build(free_slot) != 0 || free_slot->nruns == 0)
+    {
+        free(free_slot->runs);
+        *free_slot = (fs_file_t){.idx = -1};
+        return NULL;
+    }
+    return free_slot;
+}
+
+void fs_file_close(fs_file_t *f)
+{
+    if (!f || f->idx < 0 || --f->refs > 0)
+        return;
+    free(f->runs);
+    *f = (fs_file_t){.idx = -1};
+}
+
+const void *fs_file_data(fs_file_t *f)
+{
+    if (!f || f->idx < 0 || f->nruns != 1)
+        return NULL;
+    if (!vol.direct)
+        return NULL; // содержимое только в кэше буферов
+    return vol.direct + cluster_off(f->runs[0].start);
+}
+
+void fs_file_deny_write(fs_file_t *f)
+{
+    if (f)
+        f->deny_write++;
+}
+
+void fs_file_allow_write(fs_file_t *f)
+{
+    if (f && f->deny_write > 0)
+        f->deny_write--;
+}
+
+int fs_file_index(const fs_file_t *f)
+{
+    return f ? f->idx : -1;
+}
+
+uint32_t fs_file_size(const fs_file_t *f)
+{
+    return f ? entries[f->idx].size : 0;
+}
+
+int64_t fs_pread(fs_file_t *f, void *buf, size_t n, uint64_t off)
+{
+    if (!f || f->idx < 0)
+        return -1;
+    uint32_t size = entries[f->idx].size;
+    if (off >= size)
+        return 0;
+    if (n > size - off)
+        n = (size_t)(size - off);
+    if (file_io(f, off, n, buf, IO_READ) != 0)
+        return -1;
+    return (int64_t)n;
+}
+
+/* Запись с любого смещения: цепочка растёт сериями, дыра между старым
+   концом и off заполняется нулями. Если места хватило не на всё —
+   пишется, сколько влезло. */
+int64_t fs_pwrite(fs_file_t *f, const void *buf, size_t n, uint64_t off)
+{
+    if (!f || f->idx < 0 || f->deny_write)
+        return -1;
+    if (n == 0)
+        return 0;
+    if (off >= FS_FILE_MAX)
+        return -1;
+    if (n > FS_FILE_MAX - off)
+        n = (size_t)(FS_FILE_MAX - off);
+
+    uint64_t end = off + n;
+    uint32_t need = (uint32_t)((end + CLUSTER_BYTES - 1) / CLUSTER_BYTES);
+    if (file_grow(f, need) != 0)
+    {
+        uint64_t cap = (uint64_t)file_clusters(f) * CLUSTER_BYTES;
+        if (cap <= off)
+            return -1; // нет места
+        end = cap;
+        n = (size_t)(end - off);
+    }
+
+    fs_entry_t *e = &entries[f->idx];
+    if (off > e->size)
+        if (file_io(f, e->size, (size_t)(off - e->size), NULL, IO_ZERO) != 0)
+            return -1;
+    if (file_io(f, off, n, (void *)buf, IO_WRITE) != 0)
+        return -1;
+    if (end > e->size)
+    {
+        e->size = (uint32_t)end;
+        entry_dirty(f->idx);
+    }
+    return (int64_t)n;
+}
+
+/* Обрезать или дорастить (нулями) до len. Первый кластер остаётся всегда */
+int fs_ftruncate(fs_file_t *f, uint64_t len)
+{
+    if (!f || f->idx < 0 || f->deny_write || len > FS_FILE_MAX)
+        return -1;
+    fs_entry_t *e = &entries[f->idx];
+
+    if (len > e->size)
+    {
+        uint32_t need = (uint32_t)((len + CLUSTER_BYTES - 1) / CLUSTER_BYTES);
+        if (file_grow(f, need) != 0)
+            return -1;
+        if (file_io(f, e->size, (size_t)(len - e->size), NULL, IO_ZERO) != 0)
+            return -1;
+        e->size = (uint32_t)len;
+        entry_dirty(f->idx);
+        return 0;
+    }
+
+    uint32_t keep = (uint32_t)((len + CLUSTER_BYTES - 1) / CLUSTER_BYTES);
+    if (keep == 0)
+        keep = 1;
+    if (keep < file_clusters(f))
+    {
+        fs_run_t *r = run_find(f, keep - 1);
+        uint32_t last = r->start + (keep - 1 - r->file_cl);
+        uint32_t tail = fat_get(last);
+        fat_set(last, FAT_EOC);
+        free_cluster_chain(tail);
+        f->nruns = (uint32_t)(r - f->runs) + 1;
+        r->len = keep - r->file_cl;
+        f->hint = 0;
+    }
+    e->size = (uint32_t)len;
+    entry_dirty(f->idx);
+    return 0;
+}
+
+/* ПРОВЕРКА ТОМА (fsck) */
+/* Один линейный проход: поля записей, достижимость из корня (каждая запись
+   проходится один раз), цепочки файлов (каждый кластер — один раз, карта
+   занятости на время проверки служит отметками "уже в цепочке"), затем
+   FAT целиком на утечки. Индексы и карта занятости строятся заново. */
+#define FSCK_UNSEEN 0
+#define FSCK_WALKING 1
+#define FSCK_REACHED 2
+
+static uint8_t fsck_state[FS_MAX_ENTRIES];
+static int16_t fsck_path[FS_MAX_ENTRIES];
+static uint8_t fsck_chain_bad[FS_MAX_ENTRIES]; /* починка меняет цепочку или размер файла */
+
+static inline int fsck_parent_ok(int idx)
+{
+    int p = entries[idx].parent;
+    return p >= 0 && p < FS_MAX_ENTRIES && p != idx && entries[p].used && entries[p].is_dir;
+}
+
+static inline int fsck_seen(uint32_t c)
+{
+    return (fat_bitmap[c / 64] >> (c % 64)) & 1;
+}
+
+/* Имя "#<индекс>", а пока оно занято в каталоге — с '#' в конце */
+static void fsck_rename(int idx)
+{
+    fs_entry_t *e = &entries[idx];
+    char digits[8];
+    int nd = 0;
+    unsigned v = (unsigned)idx;
+    do
+        digits[nd++] = (char)('0' + v % 10);
+    while ((v /= 10) != 0);
+
+    memset(e->name, 0, FS_NAME_MAX);
+    size_t len = 0;
+    e->name[len++] = '#';
+    while (nd)
+        e->name[len++] = digits[--nd];
+    while (len < FS_NAME_MAX - 1 && index_lookup(e->name, e->ext, e->parent, e->is_dir) >= 0)
+        e->name[len++] = '#';
+}
+
+/* Поля записи: строки с нулём, у каталога нет расширения и кластеров */
+static void fsck_entry(int idx, int repair, fs_fsck_t *r)
+{
+    fs_entry_t *e = &entries[idx];
+    int bad = e->used != 1 || e->is_dir > 1 || e->name[FS_NAME_MAX - 1] != '\0' ||
+              e->ext[FS_EXT_MAX - 1] != '\0' || e->name[0] == '\0' ||
+              (e->is_dir && (e->ext[0] != '\0' || e->first_cluster != 0 || e->size != 0));
+    if (!bad)
+        return;
+    r->bad_entries++;
+    if (!repair)
+        return;
+    e->used = 1;
+    e->is_dir = e->is_dir ? 1 : 0;
+    e->name[FS_NAME_MAX - 1] = '\0';
+    e->ext[FS_EXT_MAX - 1] = '\0';
+    if (e->name[0] == '\0')
+        fsck_rename(idx); // индексов ещё нет — дубликат разрешится при их сборке
+    if (e->is_dir)
+    {
+        memset(e->ext, 0, FS_EXT_MAX);
+        e->first_cluster = 0;
+        e->size = 0;
+    }
+    entry_dirty(idx);
+}
+
+/* Путь к корню от idx: записи на нём помечаются достижимыми. Родитель —
+   не каталог или замкнутый круг каталогов: запись переносится в корень */
+static void fsck_reach(int idx, int repair, fs_fsck_t *r)
+{
+    int n = 0;
+    int j = idx;
+    while (fsck_state[j] == FSCK_UNSEEN)
+    {
+        fsck_state[j] = FSCK_WALKING;
+        fsck_path[n++] = (int16_t)j;
+        if (!fsck_parent_ok(j))
+            break;
+        j = entries[j].parent;
+    }
+
+    int orphan = -1;
+    if (fsck_state[j] == FSCK_WALKING)
+        orphan = fsck_parent_ok(j) ? fsck_path[n - 1] : j; // круг замыкает последний на пути
+    if (orphan >= 0)
+    {
+        r->orphans++;
+        if (repair)
+        {
+            entries[orphan].parent = FS_ROOT_IDX;
+            entry_dirty(orphan);
+        }
+    }
+    while (n)
+        fsck_state[fsck_path[--n]] = FSCK_REACHED;
+}
+
+/* Цепочка файла: кластеры в томе, заняты в FAT, ни один не встречался
+   раньше, длина — по размеру (хотя бы один кластер). Лишний хвост
+   отрезается и освобождается проходом по утечкам. */
+static void fsck_chain(int idx, int repair, fs_fsck_t *r)
+{
+    fs_entry_t *e = &entries[idx];
+    uint32_t c = e->first_cluster;
+    if (!cluster_valid(c) || fat_get(c) == 0 || fsck_seen(c))
+    {
+        /* Данных нет или они чужие: запись не спасти */
+        if (cluster_valid(c) && fsck_seen(c))
+            r->cross_links++;
+        r->lost_files++;
+        fsck_chain_bad[idx] = 1;
+        if (repair)
+        {
+            memset(e, 0, sizeof(*e));
+            entry_dirty(idx);
+        }
+        return;
+    }
+
+    uint32_t want = (uint32_t)((e->size + CLUSTER_BYTES - 1) / CLUSTER_BYTES);
+    if (want == 0)
+        want = 1;
+    uint32_t n = 0;
+    for (;;)
+    {
+        fat_bitmap[c / 64] |= 1ULL << (c % 64);
+        n++;
+        uint32_t next = fat_get(c);
+        if (next == FAT_EOC)
+            break;
+        int stop = n == want;
+        if (!stop && (!cluster_valid(next) || fat_get(next) == 0 || fsck_seen(next)))
+        {
+            stop = 1;
+            if (cluster_valid(next) && fsck_seen(next))
+                r->cross_links++;
+        }
+        if (stop)
+        {
+            r->bad_chains++;
+            fsck_chain_bad[idx] = 1;
+            if (repair)
+                fat_set(c, FAT_EOC);
+            break;
+        }
+        c = next;
+    }
+
+    if (n < want)
+    {
+        r->bad_sizes++;
+        fsck_chain_bad[idx] = 1;
+        if (repair)
+        {
+            uint64_t have = (uint64_t)n * CLUSTER_BYTES;
+            e->size = have < FS_FILE_MAX ? (uint32_t)have : (uint32_t)FS_FILE_MAX;
+            entry_dirty(idx);
+        }
+    }
+}
+
+/* Индексы заново. Без починки запись с негодным родителем пропускается
+   (её списка детей нет), дубликат только считается */
+static void fsck_reindex(int repair, fs_fsck_t *r)
+{
+    uint64_t keep[sizeof(dir_dirty) / sizeof(dir_dirty[0])];
+    memcpy(keep, dir_dirty, sizeof(keep));
+    int renamed = 0;
+
+    index_reset();
+    for (int i = 0; i < FS_MAX_ENTRIES; ++i)
+    {
+        fs_entry_t *e = &entries[i];
+        if (i == FS_ROOT_IDX || !e->used || !fsck_parent_ok(i))
+            continue;
+        if (index_lookup(e->name, e->ext, e->parent, e->is_dir) >= 0)
+        {
+            r->duplicates++;
+            if (repair)
+            {
+                fsck_rename(i);
+                renamed = 1;
+            }
+        }
+        index_insert(i);
+    }
+    /* index_insert помечает каждую запись; на диск — только исправленные */
+    if (!renamed)
+        memcpy(dir_dirty, keep, sizeof(keep));
+}
+
+static int fsck_run(int repair, int reindex, fs_fsck_t *out)
+{
+    fs_fsck_t r = {0};
+    if (reindex)
+        index_reset(); // поиск по индексу при переименовании — по пустому
+
+    fs_entry_t *root = &entries[FS_ROOT_IDX];
+    if (root->used != 1 || root->is_dir != 1 || root->parent != -1 || root->first_cluster || root->size)
+    {
+        r.bad_entries++;
+        if (repair)
+        {
+            memset(root, 0, sizeof(*root));
+            root->used = 1;
+            root->is_dir = 1;
+            root->parent = -1;
+            root->name[0] = '/';
+            entry_dirty(FS_ROOT_IDX);
+        }
+    }
+
+    for (int i = 1; i < FS_MAX_ENTRIES; ++i)
+        if (entries[i].used)
+            fsck_entry(i, repair, &r);
+
+    memset(fsck_state, FSCK_UNSEEN, sizeof(fsck_state));
+    fsck_state[FS_ROOT_IDX] = FSCK_REACHED;
+    for (int i = 1; i < FS_MAX_ENTRIES; ++i)
+        if (entries[i].used && fsck_state[i] == FSCK_UNSEEN)
+            fsck_reach(i, repair, &r);
+
+    memset(fat_bitmap, 0, (size_t)fat_words * sizeof(uint64_t));
+    memset(fsck_chain_bad, 0, sizeof(fsck_chain_bad));
+    for (int i = 1; i < FS_MAX_ENTRIES; ++i)
+        if (entries[i].used && !entries[i].is_dir)
+            fsck_chain(i, repair, &r);
+
+    for (uint32_t c = 2; c < vol.clusters_end; ++c)
+    {
+        if (fat_get(c) != 0 && !fsck_seen(c))
+        {
+            r.leaked++;
+            if (repair)
+                fat_set(c, 0);
+        }
+    }
+
+    if (reindex)
+    {
+        fsck_reindex(repair, &r);
+    }
+    else
+    {
+        for (int i = 1; i < FS_MAX_ENTRIES; ++i)
+        {
+            fs_entry_t *e = &entries[i];
+            if (e->used && fsck_parent_ok(i) && index_lookup(e->name, e->ext, e->parent, e->is_dir) != i)
+                r.duplicates++;
+        }
+    }
+    bitmap_rebuild();
+
+    if (out)
+        *out = r;
+    return (int)(r.bad_entries + r.orphans + r.duplicates + r.lost_files + r.bad_chains + r.cross_links +
+                 r.bad_sizes + r.leaked);
+}
+
+/* Проверка смонтированного тома. Перед починкой — проверка: если чинить
+   пришлось бы цепочку открытого файла (а образы запущенных программ открыты
+   всё время их жизни и отображены в задачи), отказ. Остальные открытые
+   файлы после починки получают свежие списки серий. */
+int fs_fsck(int repair, fs_fsck_t *report)
+{
+    if (!vol.dev)
+        return -1;
+    int found = fsck_run(0, 0, report);
+    if (!repair || found <= 0)
+        return found;
+
+    for (int i = 0; i < FS_MAX_OPEN; ++i)
+        if (open_files[i].idx >= 0 && fsck_chain_bad[open_files[i].idx])
+            return -2;
+    found = fsck_run(1, 1, report);
+    for (int i = 0; i < FS_MAX_OPEN; ++i)
+        if (open_files[i].idx >= 0)
+            runs_build(&open_files[i]);
+    return found;
+}
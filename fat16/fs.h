@@ -4,6 +4,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include "../block/blkdev.h"
 
 #define FS_NAME_MAX 64
 #define FS_EXT_MAX 64
@@ -12,19 +13,110 @@
 /* Индекс корневого каталога в таблице записей */
 #define FS_ROOT_IDX 0
 
+/* Запись каталога — она же запись таблицы на диске (144 байта, little-endian) */
 typedef struct
 {
     char name[FS_NAME_MAX]; // имя файла или папки (без точки)
     char ext[FS_EXT_MAX];   // расширение для файлов, пусто для директорий
     int16_t parent;         // индекс родительского каталога (FS_ROOT_IDX для корня), -1 для корня
-    uint16_t first_cluster; // для файлов: первый кластер, для папок — 0
+    uint16_t reserved0;
+    uint32_t first_cluster; // для файлов: первый кластер, для папок — 0
     uint32_t size;          // размер файла в байтах (0 для директорий)
     uint8_t used;           // 1 — запись занята
     uint8_t is_dir;         // 1 — это директория
+    uint16_t reserved1;
 } fs_entry_t;
 
-/* Инициализация файловой системы (вызывает инициализацию FAT и корня) */
-void fs_init(void);
+_Static_assert(sizeof(fs_entry_t) == 144, "fs_entry_t is an on-disk record");
+
+/* Формат тома. Блоки по 4 KiB:
+     0            суперблок (первый сектор), остальное — нули
+     dir_off      таблица записей: FS_MAX_ENTRIES * fs_entry_t
+     fat_off      FAT: clusters_end записей по 2 (FAT16) или 4 (FAT32) байта
+     data_off     кластер 2 и дальше, начало кратно размеру кластера
+   Все поля — little-endian. */
+#define FS_MAGIC 0x31544146u // "FAT1"
+#define FS_VERSION 1
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t volume_bytes;
+    uint32_t cluster_size;
+    uint32_t fat_type;
+    uint32_t clusters_end; // номера кластеров данных: [2, clusters_end)
+    uint32_t max_entries;
+    uint32_t entry_size;
+    uint32_t reserved;
+    uint64_t dir_off;
+    uint64_t fat_off;
+    uint64_t data_off;
+    uint32_t reserved2;
+    uint32_t checksum; // FNV-1a всех предыдущих байт
+} fs_super_t;
+
+_Static_assert(sizeof(fs_super_t) == 72, "fs_super_t is an on-disk record");
+
+/* Заполненность ФС (счётчики ведутся на ходу, запрос — O(1)) */
+typedef struct
+{
+    uint32_t cluster_size;   // байт в кластере
+    uint32_t total_clusters; // кластеров данных
+    uint32_t free_clusters;
+    uint32_t max_entries; // записей в таблице каталогов
+    uint32_t used_entries;
+    uint32_t fat_type; // 16 или 32
+} fs_statfs_t;
+
+/* Геометрия тома. Кластер — степень двойки от 512 Б до 64 КиБ; FAT
+   занимает столько, сколько нужно под все кластеры устройства. Тип FAT
+   по умолчанию выбирается по числу кластеров (больше 65524 — FAT32). */
+#define FS_CLUSTER_MIN 512
+#define FS_CLUSTER_MAX (64 * 1024)
+#define FS_CLUSTER_DEFAULT 4096
+
+typedef struct
+{
+    uint32_t cluster_size; // 0 — FS_CLUSTER_DEFAULT
+    uint8_t fat_type;      // 0 — по размеру тома, 16 или 32
+} fs_geometry_t;
+
+/* Итог проверки тома (fs_fsck): число найденных нарушений по видам */
+typedef struct
+{
+    uint32_t bad_entries; // испорченные поля записи (имя без нуля, кластеры у каталога)
+    uint32_t orphans;     // родитель не каталог или круг каталогов — запись в корень
+    uint32_t duplicates;  // одинаковое имя в каталоге — переименование в "#<индекс>"
+    uint32_t lost_files;  // файл без своей цепочки — запись удаляется
+    uint32_t bad_chains;  // цепочка за томом, через свободный кластер или длиннее размера — обрезается
+    uint32_t cross_links; // кластер в двух цепочках (или петля)
+    uint32_t bad_sizes;   // размер больше цепочки — уменьшается до неё
+    uint32_t leaked;      // занятые в FAT кластеры вне цепочек — освобождаются
+} fs_fsck_t;
+
+/* Инициализация файловой системы: том с dev (с починкой), а если на нём
+   нет корректного тома — пустой том с геометрией по умолчанию */
+void fs_init(blkdev_t *dev);
+
+/* Подключить том с dev: суперблок, таблица записей и FAT читаются в
+   память и проверяются (fs_fsck); repair — исправить найденное, report —
+   итог проверки (может быть NULL). >=0 — число найденных нарушений,
+   <0 — тома нет или его не прочесть */
+int fs_mount(blkdev_t *dev, int repair, fs_fsck_t *report);
+
+/* Проверить подключённый том за один проход по таблице записей и FAT;
+   repair — исправить. Возвращает число нарушений (0 — том цел), -1 — тома
+   нет, -2 — починка изменила бы цепочку открытого файла (ничего не тронуто) */
+int fs_fsck(int repair, fs_fsck_t *report);
+
+/* Создать пустой том на dev с заданной геометрией (NULL — по умолчанию).
+   Все записи теряются; открытых файлов быть не должно. 0 — ок, <0 — ошибка */
+int fs_format(blkdev_t *dev, const fs_geometry_t *geo);
+
+/* Изменения таблицы записей и FAT — в кэш буферов; wait — ещё и записать
+   кэш тома на устройство. Без wait это работа фоновой задачи. 0 — ок */
+int fs_sync(int wait);
 
 /* Создать директорию с именем name в каталоге parent (индекс). Возвращает индекс новой записи или -1 при ошибке */
 int fs_mkdir(const char *name, int parent);
@@ -33,7 +125,7 @@ int fs_mkdir(const char *name, int parent);
 int fs_rmdir(int dir_idx);
 
 /* Создать файл в каталоге parent; при успехе возвращает индекс записи >=0 и (опционально) стартовый кластер в out_cluster */
-int fs_create_file(const char *name, const char *ext, int parent, uint16_t *out_cluster);
+int fs_create_file(const char *name, const char *ext, int parent, uint32_t *out_cluster);
 
 /* Удалить запись (файл или пустую директорию) по индексу. Для файлов освободит кластера. */
 int fs_remove_entry(int idx);
@@ -44,12 +136,41 @@ int fs_find_in_dir(const char *name, const char *ext, int parent, fs_entry_t *ou
 /* Получить список всех записей в каталоге parent. Возвращает количество записей, помещённых в out_files (макс = max_files) */
 int fs_get_all_in_dir(fs_entry_t *out_files, int max_files, int parent);
 
+void fs_statfs(fs_statfs_t *st);
+
+/* Запись по индексу таблицы: 0 — занята (копия в out), -1 — нет */
+int fs_get_entry(int idx, fs_entry_t *out);
+
 /* Прочитать/записать низкоуровневые данные (цепочка кластеров) */
-size_t fs_read(uint16_t first_cluster, void *buf, size_t size);
-size_t fs_write(uint16_t first_cluster, const void *buf, size_t size);
+size_t fs_read(uint32_t first_cluster, void *buf, size_t size);
+size_t fs_write(uint32_t first_cluster, const void *buf, size_t size);
 
 /* Высокоуровневые операции с файлами (по имени + каталогу) */
 int fs_write_file_in_dir(const char *name, const char *ext, int parent, const void *data, size_t size);
 int fs_read_file_in_dir(const char *name, const char *ext, int parent, void *buf, size_t bufsize, size_t *out_size);
 
+/* Открытые файлы: один объект на запись каталога, общий для всех
+   дескрипторов, со списком серий кластеров — доступ по смещению без
+   прохода по FAT. Файл, открытый хоть одним дескриптором, не удаляется. */
+#define FS_MAX_OPEN 64
+#define FS_FILE_MAX 0xFFFFFFFFULL // размер в записи — uint32_t
+
+typedef struct fs_file fs_file_t;
+
+fs_file_t *fs_file_open(int idx);
+void fs_file_close(fs_file_t *f);
+/* Содержимое файла одним куском в памяти устройства или NULL, если
+   кластеры не подряд или устройство не отображено в память. Пока запись
+   запрещена, адрес не меняется. */
+const void *fs_file_data(fs_file_t *f);
+/* Запрет записи на время, пока файл отображён в задачи (как ETXTBSY) */
+void fs_file_deny_write(fs_file_t *f);
+void fs_file_allow_write(fs_file_t *f);
+int fs_file_index(const fs_file_t *f);
+uint32_t fs_file_size(const fs_file_t *f);
+/* Возвращают число байт (0 — конец файла) или -1 */
+int64_t fs_pread(fs_file_t *f, void *buf, size_t n, uint64_t off);
+int64_t fs_pwrite(fs_file_t *f, const void *buf, size_t n, uint64_t off);
+int fs_ftruncate(fs_file_t *f, uint64_t len);
+
 #endif // FS_H
\ No newline at end of file
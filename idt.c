@@ -3,6 +3,7 @@
 #include "portio/portio.h"
 #include "isr.h"
 #include "pic.h"
+#include "cpu/tss.h"
 
 // массив указателей на заглушки 0..31
 static struct idt_entry idt[IDT_ENTRIES];
@@ -21,6 +22,11 @@ void idt_set_gate(uint8_t num, void (*handler)(), uint16_t sel, uint8_t flags)
     idt[num].zero = 0;
 }
 
+void idt_set_ist(uint8_t num, uint8_t ist)
+{
+    idt[num].ist = ist & 0x7;
+}
+
 void idt_install(void)
 {
     /* Переназначаем PIC (если нужно) */
@@ -46,6 +52,13 @@ void idt_install(void)
         idt_set_gate(i, stubs[i], 0x08, 0x8E);
     }
 
+    /* #PF: demand paging и рост стеков ядра (vmm/vmm.c). Стек задачи в момент
+       #PF может как раз кончиться, поэтому оба обработчика — на стеках IST. */
+    idt_set_gate(14, isr14, 0x08, 0x8E);
+    idt_set_ist(14, IST_PAGE_FAULT);
+    idt_set_gate(8, isr8, 0x08, 0x8E);
+    idt_set_ist(8, IST_DOUBLE_FAULT);
+
     /* IRQ handlers (timer, keyboard) и системный вызов (DPL=3 -> 0xEE) */
     idt_set_gate(TIMER, isr32, 0x08, 0x8E);
     idt_set_gate(KEYBOARD, isr33, 0x08, 0x8E);
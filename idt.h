@@ -28,6 +28,8 @@ struct __attribute__((packed)) idt_ptr
 };
 
 void idt_set_gate(uint8_t num, void (*handler)(), uint16_t sel, uint8_t flags);
+/* Обработчик вектора num будет работать на стеке IST ist (1..7) из TSS */
+void idt_set_ist(uint8_t num, uint8_t ist);
 void idt_install(void);
 
 /* 64-bit wrapper for lidt implemented in asm */
@@ -0,0 +1,55 @@
+; isr14.asm — #PF (page fault) для x86_64
+; CPU кладёт error code перед RIP, поэтому обычная заглушка из isr_stubs.asm не подходит.
+; Ожидается:
+;   extern page_fault_handler     ; void page_fault_handler(uint64_t err_code, uint64_t rip)
+[BITS 64]
+
+global isr14
+extern page_fault_handler
+
+isr14:
+    push rax
+    push rcx
+    push rdx
+    push rbx
+    push rbp
+    push rsi
+    push rdi
+    push r8
+    push r9
+    push r10
+    push r11
+    push r12
+    push r13
+    push r14
+    push r15
+
+    mov rdi, [rsp + 15*8]   ; err_code
+    mov rsi, [rsp + 16*8]   ; rip
+
+    ; 15 push'ей + кадр CPU (6 qword) -> выравниваем стек до 16
+    sub rsp, 8
+    call page_fault_handler
+    add rsp, 8
+
+    pop r15
+    pop r14
+    pop r13
+    pop r12
+    pop r11
+    pop r10
+    pop r9
+    pop r8
+    pop rdi
+    pop rsi
+    pop rbp
+    pop rbx
+    pop rdx
+    pop rcx
+    pop rax
+
+    add rsp, 8              ; убираем err_code
+    iretq
+
+section .note.GNU-stack
+; empty
@@ -0,0 +1,21 @@
+; isr8.asm — #DF (double fault) для x86_64
+; Приходит на своём стеке IST (cpu/tss.c): обычно это исключение, кадру
+; которого не нашлось места, например переполнение стека ядра задачи.
+; Возврата нет, поэтому регистры не сохраняем.
+;   extern double_fault_handler   ; void double_fault_handler(uint64_t rip)
+[BITS 64]
+
+global isr8
+extern double_fault_handler
+
+isr8:
+    mov rdi, [rsp + 8]      ; rip (над error code, он всегда 0)
+    and rsp, -16
+    call double_fault_handler
+.hang:
+    cli
+    hlt
+    jmp .hang
+
+section .note.GNU-stack
+; empty
@@ -49,4 +49,14 @@ extern void isr32();
 extern void isr33();
 extern void isr80();
 
+/*
+ * Обработчик #PF (вектор 14) — interrupt/isr14.asm, снимает error code.
+ */
+extern void isr14();
+
+/*
+ * Обработчик #DF (вектор 8) — interrupt/isr8.asm, паника на стеке IST.
+ */
+extern void isr8();
+
 #endif // ISR_H
@@ -5,10 +5,12 @@
 
 section .text
     ;multiboot spec
+    ; flags: бит 0 — модули (образ ФС) выровнены на 4 KiB, их страницы
+    ; отображаются в задачи как есть
     align 4
     dd 0x1BADB002          ; magic Multiboot
-    dd 0x00                 ; flags
-    dd -(0x1BADB002 + 0x00)   ; checksum
+    dd 0x01                 ; flags
+    dd -(0x1BADB002 + 0x01)   ; checksum
 
 global start
 ; extern syscall_stub
@@ -17,12 +19,19 @@ extern kmain        ; 64-bit C entry point (link with -m64 objects)
 start:
     cli                     ; отключаем прерывания
 
+    ; --- eax = magic загрузчика, ebx = адрес multiboot info: до перехода в
+    ;     long mode регистры не доживут (eax нужен для CR4/EFER) ---
+    mov [mb_magic], eax
+    mov [mb_info], ebx
+
     ; --- Загружаем GDT (должен содержать 64-bit code selector в 0x08) ---
     lgdt [gdt_desc]
 
-    ; --- Включаем PAE (CR4.PAE = 1) ---
+    ; --- Включаем PAE (CR4.PAE = 1) и глобальные страницы (CR4.PGE = 1) ---
+    ; PGE есть на любом x86_64; страницы ядра с G=1 переживают смену CR3
     mov eax, cr4
     bts eax, 5
+    bts eax, 7
     mov cr4, eax
 
     ; --- Устанавливаем CR3 = адрес pml4_table (низкие 32 бита достаточно, мы в low memory) ---
@@ -58,7 +67,9 @@ long_mode_entry:
     lea rsp, [rel stack64_top]
     and rsp, -16
 
-    ; вызов 64-битного kmain (собранного с -m64)
+    ; вызов 64-битного kmain (собранного с -m64): kmain(magic, info)
+    mov edi, [rel mb_magic]
+    mov esi, [rel mb_info]
     call kmain
 
 .hang64:
@@ -93,10 +104,14 @@ stack64_top:
 ; -----------------------------------------------------------------------
 ; Простая identity map: PML4 -> PDPT -> PD (512 x 2MiB = 1GiB)
 ; Используем выровненные таблицы, создаём 512 PDE, каждое значение = base_of_2MiB_chunk + flags
-; Флаги: Present | RW | PS(2MiB) = 0x83
+; Флаги: Present | RW | PS(2MiB) | G = 0x183
 ; PML4 entry and PDPT entry: Present | RW = 0x03
 ; -----------------------------------------------------------------------
 section .data
+align 4
+mb_magic: dd 0
+mb_info:  dd 0
+
 align 4096
 pml4_table:
     dq pdpt_table + 0x007    ; Present | RW | US
@@ -109,8 +124,9 @@ align 4096
 pd_table:
 %assign j 0
 %rep 512
-    ; addr = j * 0x200000, flags = Present | RW | US | PS(2MiB) = 0x87
-    dq j * 0x200000 + 0x087
+    ; addr = j * 0x200000, flags = Present | RW | US | PS(2MiB) | G = 0x187
+    ; identity map общий для всех адресных пространств — помечаем глобальным
+    dq j * 0x200000 + 0x187
 %assign j j + 1
 %endrep
 
@@ -12,6 +12,7 @@
 
 #include "malloc/malloc.h"
 #include "libc/string.h"
+#include "libc/kprintf.h"
 
 #include "power/poweroff.h"
 #include "power/reboot.h"
@@ -19,18 +20,18 @@
 #include "multitask/multitask.h"
 #include "tasks/tasks.h"
 
-// #include "user/terminal_bin.h"
-
 #include "ramdisk/ramdisk.h"
+#include "block/bcache.h"
 #include "fat16/fs.h"
 
 #include "malloc/user_malloc.h"
+#include "vmm/vmm.h"
+#include "cpu/cpu.h"
+#include "cpu/tss.h"
+#include "multiboot/multiboot.h"
 
-#include "user/terminal.h"
-#include "user/htop.h"
-#include "user/clear.h"
-#include "user/shutdown.h"
-#include "user/reboot.h"
+/* Образ корневой ФС — модуль загрузчика (tools/fsimage/mkfs) */
+#define FS_IMAGE_NAME "fs.img"
 
 /* символы из link.ld */
 extern char _heap_start;
@@ -70,43 +71,15 @@ static void debug_run_tests(void)
     }
 
     print_kmalloc_stats();
-}
-
-char *itoa(uint32_t num, char *str, int base)
-{
-    int i = 0;
-    if (num == 0)
-    {
-        str[i++] = '0';
-        str[i] = '\0';
-        return str;
-    }
-
-    while (num > 0)
-    {
-        int rem = num % base;
-        str[i++] = (rem > 9) ? (rem - 10) + 'A' : rem + '0';
-        num /= base;
-    }
 
-    str[i] = '\0';
-
-    // Разворачиваем строку
-    for (int j = 0; j < i / 2; j++)
-    {
-        char temp = str[j];
-        str[j] = str[i - j - 1];
-        str[i - j - 1] = temp;
-    }
-
-    return str;
+    vmm_bench_switch();
+    string_bench();
 }
 
 void list_root_dir(void)
 {
     static fs_entry_t files[FS_MAX_ENTRIES];
     int count = fs_get_all_in_dir(files, FS_MAX_ENTRIES, FS_ROOT_IDX); // всегда корень
-    char size_buf[40];
 
     print_string_position("Root directory:", 0, 0, RED, BLACK);
 
@@ -114,43 +87,22 @@ void list_root_dir(void)
     {
         print_string_position(files[i].name, 0, i + 1, WHITE, BLACK);
         if (!files[i].is_dir)
-        {
-            itoa(files[i].size, size_buf, 10);
-            print_string_position(size_buf, 22, i + 1, RED, BLACK);
-        }
+            kprintf_at(22, i + 1, RED, BLACK, "%u", files[i].size);
     }
 }
 
 #endif // DEBUG
 
-void load_app_to_fs(char *folder, char *name, char *ext, unsigned char *data, unsigned int dat)
-{
-    // Найти/создать каталог /bin
-    int bin_idx = fs_find_in_dir(folder, NULL, FS_ROOT_IDX, NULL);
-    if (bin_idx < 0)
-    {
-        bin_idx = fs_mkdir(folder, FS_ROOT_IDX);
-        if (bin_idx < 0)
-        {
-            // обработка ошибки: не удалось создать /bin
-            return;
-        }
-    }
-
-    // Записать файл terminal.elf в каталог /bin
-    int rc = fs_write_file_in_dir(name, ext, bin_idx, data, dat);
-    if (rc != 0)
-    {
-        // ошибка записи (можно вывести код rc)
-    }
-}
-
 /*-------------------------------------------------------------
     Основная функция ядра
 -------------------------------------------------------------*/
-void kmain(void)
+void kmain(uint32_t mb_magic, uint32_t mb_info)
 {
-    /* Инициализация прерываний и таймера */
+    /* Список модулей — до того, как память загрузчика станет чем-то ещё */
+    multiboot_init(mb_magic, mb_info);
+
+    /* TSS со стеками IST для #PF/#DF, затем прерывания и таймер */
+    tss_init();
     idt_install();
     init_system_clock();
     init_timer(1000);
@@ -161,15 +113,30 @@ void kmain(void)
     malloc_init(&_heap_start, heap_size);
     user_malloc_init();
 
-    fs_init();
-
-    load_app_to_fs("bin", "terminal", "bin", terminal_bin, terminal_bin_len);
-    load_app_to_fs("bin", "htop", "bin", htop_bin, htop_bin_len);
-    load_app_to_fs("bin", "clear", "bin", clear_bin, clear_bin_len);
-    load_app_to_fs("bin", "shutdown", "bin", shutdown_bin, shutdown_bin_len);
-    load_app_to_fs("bin", "reboot", "bin", reboot_bin, reboot_bin_len);
+    /* Фреймы 4 KiB и адресные пространства задач (PCID, если есть) */
+    cpu_init();
+    string_init();
+    pmm_init();
+    vmm_init();
+    malloc_large_init();
+
+    /* Корневой том: модуль загрузчика подключается на месте, как RAM-диск,
+       без копирования. Программы /bin — уже в образе. Отображённым
+       устройствам кэш буферов не нужен — он выделяется, только если есть
+       устройство без map. */
+    const mb_module_t *img = multiboot_find_module(FS_IMAGE_NAME);
+    blkdev_t *root = img ? ramdisk_init((void *)(uintptr_t)img->start, img->end - img->start) : NULL;
+    if (blkdev_need_cache())
+        bcache_init(BCACHE_NBUFS);
+    fs_fsck_t fsck;
+    int fsck_found = root ? fs_mount(root, 1, &fsck) : -1;
 
     clean_screen();
+    if (fsck_found < 0)
+        kprintf_at(0, 0, RED, BLACK, "No root file system: boot with the %s module", FS_IMAGE_NAME);
+    else if (fsck_found > 0)
+        kprintf_at(0, 0, YELLOW, BLACK, "fsck: %d errors repaired (%u leaked clusters, %u lost files)", fsck_found,
+                   fsck.leaked, fsck.lost_files);
 
     scheduler_init();
     tasks_init();
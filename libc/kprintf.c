@@ -0,0 +1,266 @@
+// kprintf.c — ksnprintf/kprintf: один формат для всей диагностики ядра
+#include "kprintf.h"
+#include "../vga/vga.h"
+#include "../sync/spinlock.h"
+
+#define KPRINTF_BUF 1024 /* одна запись kprintf; длиннее — обрезается */
+
+/* Пары цифр "00".."99": делим на 100, а не на 10 — вдвое меньше делений */
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+size_t u64_to_dec(uint64_t v, char *buf)
+{
+    char tmp[20];
+    char *p = tmp + sizeof(tmp);
+    while (v >= 100)
+    {
+        unsigned pair = (unsigned)(v % 100) * 2;
+        v /= 100;
+        *--p = digit_pairs[pair + 1];
+        *--p = digit_pairs[pair];
+    }
+    if (v >= 10)
+    {
+        *--p = digit_pairs[v * 2 + 1];
+        *--p = digit_pairs[v * 2];
+    }
+    else
+    {
+        *--p = (char)('0' + v);
+    }
+    size_t n = (size_t)(tmp + sizeof(tmp) - p);
+    for (size_t i = 0; i < n; ++i)
+        buf[i] = p[i];
+    buf[n] = '\0';
+    return n;
+}
+
+static size_t u64_to_hex(uint64_t v, char *buf, int upper)
+{
+    const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    char tmp[16];
+    size_t n = 0;
+    do
+    {
+        tmp[n++] = digits[v & 0xF];
+        v >>= 4;
+    } while (v);
+    for (size_t i = 0; i < n; ++i)
+        buf[i] = tmp[n - 1 - i];
+    buf[n] = '\0';
+    return n;
+}
+
+typedef struct
+{
+    char *buf;
+    size_t size;
+    size_t len; /* полная длина, даже если в буфер не поместилось */
+} out_t;
+
+static inline void out_char(out_t *o, char c)
+{
+    if (o->len + 1 < o->size)
+        o->buf[o->len] = c;
+    o->len++;
+}
+
+static void out_field(out_t *o, const char *s, size_t n, int width, int left, char pad)
+{
+    size_t fill = (width > 0 && (size_t)width > n) ? (size_t)width - n : 0;
+    /* Знак идёт перед нулями: "-0042", а не "00-42" */
+    if (!left && pad == '0' && n && s[0] == '-')
+    {
+        out_char(o, '-');
+        s++;
+        n--;
+    }
+    if (!left)
+        while (fill--)
+            out_char(o, pad);
+    for (size_t i = 0; i < n; ++i)
+        out_char(o, s[i]);
+    if (left)
+        while (fill--)
+            out_char(o, ' ');
+}
+
+int kvsnprintf(char *buf, size_t size, const char *fmt, va_list ap)
+{
+    out_t o = {buf, size, 0};
+    char num[24];
+
+    for (const char *f = fmt; *f; ++f)
+    {
+        if (*f != '%')
+        {
+            out_char(&o, *f);
+            continue;
+        }
+
+        int left = 0;
+        char pad = ' ';
+        for (;; ++f)
+        {
+            if (f[1] == '-')
+                left = 1;
+            else if (f[1] == '0')
+                pad = '0';
+            else
+                break;
+        }
+        ++f;
+
+        int width = 0;
+        if (*f == '*')
+        {
+            width = va_arg(ap, int);
+            if (width < 0)
+            {
+                left = 1;
+                width = -width;
+            }
+            ++f;
+        }
+        while (*f >= '0' && *f <= '9')
+            width = width * 10 + (*f++ - '0');
+
+        int wide = 0; /* l, ll, z — 64 бита */
+        while (*f == 'l' || *f == 'z')
+        {
+            wide = 1;
+            ++f;
+        }
+
+        switch (*f)
+        {
+        case 'd':
+        case 'i':
+        {
+            int64_t v = wide ? va_arg(ap, int64_t) : va_arg(ap, int);
+            size_t n = 0;
+            uint64_t mag = (uint64_t)v;
+            if (v < 0)
+            {
+                num[n++] = '-';
+                mag = 0 - mag;
+            }
+            n += u64_to_dec(mag, num + n);
+            out_field(&o, num, n, width, left, pad);
+            break;
+        }
+        case 'u':
+        {
+            uint64_t v = wide ? va_arg(ap, uint64_t) : va_arg(ap, unsigned int);
+            out_field(&o, num, u64_to_dec(v, num), width, left, pad);
+            break;
+        }
+        case 'x':
+        case 'X':
+        {
+            uint64_t v = wide ? va_arg(ap, uint64_t) : va_arg(ap, unsigned int);
+            out_field(&o, num, u64_to_hex(v, num, *f == 'X'), width, left, pad);
+            break;
+        }
+        case 'p':
+        {
+            num[0] = '0';
+            num[1] = 'x';
+            size_t n = 2 + u64_to_hex((uint64_t)(uintptr_t)va_arg(ap, void *), num + 2, 0);
+            out_field(&o, num, n, width, left, ' ');
+            break;
+        }
+        case 's':
+        {
+            const char *s = va_arg(ap, const char *);
+            if (!s)
+                s = "(null)";
+            size_t n = 0;
+            while (s[n])
+                n++;
+            out_field(&o, s, n, width, left, ' ');
+            break;
+        }
+        case 'c':
+            num[0] = (char)va_arg(ap, int);
+            out_field(&o, num, 1, width, left, ' ');
+            break;
+        case '%':
+            out_char(&o, '%');
+            break;
+        case '\0':
+            --f; /* '%' в конце строки */
+            break;
+        default:
+            out_char(&o, '%');
+            out_char(&o, *f);
+            break;
+        }
+    }
+
+    if (size)
+        buf[o.len < size ? o.len : size - 1] = '\0';
+    return (int)o.len;
+}
+
+int ksnprintf(char *buf, size_t size, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int n = kvsnprintf(buf, size, fmt, ap);
+    va_end(ap);
+    return n;
+}
+
+/* Общий буфер консольного вывода: не занимает стек ядра задачи */
+static char kprintf_buf[KPRINTF_BUF];
+static spinlock_t kprintf_lock = SPINLOCK_INIT;
+
+int kprintf(const char *fmt, ...)
+{
+    unsigned long irq = spin_lock_irqsave(&kprintf_lock);
+    va_list ap;
+    va_start(ap, fmt);
+    int n = kvsnprintf(kprintf_buf, sizeof(kprintf_buf), fmt, ap);
+    va_end(ap);
+    print_string(kprintf_buf, WHITE, BLACK);
+    spin_unlock_irqrestore(&kprintf_lock, irq);
+    return n;
+}
+
+int kprintf_at(unsigned int x, unsigned int y, uint8_t fg, uint8_t bg, const char *fmt, ...)
+{
+    unsigned long irq = spin_lock_irqsave(&kprintf_lock);
+    va_list ap;
+    va_start(ap, fmt);
+    int n = kvsnprintf(kprintf_buf, sizeof(kprintf_buf), fmt, ap);
+    va_end(ap);
+
+    /* print_string_position не знает '\n' — режем буфер по строкам на месте */
+    char *line = kprintf_buf;
+    for (char *p = kprintf_buf;; ++p)
+    {
+        if (*p != '\n' && *p != '\0')
+            continue;
+        char end = *p;
+        *p = '\0';
+        if (p != line)
+            print_string_position(line, x, y, fg, bg);
+        if (!end)
+            break;
+        line = p + 1;
+        y++;
+    }
+    spin_unlock_irqrestore(&kprintf_lock, irq);
+    return n;
+}
@@ -0,0 +1,27 @@
+#ifndef KPRINTF_H
+#define KPRINTF_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdarg.h>
+
+/* Форматирование в буфер и вывод одной записью в консоль.
+   Поддерживается: %d %i %u %x %X %p %s %c %%, флаги '-' и '0', ширина
+   (число или '*'), модификаторы l, ll, z — 64-битные значения печатаются
+   целиком. Возвращают длину полного результата (как snprintf), буфер
+   всегда завершён нулём. */
+int kvsnprintf(char *buf, size_t size, const char *fmt, va_list ap);
+int ksnprintf(char *buf, size_t size, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+/* С текущей позиции курсора консоли (print_string) */
+int kprintf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+/* С позиции (x, y); '\n' переводит на следующую строку с той же колонки */
+int kprintf_at(unsigned int x, unsigned int y, uint8_t fg, uint8_t bg, const char *fmt, ...)
+    __attribute__((format(printf, 5, 6)));
+
+/* Десятичная запись v в buf (>= 21 байт), возвращает длину */
+size_t u64_to_dec(uint64_t v, char *buf);
+
+#endif // KPRINTF_H
@@ -1,8 +1,56 @@
 #include <stddef.h>
+#include <stdint.h>
 #include "string.h"
+#include "../cpu/cpu.h"
+#include "../sync/spinlock.h"
+#ifdef DEBUG
+#include "../malloc/malloc.h"
+#include "../vga/vga.h"
+#include "kprintf.h"
+#endif
 
 /* =================== MEM =================== */
-void *memcpy(void *dst, const void *src, size_t n)
+
+/* Размер решает, какой вариант работает: до MEM_SMALL — слова и байты,
+   до MEM_LARGE — «средний» вариант, дальше — «крупный». Варианты выбирает
+   string_init по CPUID; до неё (ранняя загрузка) — rep movsq/stosq. */
+#define MEM_SMALL 64
+#define MEM_LARGE 2048
+
+typedef uint64_t __attribute__((may_alias, aligned(1))) u64_unaligned;
+
+typedef void *(*copy_fn)(void *dst, const void *src, size_t n);
+typedef void *(*set_fn)(void *s, int c, size_t n);
+
+static inline void *copy_small(void *dst, const void *src, size_t n)
+{
+    unsigned char *d = (unsigned char *)dst;
+    const unsigned char *s = (const unsigned char *)src;
+    for (; n >= 8; n -= 8, d += 8, s += 8)
+        *(u64_unaligned *)d = *(const u64_unaligned *)s;
+    while (n--)
+        *d++ = *s++;
+    return dst;
+}
+
+static inline void *set_small(void *dst, uint64_t pattern, size_t n)
+{
+    unsigned char *d = (unsigned char *)dst;
+    for (; n >= 8; n -= 8, d += 8)
+        *(u64_unaligned *)d = pattern;
+    while (n--)
+        *d++ = (unsigned char)pattern;
+    return dst;
+}
+
+static inline uint64_t byte_pattern(int c)
+{
+    return (uint64_t)(unsigned char)c * 0x0101010101010101ULL;
+}
+
+/* --- варианты --- */
+
+static void *copy_bytes(void *dst, const void *src, size_t n)
 {
     unsigned char *d = (unsigned char *)dst;
     const unsigned char *s = (const unsigned char *)src;
@@ -11,73 +59,632 @@ void *memcpy(void *dst, const void *src, size_t n)
     return dst;
 }
 
-void *memset(void *s, int c, size_t n)
+static void *copy_movsq(void *dst, const void *src, size_t n)
+{
+    void *d = dst;
+    size_t q = n >> 3;
+    asm volatile("rep movsq" : "+D"(d), "+S"(src), "+c"(q)::"memory");
+    copy_small(d, src, n & 7);
+    return dst;
+}
+
+static void *copy_erms(void *dst, const void *src, size_t n)
+{
+    void *d = dst;
+    asm volatile("rep movsb" : "+D"(d), "+S"(src), "+c"(n)::"memory");
+    return dst;
+}
+
+/* Регистры xmm/ymm не входят в контекст задачи, поэтому векторный цикл идёт
+   с запретом прерываний. Он только для средних размеров (< MEM_LARGE), так что
+   окно — сотни тактов. */
+static inline unsigned long vec_begin(void)
+{
+    return local_irq_save();
+}
+
+static inline void vec_end(unsigned long flags)
+{
+    local_irq_restore(flags);
+}
+
+static void *copy_sse2(void *dst, const void *src, size_t n)
+{
+    unsigned char *d = (unsigned char *)dst;
+    const unsigned char *s = (const unsigned char *)src;
+    size_t blocks = n >> 6;
+    if (blocks)
+    {
+        unsigned long flags = vec_begin();
+        asm volatile("1:\n\t"
+                     "movdqu   (%1), %%xmm0\n\t"
+                     "movdqu 16(%1), %%xmm1\n\t"
+                     "movdqu 32(%1), %%xmm2\n\t"
+                     "movdqu 48(%1), %%xmm3\n\t"
+                     "movdqu %%xmm0,   (%0)\n\t"
+                     "movdqu %%xmm1, 16(%0)\n\t"
+                     "movdqu %%xmm2, 32(%0)\n\t"
+                     "movdqu %%xmm3, 48(%0)\n\t"
+                     "add $64, %0\n\t"
+                     "add $64, %1\n\t"
+                     "dec %2\n\t"
+                     "jnz 1b"
+                     : "+r"(d), "+r"(s), "+r"(blocks)
+                     :
+                     : "xmm0", "xmm1", "xmm2", "xmm3", "memory", "cc");
+        vec_end(flags);
+    }
+    copy_small(d, s, n & 63);
+    return dst;
+}
+
+static void *copy_avx2(void *dst, const void *src, size_t n)
+{
+    unsigned char *d = (unsigned char *)dst;
+    const unsigned char *s = (const unsigned char *)src;
+    size_t blocks = n >> 6;
+    if (blocks)
+    {
+        unsigned long flags = vec_begin();
+        asm volatile("1:\n\t"
+                     "vmovdqu   (%1), %%ymm0\n\t"
+                     "vmovdqu 32(%1), %%ymm1\n\t"
+                     "vmovdqu %%ymm0,   (%0)\n\t"
+                     "vmovdqu %%ymm1, 32(%0)\n\t"
+                     "add $64, %0\n\t"
+                     "add $64, %1\n\t"
+                     "dec %2\n\t"
+                     "jnz 1b\n\t"
+                     "vzeroupper"
+                     : "+r"(d), "+r"(s), "+r"(blocks)
+                     :
+                     : "xmm0", "xmm1", "memory", "cc");
+        vec_end(flags);
+    }
+    copy_small(d, s, n & 63);
+    return dst;
+}
+
+static void *set_bytes(void *dst, int c, size_t n)
 {
-    unsigned char *p = (unsigned char *)s;
+    unsigned char *p = (unsigned char *)dst;
     for (size_t i = 0; i < n; ++i)
         p[i] = (unsigned char)c;
-    return s;
+    return dst;
 }
 
-/* =================== STR =================== */
-size_t strlen(const char *s)
+static void *set_stosq(void *dst, int c, size_t n)
 {
-    size_t len = 0;
-    while (*s++)
-        len++;
-    return len;
+    void *d = dst;
+    uint64_t pattern = byte_pattern(c);
+    size_t q = n >> 3;
+    asm volatile("rep stosq" : "+D"(d), "+c"(q) : "a"(pattern) : "memory");
+    set_small(d, pattern, n & 7);
+    return dst;
 }
 
-char *strcpy(char *dst, const char *src)
+static void *set_erms(void *dst, int c, size_t n)
 {
-    char *d = dst;
-    while ((*d++ = *src++))
-        ;
+    void *d = dst;
+    asm volatile("rep stosb" : "+D"(d), "+c"(n) : "a"(c) : "memory");
     return dst;
 }
 
-char *strncpy(char *dst, const char *src, size_t n)
+static void *set_sse2(void *dst, int c, size_t n)
 {
-    size_t i = 0;
-    for (; i < n && src[i]; i++)
-        dst[i] = src[i];
-    for (; i < n; i++)
-        dst[i] = '\0';
+    unsigned char *d = (unsigned char *)dst;
+    uint64_t pattern = byte_pattern(c);
+    size_t blocks = n >> 6;
+    if (blocks)
+    {
+        unsigned long flags = vec_begin();
+        asm volatile("movq %3, %%xmm0\n\t"
+                     "punpcklqdq %%xmm0, %%xmm0\n"
+                     "1:\n\t"
+                     "movdqu %%xmm0,   (%0)\n\t"
+                     "movdqu %%xmm0, 16(%0)\n\t"
+                     "movdqu %%xmm0, 32(%0)\n\t"
+                     "movdqu %%xmm0, 48(%0)\n\t"
+                     "add $64, %0\n\t"
+                     "dec %1\n\t"
+                     "jnz 1b"
+                     : "+r"(d), "+r"(blocks), "=m"(*(char(*)[n])dst)
+                     : "r"(pattern)
+                     : "xmm0", "cc");
+        vec_end(flags);
+    }
+    set_small(d, pattern, n & 63);
     return dst;
 }
 
-char *strcat(char *dst, const char *src)
+static void *set_avx2(void *dst, int c, size_t n)
 {
-    char *d = dst;
-    while (*d)
-        d++;
-    while ((*d++ = *src++))
-        ;
+    unsigned char *d = (unsigned char *)dst;
+    uint64_t pattern = byte_pattern(c);
+    size_t blocks = n >> 6;
+    if (blocks)
+    {
+        unsigned long flags = vec_begin();
+        asm volatile("vmovq %3, %%xmm0\n\t"
+                     "vpbroadcastq %%xmm0, %%ymm0\n"
+                     "1:\n\t"
+                     "vmovdqu %%ymm0,   (%0)\n\t"
+                     "vmovdqu %%ymm0, 32(%0)\n\t"
+                     "add $64, %0\n\t"
+                     "dec %1\n\t"
+                     "jnz 1b\n\t"
+                     "vzeroupper"
+                     : "+r"(d), "+r"(blocks), "=m"(*(char(*)[n])dst)
+                     : "r"(pattern)
+                     : "xmm0", "cc");
+        vec_end(flags);
+    }
+    set_small(d, pattern, n & 63);
     return dst;
 }
 
+/* --- таблица диспетчеризации --- */
+
+typedef struct
+{
+    const char *name;
+    copy_fn copy;
+    set_fn set;
+} mem_variant_t;
+
+enum
+{
+    MEM_BYTES,
+    MEM_REP_Q,
+    MEM_ERMS,
+    MEM_SSE2,
+    MEM_AVX2,
+    MEM_VARIANTS
+};
+
+static const mem_variant_t mem_variants[MEM_VARIANTS] = {
+    [MEM_BYTES] = {"bytes", copy_bytes, set_bytes},
+    [MEM_REP_Q] = {"movsq", copy_movsq, set_stosq},
+    [MEM_ERMS] = {"erms", copy_erms, set_erms},
+    [MEM_SSE2] = {"sse2", copy_sse2, set_sse2},
+    [MEM_AVX2] = {"avx2", copy_avx2, set_avx2},
+};
+
+static const mem_variant_t *mem_mid = &mem_variants[MEM_REP_Q];
+static const mem_variant_t *mem_large = &mem_variants[MEM_REP_Q];
+static int str_sse2 = 0; /* strlen/strcmp/memcmp/memchr: SSE2 после словного префикса */
+
+void string_init(void)
+{
+    /* Крупные копии — rep movsb с ERMS (микрокод сам берёт широкие пересылки,
+       прерывания не держит). Средние — rep movsb при FSRM, иначе самый
+       широкий вектор. */
+    mem_large = &mem_variants[cpu_features.erms ? MEM_ERMS : MEM_REP_Q];
+    if (cpu_features.fsrm)
+        mem_mid = &mem_variants[MEM_ERMS];
+    else if (cpu_features.avx2)
+        mem_mid = &mem_variants[MEM_AVX2];
+    else if (cpu_features.sse2)
+        mem_mid = &mem_variants[MEM_SSE2];
+    else
+        mem_mid = &mem_variants[MEM_REP_Q];
+
+    str_sse2 = cpu_features.sse2;
+}
+
+void *memcpy(void *dst, const void *src, size_t n)
+{
+    if (n < MEM_SMALL)
+        return copy_small(dst, src, n);
+    if (n < MEM_LARGE)
+        return mem_mid->copy(dst, src, n);
+    return mem_large->copy(dst, src, n);
+}
+
+void *memset(void *s, int c, size_t n)
+{
+    if (n < MEM_SMALL)
+        return set_small(s, byte_pattern(c), n);
+    if (n < MEM_LARGE)
+        return mem_mid->set(s, c, n);
+    return mem_large->set(s, c, n);
+}
+
+#ifdef DEBUG
+/* Байт за такт (x100) для каждого варианта на нескольких размерах.
+   Буферы берутся из kmalloc (крупные — страницы окна ядра), прогрев кэша
+   одним проходом перед замером. */
+#define MEMBENCH_MAX (1024 * 1024)
+#define MEMBENCH_BYTES (8 * 1024 * 1024) /* на точку: повторы до этого объёма */
+
+static int mem_supported(int v)
+{
+    switch (v)
+    {
+    case MEM_ERMS:
+        return cpu_features.erms;
+    case MEM_SSE2:
+        return cpu_features.sse2;
+    case MEM_AVX2:
+        return cpu_features.avx2;
+    default:
+        return 1;
+    }
+}
+
+void string_bench(void)
+{
+    static const size_t sizes[] = {64, 256, 1024, 4096, 65536, MEMBENCH_MAX};
+    const size_t nsizes = sizeof(sizes) / sizeof(sizes[0]);
+    unsigned char *src = malloc(MEMBENCH_MAX);
+    unsigned char *dst = malloc(MEMBENCH_MAX);
+    if (!src || !dst)
+        goto out;
+    memset(src, 0x5A, MEMBENCH_MAX);
+
+    /* Строка таблицы собирается целиком и выводится одной записью */
+    char line[80];
+    size_t len;
+    print_string_position("memcpy bytes/cycle x100", 0, 0, WHITE, BLACK);
+    len = (size_t)ksnprintf(line, sizeof(line), "%8s", "");
+    for (size_t i = 0; i < nsizes; ++i)
+        len += (size_t)ksnprintf(line + len, sizeof(line) - len, "%-8zu", sizes[i]);
+    print_string_position(line, 0, 1, WHITE, BLACK);
+
+    unsigned row = 2;
+    for (int v = 0; v < MEM_VARIANTS; ++v)
+    {
+        if (!mem_supported(v))
+            continue;
+        len = (size_t)ksnprintf(line, sizeof(line), "%-8s", mem_variants[v].name);
+        for (size_t i = 0; i < nsizes; ++i)
+        {
+            size_t n = sizes[i];
+            size_t reps = MEMBENCH_BYTES / n;
+            mem_variants[v].copy(dst, src, n);
+
+            unsigned long flags = vec_begin();
+            uint64_t t0 = rdtsc();
+            for (size_t r = 0; r < reps; ++r)
+                mem_variants[v].copy(dst, src, n);
+            uint64_t cycles = rdtsc() - t0;
+            vec_end(flags);
+
+            len += (size_t)ksnprintf(line + len, sizeof(line) - len, "%-8lu",
+                                     cycles ? (uint64_t)n * reps * 100 / cycles : 0);
+        }
+        print_string_position(line, 0, row++, WHITE, BLACK);
+    }
+    ksnprintf(line, sizeof(line), "mid: %-6s large: %s", mem_mid->name, mem_large->name);
+    print_string_position(line, 0, row, WHITE, BLACK);
+
+out:
+    free(src);
+    free(dst);
+}
+#endif // DEBUG
+
+/* =================== CMP/SCAN =================== */
+
+/* Слово за раз: has_zero отмечает старшим битом нулевые байты (младший
+   отмеченный — точно первый ноль). Строки длины не знают, поэтому читаем
+   слово, только если оно не пересекает границу страницы — за NUL может
+   начинаться неотображённая. */
+#define ONES 0x0101010101010101ULL
+#define HIGHS 0x8080808080808080ULL
+#define SCAN_PAGE 4096
+#define STR_WORD_PREFIX 64 /* столько байт строки — словами, дальше SSE2 */
+
+
+static inline uint64_t has_zero(uint64_t v)
+{
+    return (v - ONES) & ~v & HIGHS;
+}
+
+static inline size_t first_byte(uint64_t mask)
+{
+    return (size_t)__builtin_ctzll(mask) >> 3;
+}
+
+static inline int span_safe(const void *p, size_t width)
+{
+    return ((uintptr_t)p & (SCAN_PAGE - 1)) <= SCAN_PAGE - width;
+}
+
+static inline uint64_t load64(const void *p)
+{
+    return *(const u64_unaligned *)p;
+}
+
+/* --- SSE2: 16 байт за шаг, под тем же запретом прерываний, что и memcpy --- */
+
+/* Биты i: a[i] != b[i] или a[i] == 0 */
+static inline unsigned sse2_strdiff16(const void *a, const void *b)
+{
+    unsigned ne, z;
+    asm volatile("movdqu (%2), %%xmm0\n\t"
+                 "movdqu (%3), %%xmm1\n\t"
+                 "pxor %%xmm2, %%xmm2\n\t"
+                 "pcmpeqb %%xmm0, %%xmm2\n\t"
+                 "pcmpeqb %%xmm1, %%xmm0\n\t"
+                 "pmovmskb %%xmm0, %0\n\t"
+                 "pmovmskb %%xmm2, %1"
+                 : "=r"(ne), "=r"(z)
+                 : "r"(a), "r"(b)
+                 : "xmm0", "xmm1", "xmm2", "memory");
+    return (~ne | z) & 0xFFFF;
+}
+
+/* Биты i: a[i] != b[i] */
+static inline unsigned sse2_diff16(const void *a, const void *b)
+{
+    unsigned eq;
+    asm volatile("movdqu (%1), %%xmm0\n\t"
+                 "movdqu (%2), %%xmm1\n\t"
+                 "pcmpeqb %%xmm1, %%xmm0\n\t"
+                 "pmovmskb %%xmm0, %0"
+                 : "=r"(eq)
+                 : "r"(a), "r"(b)
+                 : "xmm0", "xmm1", "memory");
+    return ~eq & 0xFFFF;
+}
+
+/* Биты i: p[i] == c */
+static inline unsigned sse2_match16(const void *p, uint64_t pattern)
+{
+    unsigned m;
+    asm volatile("movq %2, %%xmm1\n\t"
+                 "punpcklqdq %%xmm1, %%xmm1\n\t"
+                 "movdqu (%1), %%xmm0\n\t"
+                 "pcmpeqb %%xmm1, %%xmm0\n\t"
+                 "pmovmskb %%xmm0, %0"
+                 : "=r"(m)
+                 : "r"(p), "r"(pattern)
+                 : "xmm0", "xmm1", "memory");
+    return m;
+}
+
+/* p выровнен на 16: выровненное чтение не выходит за страницу */
+static size_t strlen_sse2(const char *p)
+{
+    const char *q = p;
+    unsigned m;
+    unsigned long flags = vec_begin();
+    for (;; q += 16)
+    {
+        m = sse2_match16(q, 0);
+        if (m)
+            break;
+    }
+    vec_end(flags);
+    return (size_t)(q - p) + (size_t)__builtin_ctz(m);
+}
+
+static int strcmp_sse2(const unsigned char *a, const unsigned char *b)
+{
+    unsigned long flags = vec_begin();
+    for (;;)
+    {
+        if (span_safe(a, 16) && span_safe(b, 16))
+        {
+            unsigned m = sse2_strdiff16(a, b);
+            if (!m)
+            {
+                a += 16;
+                b += 16;
+                continue;
+            }
+            size_t i = (size_t)__builtin_ctz(m);
+            vec_end(flags);
+            return (int)a[i] - (int)b[i];
+        }
+        /* У границы страницы — 16 байт по одному */
+        for (int k = 0; k < 16; ++k, ++a, ++b)
+        {
+            if (*a != *b || !*a)
+            {
+                vec_end(flags);
+                return (int)*a - (int)*b;
+            }
+        }
+    }
+}
+
+/* --- word-at-a-time --- */
+
+size_t strlen(const char *s)
+{
+    const char *p = s;
+    while ((uintptr_t)p & 7)
+    {
+        if (!*p)
+            return (size_t)(p - s);
+        p++;
+    }
+
+    /* Выровненное слово никогда не пересекает страницу */
+    for (;; p += 8)
+    {
+        uint64_t z = has_zero(load64(p));
+        if (z)
+            return (size_t)(p - s) + first_byte(z);
+        if (str_sse2 && (size_t)(p - s) >= STR_WORD_PREFIX && !((uintptr_t)(p + 8) & 15))
+            return (size_t)(p + 8 - s) + strlen_sse2(p + 8);
+    }
+}
+
+size_t strnlen(const char *s, size_t n)
+{
+    size_t i = 0;
+    while (i < n && ((uintptr_t)(s + i) & 7))
+    {
+        if (!s[i])
+            return i;
+        i++;
+    }
+    for (; i + 8 <= n; i += 8)
+    {
+        uint64_t z = has_zero(load64(s + i));
+        if (z)
+            return i + first_byte(z);
+    }
+    while (i < n && s[i])
+        i++;
+    return i;
+}
+
 int strcmp(const char *a, const char *b)
 {
-    while (*a && (*a == *b))
+    const unsigned char *pa = (const unsigned char *)a;
+    const unsigned char *pb = (const unsigned char *)b;
+
+    for (size_t done = 0;; done += 8)
     {
-        a++;
-        b++;
+        if (str_sse2 && done >= STR_WORD_PREFIX)
+            return strcmp_sse2(pa, pb);
+        if (span_safe(pa, 8) && span_safe(pb, 8))
+        {
+            uint64_t wa = load64(pa), wb = load64(pb);
+            uint64_t m = (wa ^ wb) | has_zero(wa);
+            if (!m)
+            {
+                pa += 8;
+                pb += 8;
+                continue;
+            }
+        }
+        /* Разница, конец строки или граница страницы — в пределах этих 8 байт */
+        for (int k = 0; k < 8; ++k, ++pa, ++pb)
+        {
+            if (*pa != *pb || !*pa)
+                return (int)*pa - (int)*pb;
+        }
     }
-    return *(unsigned char *)a - *(unsigned char *)b;
 }
 
+/* Сравнение имён фиксированной длины (записи каталога ФС): слова, пока
+   оба указателя не у границы страницы и n позволяет */
 int strncmp(const char *a, const char *b, size_t n)
 {
-    for (size_t i = 0; i < n; i++)
+    const unsigned char *pa = (const unsigned char *)a;
+    const unsigned char *pb = (const unsigned char *)b;
+
+    while (n)
+    {
+        if (n >= 8 && span_safe(pa, 8) && span_safe(pb, 8))
+        {
+            uint64_t wa = load64(pa), wb = load64(pb);
+            if (!((wa ^ wb) | has_zero(wa)))
+            {
+                pa += 8;
+                pb += 8;
+                n -= 8;
+                continue;
+            }
+        }
+        size_t k = n < 8 ? n : 8;
+        for (; k; --k, --n, ++pa, ++pb)
+        {
+            if (*pa != *pb || !*pa)
+                return (int)*pa - (int)*pb;
+        }
+    }
+    return 0;
+}
+
+int memcmp(const void *a, const void *b, size_t n)
+{
+    const unsigned char *pa = (const unsigned char *)a;
+    const unsigned char *pb = (const unsigned char *)b;
+
+    /* Длина известна — читать можно все n байт, границы страниц не важны */
+    if (str_sse2 && n >= MEM_SMALL)
+    {
+        unsigned long flags = vec_begin();
+        for (; n >= 16; n -= 16, pa += 16, pb += 16)
+        {
+            unsigned m = sse2_diff16(pa, pb);
+            if (m)
+            {
+                size_t i = (size_t)__builtin_ctz(m);
+                vec_end(flags);
+                return (int)pa[i] - (int)pb[i];
+            }
+        }
+        vec_end(flags);
+    }
+    for (; n >= 8; n -= 8, pa += 8, pb += 8)
     {
-        if (a[i] != b[i])
-            return (unsigned char)a[i] - (unsigned char)b[i];
-        if (a[i] == '\0')
-            return 0;
+        uint64_t x = load64(pa) ^ load64(pb);
+        if (x)
+        {
+            size_t i = first_byte(x);
+            return (int)pa[i] - (int)pb[i];
+        }
+    }
+    for (; n; --n, ++pa, ++pb)
+    {
+        if (*pa != *pb)
+            return (int)*pa - (int)*pb;
     }
     return 0;
 }
 
+void *memchr(const void *s, int c, size_t n)
+{
+    const unsigned char *p = (const unsigned char *)s;
+    uint64_t pattern = byte_pattern(c);
+
+    if (str_sse2 && n >= MEM_SMALL)
+    {
+        unsigned long flags = vec_begin();
+        for (; n >= 16; n -= 16, p += 16)
+        {
+            unsigned m = sse2_match16(p, pattern);
+            if (m)
+            {
+                vec_end(flags);
+                return (void *)(p + __builtin_ctz(m));
+            }
+        }
+        vec_end(flags);
+    }
+    for (; n >= 8; n -= 8, p += 8)
+    {
+        uint64_t z = has_zero(load64(p) ^ pattern);
+        if (z)
+            return (void *)(p + first_byte(z));
+    }
+    for (; n; --n, ++p)
+    {
+        if (*p == (unsigned char)c)
+            return (void *)p;
+    }
+    return NULL;
+}
+
+/* =================== STR =================== */
+
+char *strcpy(char *dst, const char *src)
+{
+    memcpy(dst, src, strlen(src) + 1);
+    return dst;
+}
+
+char *strncpy(char *dst, const char *src, size_t n)
+{
+    size_t len = strnlen(src, n);
+    memcpy(dst, src, len);
+    memset(dst + len, 0, n - len);
+    return dst;
+}
+
+char *strcat(char *dst, const char *src)
+{
+    strcpy(dst + strlen(dst), src);
+    return dst;
+}
+
 char *strchr(const char *s, int c)
 {
     while (*s)
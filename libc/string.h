@@ -6,8 +6,17 @@
 
 void *memcpy(void *dst, const void *src, size_t n);
 void *memset(void *s, int c, size_t n);
+int memcmp(const void *a, const void *b, size_t n);
+void *memchr(const void *s, int c, size_t n);
+/* Выбрать варианты memcpy/memset по cpu_features (после cpu_init) */
+void string_init(void);
+#ifdef DEBUG
+/* Бенчмарк вариантов memcpy: байт за такт по размерам */
+void string_bench(void);
+#endif
 
 size_t strlen(const char *s);
+size_t strnlen(const char *s, size_t n);
 char *strcpy(char *dst, const char *src);
 char *strncpy(char *dst, const char *src, size_t n);
 char *strcat(char *dst, const char *src);
@@ -0,0 +1,35 @@
+// dma.c — физически непрерывные буферы для устройств
+#include "dma.h"
+#include "../vmm/vmm.h"
+#include "../libc/string.h"
+
+int dma_alloc(size_t size, size_t align, dma_buf_t *buf)
+{
+    if (!buf || size == 0)
+        return -1;
+    if (align & (align - 1))
+        return -1;
+
+    size_t pages = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+    size_t align_frames = (align > PAGE_SIZE) ? align / PAGE_SIZE : 1;
+
+    uint64_t phys = pmm_alloc_contig(pages, align_frames);
+    if (!phys)
+        return -1;
+
+    buf->phys = phys;
+    buf->virt = phys_to_virt(phys);
+    buf->size = pages * PAGE_SIZE;
+    memset(buf->virt, 0, buf->size);
+    return 0;
+}
+
+void dma_free(dma_buf_t *buf)
+{
+    if (!buf || !buf->size)
+        return;
+    pmm_free_contig(buf->phys, buf->size / PAGE_SIZE);
+    buf->virt = NULL;
+    buf->phys = 0;
+    buf->size = 0;
+}
@@ -0,0 +1,20 @@
+#ifndef DMA_H
+#define DMA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Буферы для DMA: физически непрерывные, выровнены минимум на страницу,
+   заполнены нулями. Лежат в identity-map, поэтому virt == phys_to_virt(phys). */
+typedef struct
+{
+    void *virt;
+    uint64_t phys;
+    size_t size; /* округлён вверх до страницы */
+} dma_buf_t;
+
+/* align — степень двойки; меньше страницы означает страницу. Возвращает 0 при успехе. */
+int dma_alloc(size_t size, size_t align, dma_buf_t *buf);
+void dma_free(dma_buf_t *buf);
+
+#endif // DMA_H
@@ -4,19 +4,25 @@
 #include <stddef.h>
 #include "../vga/vga.h"
 #include "../syscall/syscall.h"
+#include "../vmm/vmm.h"
+#include "../sync/spinlock.h"
+#include "../libc/kprintf.h"
+#include <stdarg.h>
 
 /* Конфигурация */
 #define ALIGN 8
 #define MAGIC 0xB16B00B5U
 
-/* Заголовок блока (payload идёт сразу после заголовка) */
+/* Заголовок блока (payload идёт сразу после заголовка).
+   magic и free упакованы в одно слово — место под site не увеличивает заголовок */
 typedef struct block_header
 {
     uint32_t magic;
-    size_t size; /* payload size в байтах */
     int free;    /* 1 если свободен, 0 если занят */
+    size_t size; /* payload size в байтах */
     struct block_header *prev;
     struct block_header *next;
+    void *site; /* адрес возврата вызвавшего malloc (профилировщик), NULL — не отслеживается */
 } block_header_t;
 
 #define MIN_SPLIT_SIZE (sizeof(block_header_t) + ALIGN)
@@ -27,6 +33,12 @@ static block_header_t *heap_tail = NULL;
 static void *managed_heap_end = NULL;
 static unsigned char *brk_ptr = NULL; /* текущий предел (bump pointer внутри области) */
 
+/* Замки: список блоков и brk_ptr; слоты крупных объектов; таблица профилировщика.
+   Порядок вложения: heap_lock/large_lock -> kprof_lock. */
+static spinlock_t heap_lock = SPINLOCK_INIT;
+static spinlock_t large_lock = SPINLOCK_INIT;
+static spinlock_t kprof_lock = SPINLOCK_INIT;
+
 /* Символы из link.ld */
 extern char _heap_start;
 extern char _heap_end;
@@ -34,6 +46,44 @@ extern char _heap_end;
 /* Внешние функции (реализованы в других файлах вашего ядра) */
 extern void *memcpy(void *dst, const void *src, size_t n);
 
+/* Профилировщик: агрегаты по call site (открытая адресация по адресу возврата) */
+static int kprof_enabled = 0;
+static kprof_site_t kprof_sites[KPROF_MAX_SITES];
+static uint64_t kprof_num_sites = 0;
+static uint64_t kprof_dropped = 0; /* события, не поместившиеся в таблицу */
+
+static void kprof_record(void *site, size_t bytes, int is_alloc);
+
+/* Крупные объекты (>= LARGE_THRESHOLD) не идут в список блоков: им выдаются
+   целые страницы в окне ядра. Окно нарезано на слоты по LARGE_SLOT_SIZE —
+   номер слота одновременно дескриптор и адрес объекта, поэтому free находит
+   его без поиска, а realloc растёт на месте до конца слота. Объект больше
+   слота занимает серию соседних, так что резерв окна растёт с размером;
+   когда realloc выходит за серию, объект переезжает в новую перестановкой
+   PTE, без копирования данных. Слот — 2 MiB, одна таблица страниц.
+   Нет серии слотов или фреймов — объект берётся из списка блоков. */
+#define LARGE_THRESHOLD (2 * PAGE_SIZE)
+#define LARGE_SLOT_SIZE (2ULL * 1024 * 1024)
+#define LARGE_SLOTS (KWIN_LARGE_SIZE / LARGE_SLOT_SIZE)
+
+typedef struct
+{
+    size_t size;  /* запрошенный размер (выровнен по ALIGN) */
+    size_t pages; /* отображено страниц */
+    size_t slots; /* длина серии; 0 — слот свободен или продолжает чужую серию */
+    void *site;
+} large_obj_t;
+
+static int large_enabled = 0; /* до vmm_init окна ещё нет — всё идёт в кучу */
+static large_obj_t large_objs[LARGE_SLOTS];
+static uint64_t large_bitmap[LARGE_SLOTS / 64]; /* 1 — слот занят */
+static size_t large_hint = 0;
+static size_t large_pages = 0;
+static size_t large_peak_pages = 0;
+static size_t large_failed = 0;   /* не хватило фреймов */
+static size_t large_no_slots = 0; /* не нашлось серии слотов */
+static size_t large_moves = 0; /* переезды realloc перестановкой PTE */
+
 static inline size_t align_up(size_t n)
 {
     return (n + (ALIGN - 1)) & ~(ALIGN - 1);
@@ -58,10 +108,15 @@ void malloc_init(void *heap_start, size_t heap_size)
     heap_head->size = heap_size - sizeof(block_header_t);
     heap_head->free = 1;
     heap_head->prev = heap_head->next = NULL;
+    heap_head->site = NULL;
 
     heap_tail = heap_head;
     managed_heap_end = (char *)heap_start + heap_size;
     brk_ptr = (unsigned char *)heap_start + heap_size; /* brk_ptr хранит верх резервируемой области */
+
+#ifdef KMALLOC_PROFILE
+    kmalloc_profile_enable(1);
+#endif
 }
 
 /* Вспомогательная: выделить память у движка morecore (bump) — без привязки к page allocator.
@@ -108,6 +163,7 @@ static void split_block(block_header_t *h, size_t req_size)
     block_header_t *newh = (block_header_t *)new_hdr_addr;
     newh->magic = MAGIC;
     newh->free = 1;
+    newh->site = NULL;
     newh->size = h->size - req_size - sizeof(block_header_t);
     newh->prev = h;
     newh->next = h->next;
@@ -159,6 +215,7 @@ static int heap_expand(size_t bytes)
     block_header_t *h = (block_header_t *)p;
     h->magic = MAGIC;
     h->free = 1;
+    h->site = NULL;
     h->size = need - sizeof(block_header_t);
     h->prev = heap_tail;
     h->next = NULL;
@@ -170,13 +227,399 @@ static int heap_expand(size_t bytes)
     return 1;
 }
 
-/* malloc */
-void *malloc(size_t size)
+/* Пометить блок как выделенный из site (учёт только при включённом профилировании) */
+static void tag_block(block_header_t *h, void *site)
+{
+    if (kprof_enabled)
+    {
+        h->site = site;
+        kprof_record(site, h->size, 1);
+    }
+    else
+    {
+        h->site = NULL;
+    }
+}
+
+static void untag_block(block_header_t *h)
+{
+    if (h->site)
+    {
+        if (kprof_enabled)
+            kprof_record(h->site, h->size, 0);
+        h->site = NULL;
+    }
+}
+
+/* ---- крупные объекты ---- */
+
+static inline int is_large(const void *p)
+{
+    uint64_t a = (uint64_t)(uintptr_t)p;
+    return a >= KWIN_LARGE_BASE && a < KWIN_LARGE_BASE + LARGE_SLOTS * LARGE_SLOT_SIZE;
+}
+
+static inline uint64_t large_va(size_t idx)
+{
+    return KWIN_LARGE_BASE + (uint64_t)idx * LARGE_SLOT_SIZE;
+}
+
+static inline size_t bytes_to_pages(size_t n)
+{
+    return (n + PAGE_SIZE - 1) / PAGE_SIZE;
+}
+
+static void large_account(long delta)
+{
+    unsigned long irq = spin_lock_irqsave(&large_lock);
+    large_pages += (size_t)delta;
+    if (large_pages > large_peak_pages)
+        large_peak_pages = large_pages;
+    spin_unlock_irqrestore(&large_lock, irq);
+}
+
+/* Снять страницы [from, to) объекта и вернуть фреймы.
+   Слот принадлежит вызывающему — таблицы окна защищает сам vmm_kunmap. */
+static void large_release(uint64_t va, size_t from, size_t to)
+{
+    for (size_t i = from; i < to; ++i)
+    {
+        uint64_t pa = vmm_kunmap(va + (uint64_t)i * PAGE_SIZE);
+        if (pa)
+            pmm_free_frame(pa);
+    }
+    large_account(-(long)(to - from));
+}
+
+/* Отобразить страницы [from, to). zero — брать обнулённые фреймы (из пула).
+   При нехватке фреймов откатывает свои и возвращает 0 */
+static int large_commit(uint64_t va, size_t from, size_t to, int zero)
+{
+    for (size_t i = from; i < to; ++i)
+    {
+        uint64_t pa = zero ? pmm_alloc_zeroed_frame() : pmm_alloc_frame();
+        if (!pa || vmm_kmap(va + (uint64_t)i * PAGE_SIZE, pa) != 0)
+        {
+            if (pa)
+                pmm_free_frame(pa);
+            large_account((long)(i - from));
+            large_release(va, from, i);
+            return 0;
+        }
+    }
+    large_account((long)(to - from));
+    return 1;
+}
+
+static void large_tag(large_obj_t *o, void *site)
+{
+    if (kprof_enabled)
+    {
+        o->site = site;
+        kprof_record(site, o->pages * PAGE_SIZE, 1);
+    }
+    else
+    {
+        o->site = NULL;
+    }
+}
+
+static void large_untag(large_obj_t *o)
+{
+    if (o->site)
+    {
+        if (kprof_enabled)
+            kprof_record(o->site, o->pages * PAGE_SIZE, 0);
+        o->site = NULL;
+    }
+}
+
+static void large_fail(size_t *counter)
+{
+    unsigned long irq = spin_lock_irqsave(&large_lock);
+    (*counter)++;
+    spin_unlock_irqrestore(&large_lock, irq);
+}
+
+static inline size_t bytes_to_slots(size_t n)
+{
+    return (size_t)((n + LARGE_SLOT_SIZE - 1) / LARGE_SLOT_SIZE);
+}
+
+/* Захватить n соседних свободных слотов (large_lock взят). -1 — серии нет.
+   Одиночный слот ищется по словам битмапа от подсказки, серия — подряд. */
+static long large_claim(size_t n)
+{
+    const size_t words = LARGE_SLOTS / 64;
+    if (n == 1)
+    {
+        for (size_t k = 0; k < words; ++k)
+        {
+            size_t w = (large_hint + k) % words;
+            if (large_bitmap[w] == ~0ULL)
+                continue;
+            size_t bit = (size_t)__builtin_ctzll(~large_bitmap[w]);
+            large_bitmap[w] |= 1ULL << bit;
+            large_hint = w;
+            return (long)(w * 64 + bit);
+        }
+        return -1;
+    }
+
+    size_t run = 0;
+    for (size_t i = 0; i < LARGE_SLOTS; ++i)
+    {
+        if (i % 64 == 0 && large_bitmap[i / 64] == ~0ULL)
+        {
+            run = 0;
+            i += 63; /* слово занято целиком */
+            continue;
+        }
+        if (large_bitmap[i / 64] & (1ULL << (i % 64)))
+        {
+            run = 0;
+            continue;
+        }
+        if (++run < n)
+            continue;
+        size_t first = i + 1 - n;
+        for (size_t j = first; j <= i; ++j)
+        {
+            large_bitmap[j / 64] |= 1ULL << (j % 64);
+            large_objs[j].slots = 0;
+        }
+        return (long)first;
+    }
+    return -1;
+}
+
+static void large_unclaim(size_t idx, size_t n)
+{
+    for (size_t j = idx; j < idx + n; ++j)
+        large_bitmap[j / 64] &= ~(1ULL << (j % 64));
+}
+
+/* Под замком только захват слотов; страницы отображаются уже без него.
+   NULL — нет слотов или фреймов, вызывающий идёт в список блоков */
+static void *large_alloc(size_t size, int zero, void *site)
+{
+    size_t slots = bytes_to_slots(size);
+    if (slots > LARGE_SLOTS)
+    {
+        large_fail(&large_no_slots);
+        return NULL;
+    }
+
+    unsigned long irq = spin_lock_irqsave(&large_lock);
+    long idx = large_claim(slots);
+    if (idx >= 0)
+    {
+        large_objs[idx].size = 0;
+        large_objs[idx].pages = 0;
+        large_objs[idx].slots = slots;
+        large_objs[idx].site = NULL;
+    }
+    else
+    {
+        large_no_slots++;
+    }
+    spin_unlock_irqrestore(&large_lock, irq);
+    if (idx < 0)
+        return NULL;
+
+    size_t pages = bytes_to_pages(size);
+    if (!large_commit(large_va((size_t)idx), 0, pages, zero))
+    {
+        irq = spin_lock_irqsave(&large_lock);
+        large_objs[idx].slots = 0;
+        large_unclaim((size_t)idx, slots);
+        large_failed++;
+        spin_unlock_irqrestore(&large_lock, irq);
+        return NULL;
+    }
+
+    large_obj_t *o = &large_objs[idx];
+    o->size = size;
+    o->pages = pages;
+    large_tag(o, site);
+    return (void *)(uintptr_t)large_va((size_t)idx);
+}
+
+/* Индекс слота для указателя или -1, если это не начало живого объекта */
+static long large_index(const void *p)
+{
+    uint64_t off = (uint64_t)(uintptr_t)p - KWIN_LARGE_BASE;
+    size_t idx = (size_t)(off / LARGE_SLOT_SIZE);
+    if (off % LARGE_SLOT_SIZE)
+        return -1;
+
+    unsigned long irq = spin_lock_irqsave(&large_lock);
+    int live = (large_bitmap[idx / 64] & (1ULL << (idx % 64))) != 0 && large_objs[idx].slots;
+    spin_unlock_irqrestore(&large_lock, irq);
+    return live ? (long)idx : -1;
+}
+
+/* Слоты освобождаются последними: до этого их страницы никто другой не отобразит */
+static void large_free(void *p)
+{
+    long idx = large_index(p);
+    if (idx < 0)
+        return; /* чужой указатель или повторное освобождение */
+
+    large_obj_t *o = &large_objs[idx];
+    large_untag(o);
+    large_release(large_va((size_t)idx), 0, o->pages);
+    o->size = o->pages = 0;
+
+    unsigned long irq = spin_lock_irqsave(&large_lock);
+    large_unclaim((size_t)idx, o->slots);
+    o->slots = 0;
+    spin_unlock_irqrestore(&large_lock, irq);
+}
+
+/* Объект перерос свою серию слотов: новая серия, недостающие страницы
+   отображаются там, а имеющиеся переносятся перестановкой PTE — O(страниц)
+   вместо O(байт) и без второй копии в памяти */
+static void *large_move(long idx, size_t new_size, void *site)
+{
+    large_obj_t *o = &large_objs[idx];
+    size_t slots = bytes_to_slots(new_size);
+    if (slots > LARGE_SLOTS)
+    {
+        large_fail(&large_no_slots);
+        return NULL;
+    }
+
+    unsigned long irq = spin_lock_irqsave(&large_lock);
+    long nidx = large_claim(slots);
+    spin_unlock_irqrestore(&large_lock, irq);
+    if (nidx < 0)
+    {
+        large_fail(&large_no_slots);
+        return NULL;
+    }
+
+    uint64_t from = large_va((size_t)idx);
+    uint64_t to = large_va((size_t)nidx);
+    size_t pages = bytes_to_pages(new_size);
+    int ok = large_commit(to, o->pages, pages, 0);
+    if (ok)
+    {
+        size_t moved = 0;
+        while (moved < o->pages &&
+               vmm_kmove(from + (uint64_t)moved * PAGE_SIZE, to + (uint64_t)moved * PAGE_SIZE) == 0)
+            moved++;
+        if (moved < o->pages)
+        {
+            /* Не хватило фреймов под таблицу страниц — возвращаем всё на место */
+            for (size_t i = 0; i < moved; ++i)
+                vmm_kmove(to + (uint64_t)i * PAGE_SIZE, from + (uint64_t)i * PAGE_SIZE);
+            large_release(to, o->pages, pages);
+            ok = 0;
+        }
+    }
+    if (!ok)
+    {
+        irq = spin_lock_irqsave(&large_lock);
+        large_unclaim((size_t)nidx, slots);
+        large_failed++;
+        spin_unlock_irqrestore(&large_lock, irq);
+        return NULL;
+    }
+
+    large_obj_t *n = &large_objs[nidx];
+    large_untag(o);
+    n->size = new_size;
+    n->pages = pages;
+    n->site = NULL;
+    large_tag(n, site);
+
+    irq = spin_lock_irqsave(&large_lock);
+    n->slots = slots;
+    large_unclaim((size_t)idx, o->slots);
+    o->size = o->pages = o->slots = 0;
+    large_moves++;
+    spin_unlock_irqrestore(&large_lock, irq);
+    return (void *)(uintptr_t)to;
+}
+
+/* realloc крупного объекта на месте, пока он помещается в свою серию слотов */
+static void *large_realloc(void *p, size_t new_size, void *site)
+{
+    long idx = large_index(p);
+    if (idx < 0)
+        return NULL;
+
+    large_obj_t *o = &large_objs[idx];
+    if (new_size > o->slots * LARGE_SLOT_SIZE)
+        return large_move(idx, new_size, site);
+
+    uint64_t va = large_va((size_t)idx);
+    size_t pages = bytes_to_pages(new_size);
+
+    if (pages > o->pages && !large_commit(va, o->pages, pages, 0))
+    {
+        large_fail(&large_failed);
+        return NULL;
+    }
+    large_untag(o);
+    if (pages < o->pages)
+        large_release(va, pages, o->pages);
+    o->pages = pages;
+    o->size = new_size;
+    large_tag(o, site);
+    return p;
+}
+
+void malloc_large_init(void)
+{
+    unsigned long irq = spin_lock_irqsave(&large_lock);
+    memset(large_objs, 0, sizeof(large_objs));
+    memset(large_bitmap, 0, sizeof(large_bitmap));
+    large_hint = 0;
+    large_pages = large_peak_pages = large_failed = large_no_slots = large_moves = 0;
+    large_enabled = 1;
+    spin_unlock_irqrestore(&large_lock, irq);
+}
+
+void get_kmalloc_large_stats(kmalloc_large_stats_t *st)
+{
+    if (!st)
+        return;
+    st->objects = 0;
+    st->requested_bytes = 0;
+
+    unsigned long irq = spin_lock_irqsave(&large_lock);
+    for (size_t i = 0; i < LARGE_SLOTS; ++i)
+    {
+        if (!(large_bitmap[i / 64] & (1ULL << (i % 64))) || !large_objs[i].slots)
+            continue;
+        st->objects++;
+        st->requested_bytes += large_objs[i].size;
+    }
+    st->committed_bytes = large_pages * PAGE_SIZE;
+    st->peak_committed = large_peak_pages * PAGE_SIZE;
+    st->failed = large_failed;
+    st->no_slots = large_no_slots;
+    st->moves = large_moves;
+    spin_unlock_irqrestore(&large_lock, irq);
+}
+
+static void *malloc_site(size_t size, int flags, void *site)
 {
     if (size == 0)
         return NULL;
     size = align_up(size);
+    /* KM_ATOMIC: только список блоков — без отображения страниц.
+       KM_ZERO для крупных — фреймы из пула обнулённых, без memset */
+    if (large_enabled && size >= LARGE_THRESHOLD && !(flags & KM_ATOMIC))
+    {
+        void *p = large_alloc(size, (flags & KM_ZERO) != 0, site);
+        if (p)
+            return p;
+    }
 
+    unsigned long irq = spin_lock_irqsave(&heap_lock);
     block_header_t *fit = find_fit(size);
     while (!fit)
     {
@@ -184,11 +627,113 @@ void *malloc(size_t size)
             break;
         fit = find_fit(size);
     }
-    if (!fit)
+    void *p = NULL;
+    if (fit)
+    {
+        split_block(fit, size);
+        fit->free = 0;
+        tag_block(fit, site);
+        p = header_to_payload(fit);
+    }
+    spin_unlock_irqrestore(&heap_lock, irq);
+    if (p && (flags & KM_ZERO))
+        memset(p, 0, size);
+    return p;
+}
+
+/* malloc */
+void *malloc(size_t size)
+{
+    return malloc_site(size, KM_NORMAL, __builtin_return_address(0));
+}
+
+void *kmalloc_flags(size_t size, int flags)
+{
+    return malloc_site(size, flags, __builtin_return_address(0));
+}
+
+/* Первый свободный блок, в котором помещается payload size с адресом, кратным align.
+   *lead — сколько байт от начала payload уходит в отдельный свободный блок
+   (0 или не меньше MIN_SPLIT_SIZE, чтобы там поместился заголовок). */
+static block_header_t *find_fit_aligned(size_t size, size_t align, size_t *lead)
+{
+    for (block_header_t *cur = heap_head; cur; cur = cur->next)
+    {
+        if (!cur->free)
+            continue;
+        uintptr_t p = (uintptr_t)header_to_payload(cur);
+        uintptr_t a = (p + align - 1) & ~(uintptr_t)(align - 1);
+        while (a != p && a - p < MIN_SPLIT_SIZE)
+            a += align;
+        if (cur->size >= (a - p) + size)
+        {
+            *lead = a - p;
+            return cur;
+        }
+    }
+    return NULL;
+}
+
+void *memalign(size_t align, size_t size)
+{
+    void *site = __builtin_return_address(0);
+    if (size == 0 || align == 0 || (align & (align - 1)))
         return NULL;
-    split_block(fit, size);
-    fit->free = 0;
-    return header_to_payload(fit);
+    if (align <= ALIGN)
+        return malloc_site(size, KM_NORMAL, site);
+
+    size = align_up(size);
+    /* Серии слотов выровнены на LARGE_SLOT_SIZE — любое align до него */
+    if (large_enabled && size >= LARGE_THRESHOLD && align <= LARGE_SLOT_SIZE)
+    {
+        void *p = large_alloc(size, 0, site);
+        if (p)
+            return p;
+    }
+
+    unsigned long irq = spin_lock_irqsave(&heap_lock);
+    size_t lead = 0;
+    block_header_t *fit = find_fit_aligned(size, align, &lead);
+    while (!fit)
+    {
+        if (!heap_expand(size + align + MIN_SPLIT_SIZE))
+            break;
+        fit = find_fit_aligned(size, align, &lead);
+    }
+
+    void *p = NULL;
+    if (fit)
+    {
+        if (lead)
+        {
+            /* Голову блока оставляем свободной, заголовок — прямо перед выровненным payload */
+            block_header_t *h = (block_header_t *)((char *)header_to_payload(fit) + lead - sizeof(block_header_t));
+            h->magic = MAGIC;
+            h->free = 1;
+            h->site = NULL;
+            h->size = fit->size - lead;
+            h->prev = fit;
+            h->next = fit->next;
+            if (h->next)
+                h->next->prev = h;
+            fit->next = h;
+            fit->size = lead - sizeof(block_header_t);
+            if (heap_tail == fit)
+                heap_tail = h;
+            fit = h;
+        }
+        split_block(fit, size);
+        fit->free = 0;
+        tag_block(fit, site);
+        p = header_to_payload(fit);
+    }
+    spin_unlock_irqrestore(&heap_lock, irq);
+    return p;
+}
+
+void *aligned_alloc(size_t align, size_t size)
+{
+    return memalign(align, size);
 }
 
 /* free */
@@ -196,79 +741,142 @@ void free(void *ptr)
 {
     if (!ptr)
         return;
+    if (is_large(ptr))
+    {
+        large_free(ptr);
+        return;
+    }
 
     block_header_t *h = payload_to_header(ptr);
+    unsigned long irq = spin_lock_irqsave(&heap_lock);
 
-    /* проверяем magic */
-    if (h->magic != MAGIC)
-        return; /* повреждённый или неверный указатель */
+    /* проверяем magic и многократное освобождение */
+    if (h->magic == MAGIC && !h->free)
+    {
+        untag_block(h);
+        h->free = 1;
 
-    /* проверка на многократное освобождение */
-    if (h->free)
-        return; /* уже свободен, ничего не делаем */
+        /* объединяем соседние свободные блоки */
+        coalesce(h);
+    }
+    spin_unlock_irqrestore(&heap_lock, irq);
+}
 
-    h->free = 1;
+/* Полезный размер живого объекта или 0 для чужого/освобождённого указателя */
+size_t kmalloc_usable_size(void *ptr)
+{
+    if (!ptr)
+        return 0;
+    if (is_large(ptr))
+    {
+        long idx = large_index(ptr);
+        return idx < 0 ? 0 : large_objs[idx].size;
+    }
+
+    block_header_t *h = payload_to_header(ptr);
+    unsigned long irq = spin_lock_irqsave(&heap_lock);
+    size_t size = (h->magic == MAGIC && !h->free) ? h->size : 0;
+    spin_unlock_irqrestore(&heap_lock, irq);
+    return size;
+}
+
+/* Расширить блок на месте за счёт следующих свободных (heap_lock взят). 1 — получилось */
+static int grow_in_place(block_header_t *h, size_t new_size, void *site)
+{
+    if (!h->next || !h->next->free)
+        return 0;
 
-    /* объединяем соседние свободные блоки */
-    coalesce(h);
+    size_t sum = h->size;
+    block_header_t *cur = h->next;
+    while (cur && cur->free && sum < new_size)
+    {
+        sum += sizeof(block_header_t) + cur->size;
+        cur = cur->next;
+    }
+    if (sum < new_size)
+        return 0;
+
+    /* объединяем до cur_prev */
+    untag_block(h);
+    block_header_t *to = h->next;
+    while (to && to->free && h->size < new_size)
+    {
+        h->size = h->size + sizeof(block_header_t) + to->size;
+        if (heap_tail == to)
+            heap_tail = h;
+        to = to->next;
+    }
+    h->next = to;
+    if (to)
+        to->prev = h;
+    split_block(h, new_size);
+    h->free = 0;
+    tag_block(h, site);
+    return 1;
 }
 
 /* realloc */
 void *realloc(void *ptr, size_t new_size)
 {
+    void *site = __builtin_return_address(0);
+
     if (!ptr)
-        return malloc(new_size);
+        return malloc_site(new_size, KM_NORMAL, site);
     if (new_size == 0)
     {
         free(ptr);
         return NULL;
     }
 
+    new_size = align_up(new_size);
+    if (is_large(ptr))
+    {
+        void *newp = large_realloc(ptr, new_size, site);
+        if (newp)
+            return newp;
+        size_t old_size = kmalloc_usable_size(ptr);
+        if (!old_size)
+            return NULL;
+        /* Окну не хватило слотов или фреймов — переезд в список блоков
+           копированием (KM_ATOMIC: окно уже не помогло) */
+        newp = malloc_site(new_size, KM_ATOMIC, site);
+        if (!newp)
+            return NULL;
+        memcpy(newp, ptr, old_size < new_size ? old_size : new_size);
+        free(ptr);
+        return newp;
+    }
+
     block_header_t *h = payload_to_header(ptr);
-    if (h->magic != MAGIC)
+    unsigned long irq = spin_lock_irqsave(&heap_lock);
+    if (h->magic != MAGIC || h->free)
+    {
+        spin_unlock_irqrestore(&heap_lock, irq);
         return NULL;
+    }
 
-    new_size = align_up(new_size);
     if (new_size <= h->size)
     {
+        untag_block(h);
         split_block(h, new_size);
+        tag_block(h, site);
+        spin_unlock_irqrestore(&heap_lock, irq);
         return ptr;
     }
-
-    /* Попытка расширить in-place за счёт следующего свободного блока(ов) */
-    if (h->next && h->next->free)
+    if (grow_in_place(h, new_size, site))
     {
-        size_t sum = h->size;
-        block_header_t *cur = h->next;
-        while (cur && cur->free && sum < new_size)
-        {
-            sum += sizeof(block_header_t) + cur->size;
-            cur = cur->next;
-        }
-        if (sum >= new_size)
-        {
-            /* объединяем до cur_prev */
-            block_header_t *to = h->next;
-            while (to && to->free && h->size < new_size)
-            {
-                h->size = h->size + sizeof(block_header_t) + to->size;
-                to = to->next;
-            }
-            h->next = to;
-            if (to)
-                to->prev = h;
-            split_block(h, new_size);
-            h->free = 0;
-            return ptr;
-        }
+        spin_unlock_irqrestore(&heap_lock, irq);
+        return ptr;
     }
+    size_t old_size = h->size;
+    spin_unlock_irqrestore(&heap_lock, irq);
 
-    /* Нельзя in-place — выделяем новый, копируем и освобождаем старый */
-    void *newp = malloc(new_size);
+    /* Нельзя in-place — выделяем новый, копируем и освобождаем старый.
+       Копирование без замка: старый блок всё ещё принадлежит вызывающему */
+    void *newp = malloc_site(new_size, KM_NORMAL, site);
     if (!newp)
         return NULL;
-    size_t copy = (h->size < new_size) ? h->size : new_size;
-    memcpy(newp, ptr, copy);
+    memcpy(newp, ptr, old_size);
     free(ptr);
     return newp;
 }
@@ -287,6 +895,7 @@ void get_kmalloc_stats(kmalloc_stats_t *st)
     st->largest_free = 0;
     st->num_blocks = st->num_used = st->num_free = 0;
 
+    unsigned long irq = spin_lock_irqsave(&heap_lock);
     block_header_t *cur = heap_head;
     while (cur)
     {
@@ -306,116 +915,192 @@ void get_kmalloc_stats(kmalloc_stats_t *st)
         }
         cur = cur->next;
     }
+    spin_unlock_irqrestore(&heap_lock, irq);
 }
 
-static size_t kstrlen(const char *s)
+/* ---- профилировщик аллокаций ---- */
+
+void kmalloc_profile_enable(int on)
 {
-    size_t i = 0;
-    if (!s)
-        return 0;
-    while (s[i])
-        ++i;
-    return i;
+    unsigned long irq = spin_lock_irqsave(&kprof_lock);
+    if (on && !kprof_enabled)
+    {
+        /* новая сессия — счётчики с нуля */
+        memset(kprof_sites, 0, sizeof(kprof_sites));
+        kprof_num_sites = 0;
+        kprof_dropped = 0;
+    }
+    kprof_enabled = on ? 1 : 0;
+    spin_unlock_irqrestore(&kprof_lock, irq);
 }
 
-/* Перевод unsigned -> строка десятичная (buf размером >= 32) */
-static char *u32_to_dec(uint32_t v, char *buf)
+int kmalloc_profile_enabled(void)
 {
-    char tmp[32];
-    int i = 0;
-    if (v == 0)
+    return kprof_enabled;
+}
+
+static void kprof_record(void *site, size_t bytes, int is_alloc)
+{
+    uint64_t key = (uint64_t)(uintptr_t)site;
+    size_t slot = (size_t)((key >> 2) * 0x9E3779B97F4A7C15ULL >> 58) % KPROF_MAX_SITES;
+    unsigned long irq = spin_lock_irqsave(&kprof_lock);
+
+    for (size_t n = 0; n < KPROF_MAX_SITES; ++n)
     {
-        buf[0] = '0';
-        buf[1] = '\0';
-        return buf;
+        kprof_site_t *e = &kprof_sites[(slot + n) % KPROF_MAX_SITES];
+        if (e->site == 0)
+        {
+            if (!is_alloc)
+                break; /* освобождение блока из неизвестного site */
+            e->site = key;
+            kprof_num_sites++;
+        }
+        if (e->site != key)
+            continue;
+
+        if (is_alloc)
+        {
+            e->allocs++;
+            e->bytes_allocated += bytes;
+            e->live_bytes += bytes;
+        }
+        else
+        {
+            e->frees++;
+            e->live_bytes = (e->live_bytes > bytes) ? e->live_bytes - bytes : 0;
+        }
+        spin_unlock_irqrestore(&kprof_lock, irq);
+        return;
     }
-    while (v)
+    kprof_dropped++;
+    spin_unlock_irqrestore(&kprof_lock, irq);
+}
+
+/* Номер корзины гистограммы: [16 << i, 32 << i), последняя — всё, что больше */
+static int hist_bucket(size_t size)
+{
+    int b = 0;
+    size >>= 5;
+    while (size && b < KPROF_HIST_BUCKETS - 1)
+    {
+        size >>= 1;
+        b++;
+    }
+    return b;
+}
+
+void get_kmalloc_profile(kmalloc_profile_t *p)
+{
+    if (!p)
+        return;
+    memset(p, 0, sizeof(*p));
+    unsigned long irq = spin_lock_irqsave(&kprof_lock);
+    p->enabled = (uint64_t)kprof_enabled;
+    p->dropped = kprof_dropped;
+
+    /* sites — по убыванию live_bytes (вставками, таблица маленькая) */
+    for (size_t i = 0; i < KPROF_MAX_SITES; ++i)
     {
-        tmp[i++] = '0' + (v % 10);
-        v /= 10;
+        if (!kprof_sites[i].site)
+            continue;
+        size_t j = (size_t)p->num_sites++;
+        while (j > 0 && p->sites[j - 1].live_bytes < kprof_sites[i].live_bytes)
+        {
+            p->sites[j] = p->sites[j - 1];
+            j--;
+        }
+        p->sites[j] = kprof_sites[i];
+    }
+    spin_unlock_irqrestore(&kprof_lock, irq);
+
+    /* Гистограмма свободных блоков и индекс фрагментации */
+    irq = spin_lock_irqsave(&heap_lock);
+    for (block_header_t *cur = heap_head; cur; cur = cur->next)
+    {
+        if (!cur->free)
+            continue;
+        p->free_hist[hist_bucket(cur->size)]++;
+        p->free_total += cur->size;
+        if (cur->size > p->largest_free)
+            p->largest_free = cur->size;
     }
-    for (int j = 0; j < i; ++j)
-        buf[j] = tmp[i - 1 - j];
-    buf[i] = '\0';
-    return buf;
+    spin_unlock_irqrestore(&heap_lock, irq);
+    /* 0 — вся свободная память одним куском, 1000 — раздроблена в пыль */
+    p->frag_permille = p->free_total ? 1000 - (p->largest_free * 1000) / p->free_total : 0;
 }
 
-/* Печать статистики в читаемом виде.
-   Использует console_puts(const char *s) — объявлен вверху extern. */
+/* Печать статистики в читаемом виде: строки с (20, 10) вниз */
 void print_kmalloc_stats(void)
 {
     kmalloc_stats_t s;
     get_kmalloc_stats(&s);
 
-    char nbuf[64];
-    const uint32_t base_x = 20; /* отступ по X (в символах) */
-    uint32_t x = base_x;
-    uint32_t y = 10; /* стартовая строка по Y — при желании измените */
-    const uint8_t fg = WHITE;
-    const uint8_t bg = BLACK;
-
-    /* Line 1: "Heap total: <bytes> bytes (<mb> MiB)" */
-    x = base_x;
-    print_string_position("Heap total: ", x, y, fg, bg);
-    x += (uint32_t)kstrlen("Heap total: ");
-    u32_to_dec((uint32_t)s.total_managed, nbuf);
-    print_string_position(nbuf, x, y, fg, bg);
-    x += (uint32_t)kstrlen(nbuf);
-    print_string_position(" bytes (", x, y, fg, bg);
-    x += (uint32_t)kstrlen(" bytes (");
-    uint32_t mb = (uint32_t)(s.total_managed / (1024 * 1024));
-    u32_to_dec(mb, nbuf);
-    print_string_position(nbuf, x, y, fg, bg);
-    x += (uint32_t)kstrlen(nbuf);
-    print_string_position(" MiB)", x, y, fg, bg);
-
-    /* next line */
-    ++y;
-
-    /* Line 2: "Used: <bytes>" */
-    x = base_x;
-    print_string_position("Used: ", x, y, fg, bg);
-    x += (uint32_t)kstrlen("Used: ");
-    u32_to_dec((uint32_t)s.used_payload, nbuf);
-    print_string_position(nbuf, x, y, fg, bg);
-
-    ++y;
-
-    /* Line 3: "Free: <bytes>" */
-    x = base_x;
-    print_string_position("Free: ", x, y, fg, bg);
-    x += (uint32_t)kstrlen("Free: ");
-    u32_to_dec((uint32_t)s.free_payload, nbuf);
-    print_string_position(nbuf, x, y, fg, bg);
-
-    ++y;
-
-    /* Line 4: "Largest free: <bytes>" */
-    x = base_x;
-    print_string_position("Largest free: ", x, y, fg, bg);
-    x += (uint32_t)kstrlen("Largest free: ");
-    u32_to_dec((uint32_t)s.largest_free, nbuf);
-    print_string_position(nbuf, x, y, fg, bg);
-
-    ++y;
-
-    /* Line 5: "Blocks: <num> (used=<u>, free=<f>)" */
-    x = base_x;
-    print_string_position("Blocks: ", x, y, fg, bg);
-    x += (uint32_t)kstrlen("Blocks: ");
-    u32_to_dec((uint32_t)s.num_blocks, nbuf);
-    print_string_position(nbuf, x, y, fg, bg);
-    x += (uint32_t)kstrlen(nbuf);
-    print_string_position(" (used=", x, y, fg, bg);
-    x += (uint32_t)kstrlen(" (used=");
-    u32_to_dec((uint32_t)s.num_used, nbuf);
-    print_string_position(nbuf, x, y, fg, bg);
-    x += (uint32_t)kstrlen(nbuf);
-    print_string_position(", free=", x, y, fg, bg);
-    x += (uint32_t)kstrlen(", free=");
-    u32_to_dec((uint32_t)s.num_free, nbuf);
-    print_string_position(nbuf, x, y, fg, bg);
-    print_string_position(")", x + (uint32_t)kstrlen(nbuf), y, fg, bg);
-
-    /* закончено — следующая полезная строка будет на y+1 */
-}
\ No newline at end of file
+    kprintf_at(20, 10, WHITE, BLACK,
+               "Heap total: %zu bytes (%zu MiB)\n"
+               "Used: %zu\n"
+               "Free: %zu\n"
+               "Largest free: %zu\n"
+               "Blocks: %zu (used=%zu, free=%zu)",
+               s.total_managed, s.total_managed / (1024 * 1024),
+               s.used_payload, s.free_payload, s.largest_free,
+               s.num_blocks, s.num_used, s.num_free);
+}
+/* ---- текстовый отчёт профилировщика (рисует htop) ---- */
+
+typedef struct
+{
+    char *buf;
+    size_t size;
+    size_t len;
+} report_t;
+
+/* Дописать в отчёт; то, что не влезло, отбрасывается, len не выходит за буфер */
+__attribute__((format(printf, 2, 3))) static void rep_printf(report_t *r, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int n = kvsnprintf(r->buf + r->len, r->size - r->len, fmt, ap);
+    va_end(ap);
+    r->len += (size_t)n < r->size - r->len ? (size_t)n : r->size - r->len - 1;
+}
+
+static kmalloc_profile_t report_snapshot; /* ~3 KiB — не на стеке ядра */
+
+size_t kmalloc_profile_report(char *buf, size_t size)
+{
+    if (!buf || size == 0)
+        return 0;
+
+    report_t r = {buf, size, 0};
+    buf[0] = '\0';
+    kmalloc_profile_t *p = &report_snapshot;
+    get_kmalloc_profile(p);
+
+    rep_printf(&r, "frag: %lu/1000  free: %lu  largest: %lu\nfree blocks by size:",
+               p->frag_permille, p->free_total, p->largest_free);
+    for (int i = 0; i < KPROF_HIST_BUCKETS; ++i)
+    {
+        if (p->free_hist[i])
+            rep_printf(&r, " %u%s%lu", 16u << i, (i == KPROF_HIST_BUCKETS - 1) ? "+:" : ":",
+                       p->free_hist[i]);
+    }
+
+    kmalloc_large_stats_t ls;
+    get_kmalloc_large_stats(&ls);
+    rep_printf(&r, "\nlarge: %zu objs, %zu KiB (peak %zu KiB), %zu moved\n",
+               ls.objects, ls.committed_bytes / 1024, ls.peak_committed / 1024, ls.moves);
+
+    if (!p->enabled)
+    {
+        rep_printf(&r, "call-site profiling: off\n");
+        return r.len;
+    }
+
+    rep_printf(&r, "site                 allocs   frees    live\n");
+    for (uint64_t i = 0; i < p->num_sites && i < KPROF_REPORT_SITES; ++i)
+    {
+        kprof_site_t *e = &p->sites[i];
+        rep_printf(&r, "0x%016lX   %-9lu%-9lu%lu\n", e->site, e->allocs, e->frees, e->live_bytes);
+    }
+    return r.len;
+}
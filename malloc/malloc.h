@@ -2,6 +2,7 @@
 #define KERNEL_MALLOC_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include "../libc/string.h"
 
 /* структура статистики */
@@ -16,11 +17,71 @@ typedef struct
     size_t num_free;
 } kmalloc_stats_t;
 
+/* Крупные объекты: целые страницы в окне ядра, мимо списка блоков */
+typedef struct
+{
+    size_t objects;
+    size_t requested_bytes;
+    size_t committed_bytes; /* отображённые страницы */
+    size_t peak_committed;
+    size_t failed;   /* запросы, на которые не хватило фреймов */
+    size_t no_slots; /* запросы, на которые не нашлось серии слотов окна */
+    size_t moves;  /* realloc за пределы серии слотов: переезд перестановкой PTE */
+} kmalloc_large_stats_t;
+
+/* Профилировщик аллокаций по call site (opt-in: -DKMALLOC_PROFILE или syscall) */
+#define KPROF_MAX_SITES 64
+#define KPROF_HIST_BUCKETS 16 /* свободные блоки: [16 << i, 32 << i) байт */
+#define KPROF_REPORT_SITES 8  /* строк в текстовом отчёте */
+
+typedef struct
+{
+    uint64_t site; /* адрес возврата в вызывающий код */
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t bytes_allocated;
+    uint64_t live_bytes;
+} kprof_site_t;
+
+typedef struct
+{
+    uint64_t enabled;
+    uint64_t num_sites;
+    uint64_t dropped;
+    kprof_site_t sites[KPROF_MAX_SITES]; /* по убыванию live_bytes */
+    uint64_t free_hist[KPROF_HIST_BUCKETS];
+    uint64_t free_total;
+    uint64_t largest_free;
+    uint64_t frag_permille; /* 1000 * (1 - largest_free / free_total) */
+} kmalloc_profile_t;
+
+/* Флаги kmalloc_flags. Куча защищена спинлоками с запретом прерываний,
+   поэтому malloc/free можно звать из любого контекста. KM_ATOMIC — для
+   обработчиков прерываний: только список блоков, время работы ограничено. */
+#define KM_NORMAL 0x0
+#define KM_ATOMIC 0x1 /* из обработчика прерывания: без отображения страниц окна */
+#define KM_ZERO 0x2   /* обнулить выделенную память */
+
 void malloc_init(void *heap_start, size_t heap_size);
 void *malloc(size_t size);
+void *kmalloc_flags(size_t size, int flags);
+/* Адрес кратен align (степень двойки). Крупные объекты выровнены минимум на страницу. */
+void *memalign(size_t align, size_t size);
+void *aligned_alloc(size_t align, size_t size);
 void free(void *ptr);
 void *realloc(void *ptr, size_t new_size);
+size_t kmalloc_usable_size(void *ptr);
 void print_kmalloc_stats(void);
 void get_kmalloc_stats(kmalloc_stats_t *st);
 
+/* Включить путь крупных объектов (после vmm_init: нужно окно ядра) */
+void malloc_large_init(void);
+void get_kmalloc_large_stats(kmalloc_large_stats_t *st);
+
+void kmalloc_profile_enable(int on);
+int kmalloc_profile_enabled(void);
+void get_kmalloc_profile(kmalloc_profile_t *p);
+/* Отчёт текстом (строки через '\n'), возвращает длину */
+size_t kmalloc_profile_report(char *buf, size_t size);
+
 #endif // KERNEL_MALLOC_H
\ No newline at end of file
@@ -1,11 +1,15 @@
-// user_malloc.c — simple allocator для .user области
+// user_malloc.c — simple allocator для .user области + арены задач
 #include "user_malloc.h"
 #include "../vga/vga.h"
 #include "../syscall/syscall.h"
+#include "../multitask/multitask.h"
+#include "../sync/spinlock.h"
 
 /* Конфигурация */
 #define ALIGN 8
 #define MAGIC 0xC0FFEE00U
+#define ARENA_BLOCK_MAGIC 0xC0FFEEA0U /* блоки внутри арен: глобальный user_free их не примет */
+#define ARENA_MAGIC 0xA4E4A000U
 #define MIN_SPLIT_SIZE (sizeof(user_block_t) + ALIGN)
 
 /* Заголовок блока */
@@ -18,14 +22,41 @@ typedef struct user_block
     struct user_block *next;
 } user_block_t;
 
+/* Список блоков одной непрерывной области */
+typedef struct user_heap
+{
+    user_block_t *head;
+    user_block_t *tail;
+    uint32_t magic; /* magic блоков этого списка */
+} user_heap_t;
+
+/* Кусок арены: вырезается из глобальной области одним блоком */
+typedef struct user_chunk
+{
+    struct user_chunk *next;
+    unsigned char *start; /* payload-область кусока (для поиска по адресу) */
+    unsigned char *end;
+    user_heap_t heap;
+} user_chunk_t;
+
+struct user_arena
+{
+    uint32_t magic;
+    int pid;
+    spinlock_t lock; /* блоки кусков и список кусков */
+    user_chunk_t *chunks;
+    size_t bytes; /* занято кусками в .user области */
+    size_t limit; /* квота задачи на куски, 0 — без ограничения */
+};
+
 /* Символы из link.ld (.user section) */
 extern char _user_start;
 extern char _user_end;
 
 /* Глобальные */
-static user_block_t *user_head = NULL;
-static user_block_t *user_tail = NULL;
+static user_heap_t user_region = {NULL, NULL, MAGIC};
 static unsigned char *user_brk = NULL; /* bump pointer */
+static spinlock_t region_lock = SPINLOCK_INIT; /* user_region: общие блоки и куски арен */
 
 static inline size_t align_up(size_t n)
 {
@@ -43,28 +74,33 @@ static inline user_block_t *payload_to_header(void *p)
 /* Инициализация allocator */
 void user_malloc_init(void)
 {
-    if (user_head)
+    unsigned long irq = spin_lock_irqsave(&region_lock);
+    if (user_region.head)
+    {
+        spin_unlock_irqrestore(&region_lock, irq);
         return; /* уже инициализировано */
+    }
 
-    user_head = (user_block_t *)&_user_start;
-    user_head->magic = MAGIC;
-    user_head->size = (size_t)(&_user_end - &_user_start) - sizeof(user_block_t);
-    user_head->free = 1;
-    user_head->prev = user_head->next = NULL;
-    user_tail = user_head;
+    user_block_t *h = (user_block_t *)&_user_start;
+    h->magic = MAGIC;
+    h->size = (size_t)(&_user_end - &_user_start) - sizeof(user_block_t);
+    h->free = 1;
+    h->prev = h->next = NULL;
+    user_region.head = user_region.tail = h;
 
     user_brk = (unsigned char *)&_user_end;
+    spin_unlock_irqrestore(&region_lock, irq);
 }
 
 /* split блока */
-static void split_block(user_block_t *h, size_t req_size)
+static void split_block(user_heap_t *hp, user_block_t *h, size_t req_size)
 {
     if (h->size < req_size + MIN_SPLIT_SIZE)
         return;
 
     char *new_hdr_addr = (char *)header_to_payload(h) + req_size;
     user_block_t *newh = (user_block_t *)new_hdr_addr;
-    newh->magic = MAGIC;
+    newh->magic = hp->magic;
     newh->free = 1;
     newh->size = h->size - req_size - sizeof(user_block_t);
     newh->prev = h;
@@ -73,12 +109,12 @@ static void split_block(user_block_t *h, size_t req_size)
         newh->next->prev = newh;
     h->next = newh;
     h->size = req_size;
-    if (user_tail == h)
-        user_tail = newh;
+    if (hp->tail == h)
+        hp->tail = newh;
 }
 
 /* coalesce */
-static void coalesce(user_block_t *h)
+static void coalesce(user_heap_t *hp, user_block_t *h)
 {
     if (!h)
         return;
@@ -89,8 +125,8 @@ static void coalesce(user_block_t *h)
         h->next = n->next;
         if (n->next)
             n->next->prev = h;
-        if (user_tail == n)
-            user_tail = h;
+        if (hp->tail == n)
+            hp->tail = h;
     }
     if (h->prev && h->prev->free)
     {
@@ -99,16 +135,16 @@ static void coalesce(user_block_t *h)
         p->next = h->next;
         if (h->next)
             h->next->prev = p;
-        if (user_tail == h)
-            user_tail = p;
+        if (hp->tail == h)
+            hp->tail = p;
         h = p;
     }
 }
 
 /* find first-fit */
-static user_block_t *find_fit(size_t size)
+static user_block_t *find_fit(user_heap_t *hp, size_t size)
 {
-    user_block_t *cur = user_head;
+    user_block_t *cur = hp->head;
     while (cur)
     {
         if (cur->free && cur->size >= size)
@@ -118,23 +154,292 @@ static user_block_t *find_fit(size_t size)
     return NULL;
 }
 
+static void *heap_alloc(user_heap_t *hp, size_t size)
+{
+    user_block_t *fit = find_fit(hp, size);
+    if (!fit)
+        return NULL;
+
+    split_block(hp, fit, size);
+    fit->free = 0;
+    return header_to_payload(fit);
+}
+
+static void heap_free(user_heap_t *hp, user_block_t *h)
+{
+    h->free = 1;
+    coalesce(hp, h);
+}
+
+/* Расширить блок in-place за счёт следующего свободного. 1 — получилось */
+static int heap_grow_in_place(user_heap_t *hp, user_block_t *h, size_t new_size)
+{
+    if (h->next && h->next->free && (h->size + sizeof(user_block_t) + h->next->size) >= new_size)
+    {
+        if (hp->tail == h->next)
+            hp->tail = h;
+        h->size += sizeof(user_block_t) + h->next->size;
+        h->next = h->next->next;
+        if (h->next)
+            h->next->prev = h;
+        split_block(hp, h, new_size);
+        h->free = 0;
+        return 1;
+    }
+    return 0;
+}
+
+/* ======================= арены задач ======================= */
+
+/* Вырезать из глобальной области кусок и разметить его одним свободным блоком */
+static user_chunk_t *chunk_create(size_t payload)
+{
+    size_t need = align_up(sizeof(user_chunk_t)) + sizeof(user_block_t) + align_up(payload);
+    unsigned long irq = spin_lock_irqsave(&region_lock);
+    unsigned char *mem = (unsigned char *)heap_alloc(&user_region, align_up(need));
+    size_t got = mem ? payload_to_header(mem)->size : 0;
+    spin_unlock_irqrestore(&region_lock, irq);
+    if (!mem)
+        return NULL;
+
+    /* Дальше кусок принадлежит только нам — размечаем без замка */
+    user_chunk_t *c = (user_chunk_t *)mem;
+    user_block_t *h = (user_block_t *)(mem + align_up(sizeof(user_chunk_t)));
+    h->magic = ARENA_BLOCK_MAGIC;
+    h->size = got - align_up(sizeof(user_chunk_t)) - sizeof(user_block_t);
+    h->free = 1;
+    h->prev = h->next = NULL;
+
+    c->next = NULL;
+    c->start = (unsigned char *)h;
+    c->end = (unsigned char *)header_to_payload(h) + h->size;
+    c->heap.head = c->heap.tail = h;
+    c->heap.magic = ARENA_BLOCK_MAGIC;
+    return c;
+}
+
+/* Сколько кусок занимает в общей области (вместе с заголовками) */
+static inline size_t chunk_footprint(const user_chunk_t *c)
+{
+    return (size_t)(c->end - (const unsigned char *)c) + sizeof(user_block_t);
+}
+
+user_arena_t *user_arena_create(size_t size)
+{
+    if (!user_region.head)
+        user_malloc_init();
+
+    if (size < USER_ARENA_CHUNK)
+        size = USER_ARENA_CHUNK;
+
+    /* Дескриптор арены живёт в первом блоке её же первого куска */
+    user_chunk_t *c = chunk_create(size + sizeof(user_block_t) + align_up(sizeof(user_arena_t)));
+    if (!c)
+        return NULL;
+
+    user_arena_t *a = (user_arena_t *)heap_alloc(&c->heap, align_up(sizeof(user_arena_t)));
+    a->magic = ARENA_MAGIC;
+    a->pid = -1;
+    a->lock.locked = 0;
+    a->chunks = c;
+    a->bytes = chunk_footprint(c);
+    a->limit = 0;
+    return a;
+}
+
+void user_arena_set_owner(user_arena_t *a, int pid)
+{
+    if (a && a->magic == ARENA_MAGIC)
+        a->pid = pid;
+}
+
+void user_arena_set_limit(user_arena_t *a, size_t limit)
+{
+    if (a && a->magic == ARENA_MAGIC)
+        a->limit = limit;
+}
+
+size_t user_arena_footprint(const user_arena_t *a)
+{
+    return (a && a->magic == ARENA_MAGIC) ? a->bytes : 0;
+}
+
+/* Освобождение всей арены: по одному heap_free на кусок, блоки внутри не обходятся */
+void user_arena_destroy(user_arena_t *a)
+{
+    if (!a || a->magic != ARENA_MAGIC)
+        return;
+
+    /* Дескриптор лежит в первом куске — отпускаем замок арены до возврата кусков */
+    unsigned long irq = spin_lock_irqsave(&a->lock);
+    user_chunk_t *c = a->chunks;
+    a->magic = 0;
+    a->chunks = NULL;
+    spin_unlock_irqrestore(&a->lock, irq);
+
+    irq = spin_lock_irqsave(&region_lock);
+    while (c)
+    {
+        user_chunk_t *next = c->next;
+        heap_free(&user_region, payload_to_header(c));
+        c = next;
+    }
+    spin_unlock_irqrestore(&region_lock, irq);
+}
+
+static user_chunk_t *arena_chunk_of(user_arena_t *a, void *ptr)
+{
+    for (user_chunk_t *c = a->chunks; c; c = c->next)
+    {
+        if ((unsigned char *)ptr > c->start && (unsigned char *)ptr < c->end)
+            return c;
+    }
+    return NULL;
+}
+
+/* Выделение в арене, a->lock уже взят. Новый кусок берётся под region_lock
+   (порядок вложения: арена -> область, обратного нет) */
+static void *arena_alloc(user_arena_t *a, size_t size)
+{
+    for (user_chunk_t *c = a->chunks; c; c = c->next)
+    {
+        void *p = heap_alloc(&c->heap, size);
+        if (p)
+            return p;
+    }
+
+    /* Места нет — добавляем кусок, не меньше USER_ARENA_CHUNK, если квота позволяет */
+    size_t payload = size > USER_ARENA_CHUNK ? size : USER_ARENA_CHUNK;
+    if (a->limit && a->bytes + payload > a->limit)
+        return NULL;
+    user_chunk_t *c = chunk_create(payload);
+    if (!c)
+        return NULL;
+    c->next = a->chunks;
+    a->chunks = c;
+    a->bytes += chunk_footprint(c);
+    return heap_alloc(&c->heap, size);
+}
+
+void *user_arena_malloc(user_arena_t *a, size_t size)
+{
+    if (!a || a->magic != ARENA_MAGIC || size == 0)
+        return NULL;
+
+    unsigned long irq = spin_lock_irqsave(&a->lock);
+    void *p = arena_alloc(a, align_up(size));
+    spin_unlock_irqrestore(&a->lock, irq);
+    return p;
+}
+
+/* Опустевший кусок (кроме того, где лежит дескриптор арены) возвращается
+   в общую область, a->lock уже взят. Иначе после роста и освобождений
+   пустые куски копились бы в арене и в квоте задачи */
+static void arena_chunk_release(user_arena_t *a, user_chunk_t *c)
+{
+    user_block_t *h = c->heap.head;
+    if (h != c->heap.tail || !h->free || arena_chunk_of(a, a) == c)
+        return;
+
+    user_chunk_t **link = &a->chunks;
+    while (*link != c)
+        link = &(*link)->next;
+    *link = c->next;
+    a->bytes -= chunk_footprint(c);
+
+    unsigned long irq = spin_lock_irqsave(&region_lock);
+    heap_free(&user_region, payload_to_header(c));
+    spin_unlock_irqrestore(&region_lock, irq);
+}
+
+void user_arena_free(user_arena_t *a, void *ptr)
+{
+    if (!a || a->magic != ARENA_MAGIC || !ptr)
+        return;
+
+    unsigned long irq = spin_lock_irqsave(&a->lock);
+    user_chunk_t *c = arena_chunk_of(a, ptr);
+    user_block_t *h = payload_to_header(ptr);
+    if (c && h->magic == ARENA_BLOCK_MAGIC && !h->free)
+    {
+        heap_free(&c->heap, h);
+        arena_chunk_release(a, c);
+    }
+    spin_unlock_irqrestore(&a->lock, irq);
+}
+
+void *user_arena_realloc(user_arena_t *a, void *ptr, size_t new_size)
+{
+    if (!ptr)
+        return user_arena_malloc(a, new_size);
+    if (new_size == 0)
+    {
+        user_arena_free(a, ptr);
+        return NULL;
+    }
+    if (!a || a->magic != ARENA_MAGIC)
+        return NULL;
+
+    new_size = align_up(new_size);
+    unsigned long irq = spin_lock_irqsave(&a->lock);
+    user_chunk_t *c = arena_chunk_of(a, ptr);
+    user_block_t *h = payload_to_header(ptr);
+    if (!c || h->magic != ARENA_BLOCK_MAGIC || h->free)
+    {
+        spin_unlock_irqrestore(&a->lock, irq);
+        return NULL;
+    }
+
+    if (new_size <= h->size)
+    {
+        split_block(&c->heap, h, new_size);
+        spin_unlock_irqrestore(&a->lock, irq);
+        return ptr;
+    }
+    if (heap_grow_in_place(&c->heap, h, new_size))
+    {
+        spin_unlock_irqrestore(&a->lock, irq);
+        return ptr;
+    }
+
+    void *newp = arena_alloc(a, new_size);
+    size_t old_size = h->size;
+    spin_unlock_irqrestore(&a->lock, irq);
+    if (!newp)
+        return NULL;
+
+    /* Копируем без замка: оба блока заняты и принадлежат вызывающему */
+    memcpy(newp, ptr, old_size);
+    user_arena_free(a, ptr);
+    return newp;
+}
+
+/* Арена текущей задачи (NULL — ядро/kernel-поток, используется общая область) */
+static user_arena_t *current_arena(void)
+{
+    task_t *t = get_current_task();
+    return t ? t->arena : NULL;
+}
+
+/* ======================= общий интерфейс ======================= */
+
 /* user_malloc */
 void *user_malloc(size_t size)
 {
-    if (!user_head)
+    if (!user_region.head)
         user_malloc_init();
 
     if (size == 0)
         return NULL;
 
-    size = align_up(size);
-    user_block_t *fit = find_fit(size);
-    if (!fit)
-        return NULL;
+    user_arena_t *a = current_arena();
+    if (a)
+        return user_arena_malloc(a, size);
 
-    split_block(fit, size);
-    fit->free = 0;
-    return header_to_payload(fit);
+    unsigned long irq = spin_lock_irqsave(&region_lock);
+    void *p = heap_alloc(&user_region, align_up(size));
+    spin_unlock_irqrestore(&region_lock, irq);
+    return p;
 }
 
 /* user_free */
@@ -144,11 +449,16 @@ void user_free(void *ptr)
         return;
 
     user_block_t *h = payload_to_header(ptr);
-    if (h->magic != MAGIC || h->free)
+    if (h->magic == ARENA_BLOCK_MAGIC)
+    {
+        user_arena_free(current_arena(), ptr);
         return;
+    }
 
-    h->free = 1;
-    coalesce(h);
+    unsigned long irq = spin_lock_irqsave(&region_lock);
+    if (h->magic == MAGIC && !h->free)
+        heap_free(&user_region, h);
+    spin_unlock_irqrestore(&region_lock, irq);
 }
 
 /* user_realloc */
@@ -163,49 +473,46 @@ void *user_realloc(void *ptr, size_t new_size)
     }
 
     user_block_t *h = payload_to_header(ptr);
-    if (h->magic != MAGIC)
-        return NULL;
+    if (h->magic == ARENA_BLOCK_MAGIC)
+        return user_arena_realloc(current_arena(), ptr, new_size);
 
     new_size = align_up(new_size);
+    unsigned long irq = spin_lock_irqsave(&region_lock);
+    if (h->magic != MAGIC || h->free)
+    {
+        spin_unlock_irqrestore(&region_lock, irq);
+        return NULL;
+    }
+
     if (new_size <= h->size)
     {
-        split_block(h, new_size);
+        split_block(&user_region, h, new_size);
+        spin_unlock_irqrestore(&region_lock, irq);
         return ptr;
     }
 
     /* Попытка расширить in-place */
-    if (h->next && h->next->free && (h->size + sizeof(user_block_t) + h->next->size) >= new_size)
+    if (heap_grow_in_place(&user_region, h, new_size))
     {
-        h->size += sizeof(user_block_t) + h->next->size;
-        h->next = h->next->next;
-        if (h->next)
-            h->next->prev = h;
-        split_block(h, new_size);
-        h->free = 0;
+        spin_unlock_irqrestore(&region_lock, irq);
         return ptr;
     }
 
-    /* Выделяем новый блок и копируем */
-    void *newp = user_malloc(new_size);
+    /* Выделяем новый блок и копируем (копирование — вне замка) */
+    void *newp = heap_alloc(&user_region, new_size);
+    size_t old_size = h->size;
+    spin_unlock_irqrestore(&region_lock, irq);
     if (!newp)
         return NULL;
-    memcpy(newp, ptr, h->size);
+    memcpy(newp, ptr, old_size);
     user_free(ptr);
     return newp;
 }
 
 /* Статистика */
-void get_usermalloc_stats(umalloc_stats_t *st)
+static void heap_stats(const user_heap_t *hp, umalloc_stats_t *st)
 {
-    if (!st)
-        return;
-    st->total_managed = 0;
-    st->used_payload = 0;
-    st->free_payload = 0;
-    st->largest_free = 0;
-    st->num_blocks = st->num_used = st->num_free = 0;
-
-    user_block_t *cur = user_head;
+    user_block_t *cur = hp->head;
     while (cur)
     {
         st->num_blocks++;
@@ -225,3 +532,32 @@ void get_usermalloc_stats(umalloc_stats_t *st)
         cur = cur->next;
     }
 }
+
+/* arena == NULL — вся .user область (куски арен считаются занятыми блоками),
+   иначе — только блоки этой арены */
+void get_usermalloc_stats(const user_arena_t *arena, umalloc_stats_t *st)
+{
+    if (!st)
+        return;
+    st->total_managed = 0;
+    st->used_payload = 0;
+    st->free_payload = 0;
+    st->largest_free = 0;
+    st->num_blocks = st->num_used = st->num_free = 0;
+
+    if (!arena)
+    {
+        unsigned long irq = spin_lock_irqsave(&region_lock);
+        heap_stats(&user_region, st);
+        spin_unlock_irqrestore(&region_lock, irq);
+        return;
+    }
+    if (arena->magic != ARENA_MAGIC)
+        return;
+
+    spinlock_t *lock = (spinlock_t *)&arena->lock; /* const — только для данных арены */
+    unsigned long irq = spin_lock_irqsave(lock);
+    for (user_chunk_t *c = arena->chunks; c; c = c->next)
+        heap_stats(&c->heap, st);
+    spin_unlock_irqrestore(lock, irq);
+}
@@ -16,6 +16,12 @@ typedef struct umalloc_stats
     size_t num_free;
 } umalloc_stats_t;
 
+/* Минимальный кусок, которым арена задачи растёт в .user области */
+#define USER_ARENA_CHUNK (64 * 1024)
+
+/* Арена задачи: свои списки блоков внутри кусков .user области */
+typedef struct user_arena user_arena_t;
+
 /* Инициализация user heap: start — начало, size — размер */
 void user_malloc_init(void);
 
@@ -24,7 +30,20 @@ void *user_malloc(size_t size);
 void user_free(void *ptr);
 void *user_realloc(void *ptr, size_t new_size);
 
-/* Статистика */
-void get_usermalloc_stats(umalloc_stats_t *st);
+/* Арены: создаются загрузчиком, освобождаются целиком при выходе задачи.
+   user_malloc/user_free из задачи с ареной работают только с её блоками. */
+user_arena_t *user_arena_create(size_t size);
+void user_arena_destroy(user_arena_t *a);
+void user_arena_set_owner(user_arena_t *a, int pid);
+/* Квота: новые куски не берутся сверх limit байт (0 — без ограничения) */
+void user_arena_set_limit(user_arena_t *a, size_t limit);
+/* Сколько арена занимает в .user области */
+size_t user_arena_footprint(const user_arena_t *a);
+void *user_arena_malloc(user_arena_t *a, size_t size);
+void user_arena_free(user_arena_t *a, void *ptr);
+void *user_arena_realloc(user_arena_t *a, void *ptr, size_t new_size);
+
+/* Статистика: arena == NULL — вся .user область, иначе только блоки арены */
+void get_usermalloc_stats(const user_arena_t *arena, umalloc_stats_t *st);
 
 #endif // USER_MALLOC_H
@@ -0,0 +1,83 @@
+// multiboot.c — копия списка модулей из структуры загрузчика
+#include "multiboot.h"
+#include "../libc/string.h"
+
+/* Память за пределами identity map (1 GiB) ядру не видна */
+#define MB_IDENTITY_LIMIT (1ULL << 30)
+
+typedef struct
+{
+    uint32_t flags;
+    uint32_t mem_lower;
+    uint32_t mem_upper;
+    uint32_t boot_device;
+    uint32_t cmdline;
+    uint32_t mods_count;
+    uint32_t mods_addr;
+} __attribute__((packed)) mb_info_t;
+
+typedef struct
+{
+    uint32_t mod_start;
+    uint32_t mod_end;
+    uint32_t string;
+    uint32_t reserved;
+} __attribute__((packed)) mb_mod_t;
+
+static mb_module_t modules[MB_MAX_MODULES];
+static size_t module_count = 0;
+
+void multiboot_init(uint32_t magic, uint32_t info_phys)
+{
+    module_count = 0;
+    if (magic != MULTIBOOT_BOOTLOADER_MAGIC || info_phys == 0)
+        return;
+    const mb_info_t *info = (const mb_info_t *)(uintptr_t)info_phys;
+    if (!(info->flags & MULTIBOOT_INFO_MODS) || info->mods_addr == 0)
+        return;
+
+    const mb_mod_t *m = (const mb_mod_t *)(uintptr_t)info->mods_addr;
+    for (uint32_t i = 0; i < info->mods_count && module_count < MB_MAX_MODULES; ++i)
+    {
+        if (m[i].mod_end <= m[i].mod_start || m[i].mod_end > MB_IDENTITY_LIMIT)
+            continue;
+        mb_module_t *mod = &modules[module_count++];
+        mod->start = m[i].mod_start;
+        mod->end = m[i].mod_end;
+        mod->cmdline[0] = '\0';
+        if (m[i].string)
+        {
+            strncpy(mod->cmdline, (const char *)(uintptr_t)m[i].string, MB_CMDLINE_MAX - 1);
+            mod->cmdline[MB_CMDLINE_MAX - 1] = '\0';
+        }
+    }
+}
+
+size_t multiboot_module_count(void)
+{
+    return module_count;
+}
+
+const mb_module_t *multiboot_module(size_t i)
+{
+    return i < module_count ? &modules[i] : NULL;
+}
+
+const mb_module_t *multiboot_find_module(const char *name)
+{
+    size_t len = strlen(name);
+    for (size_t i = 0; i < module_count; ++i)
+    {
+        /* "/boot/fs.img arg" -> "fs.img" */
+        const char *s = modules[i].cmdline;
+        const char *end = s;
+        while (*end && *end != ' ')
+            end++;
+        const char *base = end;
+        while (base > s && base[-1] != '/')
+            base--;
+        if ((size_t)(end - base) == len && strncmp(base, name, len) == 0)
+            return &modules[i];
+    }
+    return NULL;
+}
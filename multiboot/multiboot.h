@@ -0,0 +1,33 @@
+// multiboot.h — информация загрузчика (Multiboot 1): модули
+#ifndef MULTIBOOT_H
+#define MULTIBOOT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define MULTIBOOT_BOOTLOADER_MAGIC 0x2BADB002
+#define MULTIBOOT_INFO_MODS 0x8 /* flags: mods_count/mods_addr заполнены */
+
+#define MB_MAX_MODULES 8
+#define MB_CMDLINE_MAX 64
+
+/* Модуль в физической памяти [start, end). Память ядро не трогает:
+   модули лежат за образом ядра, вне куч и пула фреймов. */
+typedef struct
+{
+    uint64_t start;
+    uint64_t end;
+    char cmdline[MB_CMDLINE_MAX];
+} mb_module_t;
+
+/* Разобрать информацию загрузчика (magic и адрес из eax/ebx при входе).
+   Вызывать первым делом: структуры загрузчика ничем не защищены. */
+void multiboot_init(uint32_t magic, uint32_t info_phys);
+
+size_t multiboot_module_count(void);
+const mb_module_t *multiboot_module(size_t i);
+/* Модуль, у которого имя файла (последний компонент первого слова
+   командной строки) равно name, или NULL */
+const mb_module_t *multiboot_find_module(const char *name);
+
+#endif // MULTIBOOT_H
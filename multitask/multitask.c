@@ -8,6 +8,9 @@
 #include "../vga/vga.h"
 #include "../syscall/syscall.h"
 #include "../malloc/user_malloc.h"
+#include "../vmm/vmm.h"
+#include "../sync/spinlock.h"
+#include "../fat16/fd.h"
 
 #include <stdint.h>
 #include <stddef.h>
@@ -32,10 +35,46 @@ static task_t init_task;
 /* Список зомби для отложенной очистки */
 static task_t *zombie_list = NULL;
 
+/* Квоты, которые получает каждая новая задача (task_limits с pid < 0) */
+static task_limits_t default_limits = {
+    TASK_KMEM_SOFT_DEFAULT,
+    TASK_KMEM_HARD_DEFAULT,
+    TASK_UMEM_SOFT_DEFAULT,
+    TASK_UMEM_HARD_DEFAULT,
+};
+
 /* CLI/STI */
 static inline void cli(void) { __asm__ volatile("cli" ::: "memory"); }
 static inline void sti(void) { __asm__ volatile("sti" ::: "memory"); }
 
+/* Выдать pid. Создание задачи идёт с включёнными прерываниями,
+   запрещаем их только на инкремент и на вставку в кольцо */
+static int alloc_pid(void)
+{
+    unsigned long flags = local_irq_save();
+    int pid = next_pid++;
+    local_irq_restore(flags);
+    return pid;
+}
+
+/* Вставить полностью подготовленную задачу в кольцо как новый tail */
+static void ring_insert(task_t *t)
+{
+    unsigned long flags = local_irq_save();
+    if (!task_ring)
+    {
+        task_ring = t;
+        t->next = t;
+    }
+    else
+    {
+        t->next = task_ring->next;
+        task_ring->next = t;
+        task_ring = t;
+    }
+    local_irq_restore(flags);
+}
+
 /* prepare_initial_stack: layout exactly matches your ISR push order */
 static uint64_t *prepare_initial_stack(void (*entry)(void), void *kstack_top)
 {
@@ -119,12 +158,14 @@ void task_create(void (*entry)(void), size_t stack_size)
 {
     if (stack_size == 0)
         stack_size = KSTACK_SIZE;
+    stack_size = (stack_size + PAGE_SIZE - 1) & ~(size_t)(PAGE_SIZE - 1);
 
     task_t *t = (task_t *)malloc(sizeof(task_t));
     if (!t)
         return;
 
-    void *kstack = malloc(stack_size);
+    /* Лимит роста; отображена пока только верхняя страница */
+    void *kstack = vmm_kstack_alloc(stack_size);
     if (!kstack)
     {
         free(t);
@@ -132,28 +173,18 @@ void task_create(void (*entry)(void), size_t stack_size)
     }
 
     memset(t, 0, sizeof(*t));
-    t->pid = next_pid++;
+    t->pid = alloc_pid();
     t->state = TASK_READY;
     t->kstack = kstack;
     t->kstack_size = stack_size;
     t->exit_code = 0;
     t->next = NULL;
+    t->limits = default_limits;
 
     void *kstack_top = (char *)kstack + stack_size;
     t->regs = prepare_initial_stack(entry, kstack_top);
 
-    /* Вставляем в кольцо как новый tail */
-    if (!task_ring)
-    {
-        task_ring = t;
-        t->next = t;
-    }
-    else
-    {
-        t->next = task_ring->next;
-        task_ring->next = t;
-        task_ring = t;
-    }
+    ring_insert(t);
 }
 
 /* Простая выборка следующей READY задачи (round-robin). */
@@ -225,6 +256,9 @@ void schedule_from_isr(uint64_t *regs, uint64_t **out_regs_ptr)
     current->state = TASK_RUNNING;
     *out_regs_ptr = current->regs;
 
+    /* kernel-потоки (as == NULL) работают в адресном пространстве ядра */
+    vmm_switch(current->as);
+
     // Обновляем kstack_top для нового current
     g_syscall_kstack_top = (uint64_t)current->kstack + current->kstack_size;
 }
@@ -285,10 +319,35 @@ static void free_task_resources(task_t *t)
     if (!t || t == &init_task)
         return;
 
+    fd_close_all(t);
+
+    if (t->image)
+    {
+        unsigned long flags = local_irq_save();
+        fs_file_allow_write(t->image);
+        fs_file_close(t->image);
+        local_irq_restore(flags);
+        t->image = NULL;
+    }
+
     if (t->kstack)
-        free(t->kstack);
+        vmm_kstack_free(t->kstack);
+
+    if (t->as)
+    {
+        vmm_destroy_space(t->as);
+        t->as = NULL;
+    }
 
-    if (t->user_mem)
+    if (t->arena)
+    {
+        /* образ и всё, что задача выделила через user_malloc, — одним шагом */
+        user_arena_destroy(t->arena);
+        t->arena = NULL;
+        t->user_mem = NULL;
+        t->user_mem_size = 0;
+    }
+    else if (t->user_mem)
     {
         user_free(t->user_mem);
         t->user_mem = NULL;
@@ -344,6 +403,12 @@ int task_list(task_info_t *buf, size_t max)
             break;
         buf[count].pid = it->pid;
         buf[count].state = it->state;
+        buf[count].kmem_bytes = it->kmem_bytes;
+        buf[count].kmem_peak = it->kmem_peak;
+        buf[count].umem_bytes = task_umem_bytes(it);
+        buf[count].limits = it->limits;
+        buf[count].soft_hits = it->soft_hits;
+        buf[count].hard_fails = it->hard_fails;
         count++;
         it = it->next;
     } while (it != task_ring->next);
@@ -423,48 +488,147 @@ void task_exit(int exit_code)
     sti();
 }
 
-uint64_t utask_create(void (*entry)(void), size_t stack_size, void *user_mem, size_t user_mem_size)
+/* Общая часть запуска программы: as уже содержит образ. При неудаче as
+   уничтожается, арену и файл образа освобождает вызывающий. */
+static uint64_t utask_start(address_space_t *as, uint64_t entry_va, size_t stack_size,
+                            void *user_mem, size_t user_mem_size, user_arena_t *arena, struct fs_file *image)
 {
     if (stack_size == 0)
         stack_size = KSTACK_SIZE;
+    stack_size = (stack_size + PAGE_SIZE - 1) & ~(size_t)(PAGE_SIZE - 1);
 
     task_t *t = (task_t *)malloc(sizeof(task_t));
-    if (!t)
-        return 0;
-
-    void *kstack = malloc(stack_size);
+    void *kstack = t ? vmm_kstack_alloc(stack_size) : NULL;
     if (!kstack)
     {
         free(t);
+        vmm_destroy_space(as);
         return 0;
     }
 
     memset(t, 0, sizeof(*t));
-    t->pid = next_pid++;
+    t->pid = alloc_pid();
     t->state = TASK_READY;
     t->kstack = kstack;
     t->kstack_size = stack_size;
-    t->regs = prepare_initial_stack(entry, (char *)kstack + stack_size);
+    t->regs = prepare_initial_stack((void (*)(void))(uintptr_t)entry_va, (char *)kstack + stack_size);
     t->exit_code = 0;
+    t->as = as;
 
     /* Сохраняем пользовательскую память */
     t->user_mem = user_mem;
     t->user_mem_size = user_mem_size;
+    t->arena = arena;
+    t->image = image;
+    user_arena_set_owner(arena, t->pid);
+    t->limits = default_limits;
+    task_sync_arena_limit(t);
+
+    /* После вставки задача может успеть завершиться — pid берём заранее */
+    int pid = t->pid;
+    ring_insert(t);
+    return pid;
+}
 
-    /* Вставляем в кольцо */
-    if (!task_ring)
+uint64_t utask_create(void (*entry)(void), size_t stack_size, void *user_mem, size_t user_mem_size, user_arena_t *arena)
+{
+    /* Своё адресное пространство: образ отображается в USER_IMAGE_BASE,
+       heap коммитится по первому касанию (vmm_sbrk + page fault) */
+    address_space_t *as = vmm_create_space();
+    uint64_t image_va = as ? vmm_map_image(as, user_mem, user_mem_size) : 0;
+    if (!image_va)
     {
-        task_ring = t;
-        t->next = t;
+        if (as)
+            vmm_destroy_space(as);
+        return 0;
     }
-    else
+
+    /* entry задан адресом внутри user_mem — переводим его в виртуальный */
+    uint64_t entry_va = image_va + ((uint64_t)(uintptr_t)entry - (uint64_t)(uintptr_t)user_mem);
+    return utask_start(as, entry_va, stack_size, user_mem, user_mem_size, arena, NULL);
+}
+
+/* Образ, скопированный в арену задачи: файл не подряд на диске */
+static uint64_t utask_exec_copy(fs_file_t *f, size_t stack_size)
+{
+    size_t size = fs_file_size(f);
+    size_t mem_size = size + USER_BSS_SIZE;
+    /* Образ — часть umem задачи: больше жёсткого лимита не загружаем */
+    if (default_limits.umem_hard && mem_size > default_limits.umem_hard)
+        return 0;
+
+    user_arena_t *arena = user_arena_create(mem_size);
+    void *user_mem = arena ? user_arena_malloc(arena, mem_size) : NULL;
+    if (!user_mem)
     {
-        t->next = task_ring->next;
-        task_ring->next = t;
-        task_ring = t;
+        user_arena_destroy(arena);
+        return 0;
+    }
+
+    /* Файл перезапишет образ целиком, обнулить нужно только хвост под .bss */
+    unsigned long flags = local_irq_save();
+    int64_t got = fs_pread(f, user_mem, size, 0);
+    local_irq_restore(flags);
+    if (got != (int64_t)size)
+    {
+        user_arena_destroy(arena);
+        return 0;
+    }
+    memset((char *)user_mem + size, 0, mem_size - size);
+
+    uint64_t pid = utask_create((void (*)(void))user_mem, stack_size, user_mem, mem_size, arena);
+    if (pid == 0)
+        user_arena_destroy(arena);
+    return pid;
+}
+
+uint64_t utask_exec(int file_idx, size_t stack_size)
+{
+    unsigned long flags = local_irq_save();
+    fs_file_t *f = fs_file_open(file_idx);
+    size_t size = fs_file_size(f);
+    const void *data = fs_file_data(f);
+    if ((uintptr_t)data & (PAGE_SIZE - 1))
+        data = NULL; // кластер меньше страницы: в первую страницу попал бы чужой файл
+    if (data)
+        fs_file_deny_write(f); // содержимое будет отображено — держим на месте
+    local_irq_restore(flags);
+
+    if (!f || size == 0)
+    {
+        flags = local_irq_save();
+        fs_file_close(f);
+        local_irq_restore(flags);
+        return 0;
+    }
+
+    if (!data)
+    {
+        uint64_t pid = utask_exec_copy(f, stack_size);
+        flags = local_irq_save();
+        fs_file_close(f);
+        local_irq_restore(flags);
+        return pid;
     }
 
-    return t->pid;
+    /* Кластеры подряд: страницы RAM-диска отображаются в задачу как есть,
+       все экземпляры программы делят один текст */
+    address_space_t *as = vmm_create_space();
+    uint64_t image_va = as ? vmm_map_image_cow(as, data, size, USER_BSS_SIZE) : 0;
+    uint64_t pid = 0;
+    if (image_va)
+        pid = utask_start(as, image_va, stack_size, NULL, 0, NULL, f);
+    else if (as)
+        vmm_destroy_space(as);
+
+    if (pid == 0)
+    {
+        flags = local_irq_save();
+        fs_file_allow_write(f);
+        fs_file_close(f);
+        local_irq_restore(flags);
+    }
+    return pid;
 }
 
 /* Возвращает 1, если задача с pid всё ещё "жива" (READY или RUNNING),
@@ -504,3 +668,115 @@ int task_is_alive(int pid)
     sti();
     return 0;
 }
+
+/* Найти задачу по pid (NULL, если нет) */
+task_t *task_find(int pid)
+{
+    unsigned long flags = local_irq_save();
+
+    task_t *found = NULL;
+    if (task_ring)
+    {
+        task_t *it = task_ring->next;
+        do
+        {
+            if (it->pid == pid)
+            {
+                found = it;
+                break;
+            }
+            it = it->next;
+        } while (it != task_ring->next);
+    }
+
+    local_irq_restore(flags);
+    return found;
+}
+
+/* ================= квоты памяти ================= */
+
+size_t task_umem_bytes(const task_t *t)
+{
+    if (!t)
+        return 0;
+    size_t bytes = user_arena_footprint(t->arena);
+    if (t->as)
+        bytes += (size_t)(t->as->brk - t->as->brk_start);
+    return bytes;
+}
+
+int task_mem_check(task_t *t, int kind, size_t bytes)
+{
+    if (!t || bytes == 0)
+        return 0;
+
+    size_t used = (kind == TASK_MEM_KERNEL) ? t->kmem_bytes : task_umem_bytes(t);
+    uint64_t soft = (kind == TASK_MEM_KERNEL) ? t->limits.kmem_soft : t->limits.umem_soft;
+    uint64_t hard = (kind == TASK_MEM_KERNEL) ? t->limits.kmem_hard : t->limits.umem_hard;
+
+    if (hard && (bytes > hard || used > hard - bytes))
+    {
+        t->hard_fails++;
+        return -1;
+    }
+    if (soft && (bytes > soft || used > soft - bytes))
+        t->soft_hits++;
+    return 0;
+}
+
+void task_kmem_account(task_t *t, int64_t delta)
+{
+    if (!t)
+        return;
+    if (delta < 0 && (size_t)-delta > t->kmem_bytes)
+        t->kmem_bytes = 0; /* освобождён чужой указатель — в минус не уходим */
+    else
+        t->kmem_bytes += delta;
+    if (t->kmem_bytes > t->kmem_peak)
+        t->kmem_peak = t->kmem_bytes;
+}
+
+void task_sync_arena_limit(task_t *t)
+{
+    if (!t || !t->arena)
+        return;
+    size_t limit = 0;
+    if (t->limits.umem_hard)
+    {
+        size_t brk = t->as ? (size_t)(t->as->brk - t->as->brk_start) : 0;
+        /* 1 байт вместо 0: ноль у арены означает «без ограничения» */
+        limit = t->limits.umem_hard > brk ? (size_t)(t->limits.umem_hard - brk) : 1;
+    }
+    user_arena_set_limit(t->arena, limit);
+}
+
+int task_limits(int pid, const task_limits_t *lim, task_limits_t *old)
+{
+    if (lim && ((lim->kmem_soft && lim->kmem_hard && lim->kmem_soft > lim->kmem_hard) ||
+                (lim->umem_soft && lim->umem_hard && lim->umem_soft > lim->umem_hard)))
+        return -1; /* мягкий лимит выше жёсткого */
+
+    unsigned long flags = local_irq_save();
+    task_limits_t *target = &default_limits;
+    task_t *t = NULL;
+    if (pid >= 0)
+    {
+        t = task_find(pid);
+        if (!t)
+        {
+            local_irq_restore(flags);
+            return -1;
+        }
+        target = &t->limits;
+    }
+
+    if (old)
+        *old = *target;
+    if (lim)
+    {
+        *target = *lim;
+        task_sync_arena_limit(t);
+    }
+    local_irq_restore(flags);
+    return 0;
+}
@@ -4,7 +4,31 @@
 #include <stdint.h>
 #include <stddef.h>
 
-#define KSTACK_SIZE (8 * 1024) /* дефолтный размер */
+/* Лимиты стеков ядра (vmm_kstack_alloc): память коммитится по страницам при
+   росте, под guard-страницей переполнение ловит #PF */
+#define KSTACK_SIZE (16 * 1024)      /* дефолтный лимит */
+#define KSTACK_USER_SIZE (32 * 1024) /* программы из /bin */
+#define USER_BSS_SIZE 1024            /* нули за концом образа программы под .bss */
+
+/* Квоты памяти задачи в байтах, 0 — без ограничения. Мягкий лимит только
+   отмечается (soft_hits), жёсткий — отказ в выделении.
+   kmem — kernel heap, выделенный задачей через SYSCALL_MALLOC/REALLOC;
+   umem — куски арены в .user (образ + user_malloc) и heap задачи (sbrk). */
+typedef struct task_limits
+{
+    uint64_t kmem_soft;
+    uint64_t kmem_hard;
+    uint64_t umem_soft;
+    uint64_t umem_hard;
+} task_limits_t;
+
+#define TASK_KMEM_SOFT_DEFAULT (8ULL * 1024 * 1024)
+#define TASK_KMEM_HARD_DEFAULT (32ULL * 1024 * 1024)
+#define TASK_UMEM_SOFT_DEFAULT (16ULL * 1024 * 1024)
+#define TASK_UMEM_HARD_DEFAULT (64ULL * 1024 * 1024)
+
+#define TASK_MEM_KERNEL 0
+#define TASK_MEM_USER 1
 
 typedef enum
 {
@@ -26,12 +50,27 @@ typedef struct task
     struct task *znext;   /* список зомби (отдельный указатель!) */
     void *user_mem;       // указатель на .user память
     size_t user_mem_size; // размер .user памяти
+    struct address_space *as; // адресное пространство (NULL — ядро)
+    struct user_arena *arena; // арена в .user (образ + user_malloc задачи)
+    task_limits_t limits;
+    size_t kmem_bytes;   /* kernel heap, выделенный через syscall и ещё не освобождённый */
+    size_t kmem_peak;
+    uint64_t soft_hits;  /* выделения сверх мягкого лимита */
+    uint64_t hard_fails; /* отказы по жёсткому лимиту */
+    struct fd_table *fds; /* открытые файлы (fat16/fd.c), NULL — ещё ни одного */
+    struct fs_file *image; /* файл образа, отображённый без копирования (utask_exec) */
 } task_t;
 
 typedef struct task_info
 {
     int pid;
     int state; // TASK_RUNNING, TASK_READY и т. д.
+    uint64_t kmem_bytes;
+    uint64_t kmem_peak;
+    uint64_t umem_bytes;
+    task_limits_t limits;
+    uint64_t soft_hits;
+    uint64_t hard_fails;
 } task_info_t;
 
 void scheduler_init(void);
@@ -46,8 +85,24 @@ void schedule_from_isr(uint64_t *regs, uint64_t **out_regs_ptr);
 task_t *get_current_task(void);
 void task_exit(int exit_code);
 
-uint64_t utask_create(void (*entry)(void), size_t stack_size, void *user_mem, size_t user_mem_size);
+uint64_t utask_create(void (*entry)(void), size_t stack_size, void *user_mem, size_t user_mem_size, struct user_arena *arena);
+/* Запустить программу из файла (индекс записи ФС). Кластеры подряд —
+   образ отображается из RAM-диска copy-on-write, иначе копируется в арену.
+   Возвращает pid или 0. */
+uint64_t utask_exec(int file_idx, size_t stack_size);
+task_t *task_find(int pid);
 
 int task_is_alive(int pid);
 
+/* Квоты: проверка перед выделением bytes сверх текущего (0 — можно, -1 —
+   жёсткий лимит) и учёт kernel heap по факту выделения/освобождения */
+int task_mem_check(task_t *t, int kind, size_t bytes);
+void task_kmem_account(task_t *t, int64_t delta);
+size_t task_umem_bytes(const task_t *t);
+/* Лимиты задачи pid (pid < 0 — по умолчанию для новых задач).
+   lim == NULL — только прочитать в old. 0 при успехе. */
+int task_limits(int pid, const task_limits_t *lim, task_limits_t *old);
+/* Лимит арены = жёсткий umem минус heap задачи (после sbrk и смены лимитов) */
+void task_sync_arena_limit(task_t *t);
+
 #endif
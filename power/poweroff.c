@@ -1,6 +1,7 @@
 // power/poweroff.c
 #include "poweroff.h"
 #include "../portio/portio.h"
+#include "../libc/string.h"
 #include <stdint.h>
 #include <stddef.h>
 
@@ -51,15 +52,6 @@ typedef struct
 } acpi_gas_t;
 #pragma pack(pop)
 
-static int memcmp_simple(const void *a, const void *b, size_t n)
-{
-    const unsigned char *pa = a, *pb = b;
-    for (size_t i = 0; i < n; ++i)
-        if (pa[i] != pb[i])
-            return (int)pa[i] - (int)pb[i];
-    return 0;
-}
-
 static int checksum_ok(const void *p, size_t n)
 {
     const uint8_t *q = (const uint8_t *)p;
@@ -89,7 +81,7 @@ static uintptr_t find_rsdp(void)
         void *vp = p2v(a);
         if (!vp)
             continue;
-        if (memcmp_simple(vp, SIG_RSDP, 8) == 0)
+        if (memcmp(vp, SIG_RSDP, 8) == 0)
         {
             rsdp2_t *r = (rsdp2_t *)vp;
             if ((r->revision >= 2 && r->length && checksum_ok(r, r->length)) || checksum_ok(r, 20))
@@ -129,7 +121,7 @@ static uintptr_t find_table(uintptr_t table_phys, const char *sig, int xsdt)
         {
             uint32_t e = read_u32(base + i * 4);
             acpi_sdt_hdr_t *h = map_sdt((uintptr_t)e);
-            if (h && memcmp_simple(h->sig, sig, 4) == 0)
+            if (h && memcmp(h->sig, sig, 4) == 0)
                 return (uintptr_t)e;
         }
     }
@@ -140,7 +132,7 @@ static uintptr_t find_table(uintptr_t table_phys, const char *sig, int xsdt)
         {
             uint64_t e = read_u64(base + i * 8);
             acpi_sdt_hdr_t *h = map_sdt((uintptr_t)e);
-            if (h && memcmp_simple(h->sig, sig, 4) == 0)
+            if (h && memcmp(h->sig, sig, 4) == 0)
                 return (uintptr_t)e;
         }
     }
@@ -156,9 +148,14 @@ static int find_s5(uintptr_t dsdt_phys, uint8_t *slp_a, uint8_t *slp_b)
     uint8_t *p = (uint8_t *)p2v(dsdt_phys);
     size_t len = dsdt->length;
 
+    /* Кандидаты — только позиции '_' */
     for (size_t i = 0; i + 4 < len; ++i)
     {
-        if (memcmp_simple(&p[i], "_S5_", 4) == 0)
+        uint8_t *u = memchr(&p[i], '_', len - 4 - i);
+        if (!u)
+            break;
+        i = (size_t)(u - p);
+        if (memcmp(&p[i], "_S5_", 4) == 0)
         {
             size_t pos = i + 4;
             if (pos + 6 < len)
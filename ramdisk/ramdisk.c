@@ -1,8 +1,43 @@
 #include "ramdisk.h"
+#include "../libc/string.h"
 
-static uint8_t ramdisk[RAMDISK_SIZE] = {0};
+static uint8_t *ramdisk = NULL;
 
-uint8_t *ramdisk_base(void)
+/* Драйвер: секторы — просто куски области. Устройство отображено (map),
+   поэтому ФС может читать данные файлов прямо из него, мимо кэша буферов. */
+static int ramdisk_read(blkdev_t *dev, uint64_t sector, uint32_t count, void *buf)
 {
-    return ramdisk;
+    (void)dev;
+    memcpy(buf, ramdisk + sector * BLK_SECTOR_SIZE, (size_t)count * BLK_SECTOR_SIZE);
+    return 0;
+}
+
+static int ramdisk_write(blkdev_t *dev, uint64_t sector, uint32_t count, const void *buf)
+{
+    (void)dev;
+    memcpy(ramdisk + sector * BLK_SECTOR_SIZE, buf, (size_t)count * BLK_SECTOR_SIZE);
+    return 0;
+}
+
+static void *ramdisk_map(blkdev_t *dev, uint64_t sector)
+{
+    (void)dev;
+    return ramdisk + sector * BLK_SECTOR_SIZE;
+}
+
+static const blkdev_ops_t ramdisk_ops = {ramdisk_read, ramdisk_write, ramdisk_map};
+static blkdev_t ramdisk_dev = {"ram0", 0, &ramdisk_ops, NULL};
+
+blkdev_t *ramdisk_init(void *base, uint64_t size)
+{
+    if (!base || size < BLK_SECTOR_SIZE || ramdisk)
+        return NULL;
+    ramdisk = (uint8_t *)base;
+    ramdisk_dev.sectors = size / BLK_SECTOR_SIZE; // неполный последний сектор не виден
+    if (blkdev_register(&ramdisk_dev) != 0)
+    {
+        ramdisk = NULL;
+        return NULL;
+    }
+    return &ramdisk_dev;
 }
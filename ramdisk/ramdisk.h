@@ -3,10 +3,11 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include "../block/blkdev.h"
 
-#define RAMDISK_SIZE (64 * 1024 * 1024) // 64 MiB
-
-// Получить указатель на базу RAM-диска
-uint8_t *ramdisk_base(void);
+/* RAM-диск поверх готовой области памяти (модуль загрузчика с образом
+   тома): блочное устройство "ram0", отображённое в память. Данные не
+   копируются — устройство и есть эта память. */
+blkdev_t *ramdisk_init(void *base, uint64_t size);
 
 #endif // RAMDISK_H
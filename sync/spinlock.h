@@ -0,0 +1,51 @@
+#ifndef SPINLOCK_H
+#define SPINLOCK_H
+
+/* Спинлок с запретом прерываний на время критической секции.
+   На одном CPU работу делает cli (обработчик прерывания не может застать
+   держателя), атомарный флаг защищает ту же секцию на SMP. Вложенный захват
+   одного и того же замка — deadlock: внутренние функции ожидают его уже взятым. */
+
+typedef struct
+{
+    volatile int locked;
+} spinlock_t;
+
+#define SPINLOCK_INIT {0}
+
+#ifndef HOST_BUILD
+static inline unsigned long local_irq_save(void)
+{
+    unsigned long flags;
+    asm volatile("pushf; pop %0; cli" : "=g"(flags)::"memory");
+    return flags;
+}
+
+static inline void local_irq_restore(unsigned long flags)
+{
+    asm volatile("push %0; popf" ::"g"(flags) : "memory", "cc");
+}
+#else
+/* Хост-сборка (tools/allocbench): cli недоступен в userland */
+static inline unsigned long local_irq_save(void) { return 0; }
+static inline void local_irq_restore(unsigned long flags) { (void)flags; }
+#endif
+
+static inline unsigned long spin_lock_irqsave(spinlock_t *l)
+{
+    unsigned long flags = local_irq_save();
+    while (__atomic_exchange_n(&l->locked, 1, __ATOMIC_ACQUIRE))
+    {
+        while (l->locked)
+            asm volatile("pause");
+    }
+    return flags;
+}
+
+static inline void spin_unlock_irqrestore(spinlock_t *l, unsigned long flags)
+{
+    __atomic_store_n(&l->locked, 0, __ATOMIC_RELEASE);
+    local_irq_restore(flags);
+}
+
+#endif // SPINLOCK_H
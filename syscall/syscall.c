@@ -8,7 +8,11 @@
 #include "../keyboard/keyboard.h"
 #include "../multitask/multitask.h"
 #include "../fat16/fs.h"
+#include "../fat16/fd.h"
 #include "../malloc/user_malloc.h"
+#include "../vmm/vmm.h"
+#include "../sync/spinlock.h"
+#include "../libc/kprintf.h"
 
 #include <stdint.h>
 #include <stddef.h>
@@ -16,91 +20,61 @@
 extern uint32_t seconds;
 extern volatile task_t *syscall_caller;
 
-static char str[11];
-static char tmp[11];
-
 uint64_t load_and_run_program(const char *str)
 {
-    asm volatile("cli");
     if (!str || str[0] == '\0')
-    {
-        asm volatile("sti");
         return -1;
-    }
 
-    // 1. Найти /bin
-    int bin_idx = fs_find_in_dir("bin", NULL, FS_ROOT_IDX, NULL);
-    if (bin_idx < 0)
-    {
-        asm volatile("sti");
-        return 0; // нет /bin, выходим
-    }
+    /* Syscall приходит через interrupt gate (IF=0). Загрузка долгая, а куча,
+       арены и кольцо задач защищены сами — разрешаем прерывания. У ФС своего
+       замка нет, поэтому только обращения к ней идут с запретом прерываний. */
+    asm volatile("sti");
 
-    // 2. Найти файл в /bin
+    // 1. Найти /bin и файл в нём
     fs_entry_t entry;
-    int file_idx = fs_find_in_dir(str, "bin", bin_idx, &entry);
-    if (file_idx < 0)
-    {
-        asm volatile("sti");
-        return 0; // файл не найден
-    }
-
-    if (entry.size == 0)
-    {
-        asm volatile("sti");
-        return 0;
-    }
-
-    // 3. Выделить память для файла через user_malloc
-    void *user_mem = user_malloc(entry.size + 1024);
-    if (!user_mem)
-    {
-        asm volatile("sti");
-        return 0; // ошибка выделения памяти
-    }
-
-    memset(user_mem, 0, entry.size);
-
-    // 4. Прочитать файл в user_mem
-    fs_read_file_in_dir(str, "bin", bin_idx, user_mem, entry.size, NULL);
+    unsigned long flags = local_irq_save();
+    int bin_idx = fs_find_in_dir("bin", NULL, FS_ROOT_IDX, NULL);
+    int file_idx = (bin_idx >= 0) ? fs_find_in_dir(str, "bin", bin_idx, &entry) : -1;
+    local_irq_restore(flags);
 
-    // 5. Создать задачу и передать туда файл
-    uint64_t pid = utask_create((void (*)(void))user_mem, 16384, user_mem, entry.size);
-    if (pid == 0)
-    {
-        user_free(user_mem);
-        asm volatile("sti");
-        return 0; // не удалось создать задачу
-    }
+    if (file_idx < 0 || entry.size == 0)
+        return 0; // нет /bin, файла или файл пуст
 
-    asm volatile("sti");
-    return pid;
+    // 2. Задача с образом прямо из файла (или его копией, если кластеры не подряд)
+    return utask_exec(file_idx, KSTACK_USER_SIZE);
 }
 
-static char *uint_to_str(uint32_t value, char *buf)
+/* Kernel heap по запросу задачи: проверка квоты до выделения, учёт по
+   фактическому размеру блока */
+static void *sys_malloc(size_t size)
 {
-    int len = 0;
-
-    if (value == 0)
-    {
-        buf[0] = '0';
-        buf[1] = '\0';
-        return buf;
-    }
-
-    while (value > 0)
-    {
-        tmp[len++] = '0' + (value % 10);
-        value /= 10;
-    }
+    task_t *t = get_current_task();
+    if (task_mem_check(t, TASK_MEM_KERNEL, size) != 0)
+        return NULL;
+    void *p = malloc(size);
+    task_kmem_account(t, (int64_t)kmalloc_usable_size(p));
+    return p;
+}
 
-    for (int i = 0; i < len; i++)
-    {
-        buf[i] = tmp[len - 1 - i];
-    }
-    buf[len] = '\0';
+static void sys_free(void *ptr)
+{
+    task_kmem_account(get_current_task(), -(int64_t)kmalloc_usable_size(ptr));
+    free(ptr);
+}
 
-    return buf;
+static void *sys_realloc(void *ptr, size_t size)
+{
+    task_t *t = get_current_task();
+    size_t old = kmalloc_usable_size(ptr);
+    if (size > old && task_mem_check(t, TASK_MEM_KERNEL, size - old) != 0)
+        return NULL;
+
+    void *p = realloc(ptr, size);
+    if (p)
+        task_kmem_account(t, (int64_t)kmalloc_usable_size(p) - (int64_t)old);
+    else if (size == 0)
+        task_kmem_account(t, -(int64_t)old);
+    return p;
 }
 
 uintptr_t syscall_handler(
@@ -135,27 +109,106 @@ uintptr_t syscall_handler(
         return 0;
 
     case SYSCALL_GET_TIME:
-        return (uintptr_t)uint_to_str(rdi, (char *)rsi);
+        /* Буфер задачи — 11 байт: десятичный uint32 и ноль */
+        ksnprintf((char *)(uintptr_t)rsi, 11, "%u", (uint32_t)rdi);
+        return rsi;
 
     case SYSCALL_CLEAN_SCREEN:
         clean_screen();
         return 0;
 
     case SYSCALL_MALLOC:
-        return (uintptr_t)malloc((size_t)rdi);
+        return (uintptr_t)sys_malloc((size_t)rdi);
 
     case SYSCALL_FREE:
-        free((void *)(uintptr_t)rdi);
+        sys_free((void *)(uintptr_t)rdi);
         return 0;
 
     case SYSCALL_REALLOC:
-        return (uintptr_t)realloc((void *)(uintptr_t)rdi, (size_t)rsi);
+        return (uintptr_t)sys_realloc((void *)(uintptr_t)rdi, (size_t)rsi);
 
     case SYSCALL_KMALLOC_STATS:
         if (rdi)
             get_kmalloc_stats((void *)(uintptr_t)rdi);
         return 0;
 
+    case SYSCALL_SBRK:
+    {
+        task_t *t = get_current_task();
+        int64_t inc = (int64_t)rdi;
+        if (inc > 0 && task_mem_check(t, TASK_MEM_USER, (size_t)inc) != 0)
+            return (uintptr_t)-1;
+        uint64_t old = vmm_sbrk(t ? t->as : NULL, inc);
+        task_sync_arena_limit(t);
+        return (uintptr_t)old;
+    }
+
+    case SYSCALL_UMALLOC_STATS:
+    {
+        if (!rsi)
+            return (uintptr_t)-1;
+        if ((int)rdi < 0)
+        {
+            get_usermalloc_stats(NULL, (umalloc_stats_t *)(uintptr_t)rsi);
+            return 0;
+        }
+        task_t *t = task_find((int)rdi);
+        if (!t || !t->arena)
+            return (uintptr_t)-1;
+        get_usermalloc_stats(t->arena, (umalloc_stats_t *)(uintptr_t)rsi);
+        return 0;
+    }
+
+    case SYSCALL_KMALLOC_PROFILE:
+        switch (rdi)
+        {
+        case KPROF_CMD_OFF:
+        case KPROF_CMD_ON:
+            kmalloc_profile_enable((int)rdi);
+            return 0;
+        case KPROF_CMD_SNAPSHOT:
+            if (!rsi)
+                return (uintptr_t)-1;
+            get_kmalloc_profile((kmalloc_profile_t *)(uintptr_t)rsi);
+            return 0;
+        case KPROF_CMD_REPORT:
+            return (uintptr_t)kmalloc_profile_report((char *)(uintptr_t)rsi, (size_t)rdx);
+        default:
+            return (uintptr_t)-1;
+        }
+
+    case SYSCALL_OPEN:
+        return (uintptr_t)(int64_t)fd_open((const char *)(uintptr_t)rdi, (int)rsi);
+
+    case SYSCALL_CLOSE:
+        return (uintptr_t)(int64_t)fd_close((int)rdi);
+
+    case SYSCALL_READ:
+        return (uintptr_t)fd_read((int)rdi, (void *)(uintptr_t)rsi, (size_t)rdx);
+
+    case SYSCALL_WRITE:
+        return (uintptr_t)fd_write((int)rdi, (const void *)(uintptr_t)rsi, (size_t)rdx);
+
+    case SYSCALL_PREAD:
+        return (uintptr_t)fd_pread((int)rdi, (void *)(uintptr_t)rsi, (size_t)rdx, r10);
+
+    case SYSCALL_PWRITE:
+        return (uintptr_t)fd_pwrite((int)rdi, (const void *)(uintptr_t)rsi, (size_t)rdx, r10);
+
+    case SYSCALL_LSEEK:
+        return (uintptr_t)fd_lseek((int)rdi, (int64_t)rsi, (int)rdx);
+
+    case SYSCALL_FTRUNCATE:
+        return (uintptr_t)(int64_t)fd_ftruncate((int)rdi, rsi);
+
+    case SYSCALL_FSCK:
+    {
+        unsigned long flags = local_irq_save();
+        int found = fs_fsck((int)rdi, (fs_fsck_t *)(uintptr_t)rsi);
+        local_irq_restore(flags);
+        return (uintptr_t)(int64_t)found;
+    }
+
     case SYSCALL_GETCHAR:
     {
         int c = kbd_getchar();
@@ -194,6 +247,10 @@ uintptr_t syscall_handler(
     case SYSCALL_TASK_IS_ALIVE:
         return task_is_alive((int)rdi);
 
+    case SYSCALL_TASK_LIMITS:
+        return (uintptr_t)(int64_t)task_limits((int)rdi, (const task_limits_t *)(uintptr_t)rsi,
+                                               (task_limits_t *)(uintptr_t)rdx);
+
     default:
         return (uintptr_t)-1;
     }
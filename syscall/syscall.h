@@ -5,6 +5,7 @@
 #include <stddef.h>
 #include "../malloc/malloc.h"
 #include "../multitask/multitask.h"
+#include "../fat16/fd.h"
 
 #define SYSCALL_PRINT_CHAR_POSITION 0
 #define SYSCALL_PRINT_STRING_POSITION 1
@@ -19,6 +20,25 @@
 #define SYSCALL_REALLOC 11
 #define SYSCALL_FREE 12
 #define SYSCALL_KMALLOC_STATS 13
+#define SYSCALL_SBRK 14 /* heap задачи: страницы выделяются по первому касанию */
+#define SYSCALL_UMALLOC_STATS 15 /* статистика арены задачи (pid < 0 — вся .user область) */
+#define SYSCALL_KMALLOC_PROFILE 16 /* профилировщик kernel heap, rdi — команда KPROF_CMD_* */
+
+#define KPROF_CMD_OFF 0
+#define KPROF_CMD_ON 1
+#define KPROF_CMD_SNAPSHOT 2 /* rsi — kmalloc_profile_t* */
+#define KPROF_CMD_REPORT 3   /* rsi — буфер, rdx — размер; вернёт длину текста */
+
+// Файлы: дескрипторы задачи (fat16/fd.h), -1 — ошибка
+#define SYSCALL_OPEN 20      /* rdi — путь, rsi — флаги O_* */
+#define SYSCALL_CLOSE 21
+#define SYSCALL_READ 22      /* с текущего смещения, сдвигает его */
+#define SYSCALL_WRITE 23
+#define SYSCALL_PREAD 24     /* r10 — смещение, текущее не меняется */
+#define SYSCALL_PWRITE 25
+#define SYSCALL_LSEEK 26     /* rsi — смещение, rdx — SEEK_* */
+#define SYSCALL_FTRUNCATE 27
+#define SYSCALL_FSCK 28      /* rdi — чинить (1) или только проверить, rsi — fs_fsck_t* или NULL */
 
 #define SYSCALL_GETCHAR 30 /* получить символ из клавиатурного буфера; -1 если пусто */
 #define SYSCALL_SETPOSCURSOR 31
@@ -33,6 +53,7 @@
 #define SYSCALL_REAP_ZOMBIES 203
 #define SYSCALL_TASK_EXIT 204
 #define SYSCALL_TASK_IS_ALIVE 205
+#define SYSCALL_TASK_LIMITS 206 /* квоты памяти: rdi — pid (<0 — по умолчанию), rsi — новые, rdx — старые */
 
 // Обёртки для удобства
 // Обертки для пользовательского кода
@@ -131,6 +152,174 @@ static inline void syscall_kmalloc_stats(void *stats)
         : "rax", "rdi", "memory");
 }
 
+static inline void *syscall_sbrk(int64_t increment)
+{
+    void *result;
+    __asm__ volatile(
+        "movq %1, %%rax\n"
+        "movq %2, %%rdi\n"
+        "syscall\n"
+        "movq %%rax, %0\n"
+        : "=r"(result)
+        : "i"((uint64_t)SYSCALL_SBRK), "r"((uint64_t)increment)
+        : "rax", "rdi", "memory");
+    return result;
+}
+
+static inline void syscall_umalloc_stats(int pid, void *stats)
+{
+    __asm__ volatile(
+        "movq %0, %%rax\n"
+        "movq %1, %%rdi\n"
+        "movq %2, %%rsi\n"
+        "syscall\n"
+        :
+        : "i"((uint64_t)SYSCALL_UMALLOC_STATS), "r"((uint64_t)pid), "r"((uint64_t)stats)
+        : "rax", "rdi", "rsi", "memory");
+}
+
+static inline uint64_t syscall_kmalloc_profile(uint64_t cmd, void *buf, size_t size)
+{
+    uint64_t result;
+    __asm__ volatile(
+        "movq %1, %%rax\n"
+        "movq %2, %%rdi\n"
+        "movq %3, %%rsi\n"
+        "movq %4, %%rdx\n"
+        "syscall\n"
+        "movq %%rax, %0\n"
+        : "=r"(result)
+        : "i"((uint64_t)SYSCALL_KMALLOC_PROFILE), "r"(cmd), "r"((uint64_t)buf), "r"((uint64_t)size)
+        : "rax", "rdi", "rsi", "rdx", "memory");
+    return result;
+}
+
+static inline int syscall_open(const char *path, int flags)
+{
+    int64_t result;
+    __asm__ volatile(
+        "movq %1, %%rax\n"
+        "movq %2, %%rdi\n"
+        "movq %3, %%rsi\n"
+        "syscall\n"
+        "movq %%rax, %0\n"
+        : "=r"(result)
+        : "i"((uint64_t)SYSCALL_OPEN), "r"((uint64_t)path), "r"((uint64_t)flags)
+        : "rax", "rdi", "rsi", "memory");
+    return (int)result;
+}
+
+static inline int syscall_close(int fd)
+{
+    int64_t result;
+    __asm__ volatile(
+        "movq %1, %%rax\n"
+        "movq %2, %%rdi\n"
+        "syscall\n"
+        "movq %%rax, %0\n"
+        : "=r"(result)
+        : "i"((uint64_t)SYSCALL_CLOSE), "r"((uint64_t)fd)
+        : "rax", "rdi", "memory");
+    return (int)result;
+}
+
+static inline int64_t syscall_read(int fd, void *buf, size_t n)
+{
+    int64_t result;
+    __asm__ volatile(
+        "movq %1, %%rax\n"
+        "movq %2, %%rdi\n"
+        "movq %3, %%rsi\n"
+        "movq %4, %%rdx\n"
+        "syscall\n"
+        "movq %%rax, %0\n"
+        : "=r"(result)
+        : "i"((uint64_t)SYSCALL_READ), "r"((uint64_t)fd), "r"((uint64_t)buf), "r"((uint64_t)n)
+        : "rax", "rdi", "rsi", "rdx", "memory");
+    return result;
+}
+
+static inline int64_t syscall_write(int fd, const void *buf, size_t n)
+{
+    int64_t result;
+    __asm__ volatile(
+        "movq %1, %%rax\n"
+        "movq %2, %%rdi\n"
+        "movq %3, %%rsi\n"
+        "movq %4, %%rdx\n"
+        "syscall\n"
+        "movq %%rax, %0\n"
+        : "=r"(result)
+        : "i"((uint64_t)SYSCALL_WRITE), "r"((uint64_t)fd), "r"((uint64_t)buf), "r"((uint64_t)n)
+        : "rax", "rdi", "rsi", "rdx", "memory");
+    return result;
+}
+
+static inline int64_t syscall_pread(int fd, void *buf, size_t n, uint64_t off)
+{
+    int64_t result;
+    __asm__ volatile(
+        "movq %1, %%rax\n"
+        "movq %2, %%rdi\n"
+        "movq %3, %%rsi\n"
+        "movq %4, %%rdx\n"
+        "movq %5, %%r10\n"
+        "syscall\n"
+        "movq %%rax, %0\n"
+        : "=r"(result)
+        : "i"((uint64_t)SYSCALL_PREAD), "r"((uint64_t)fd), "r"((uint64_t)buf), "r"((uint64_t)n), "r"(off)
+        : "rax", "rdi", "rsi", "rdx", "r10", "memory");
+    return result;
+}
+
+static inline int64_t syscall_pwrite(int fd, const void *buf, size_t n, uint64_t off)
+{
+    int64_t result;
+    __asm__ volatile(
+        "movq %1, %%rax\n"
+        "movq %2, %%rdi\n"
+        "movq %3, %%rsi\n"
+        "movq %4, %%rdx\n"
+        "movq %5, %%r10\n"
+        "syscall\n"
+        "movq %%rax, %0\n"
+        : "=r"(result)
+        : "i"((uint64_t)SYSCALL_PWRITE), "r"((uint64_t)fd), "r"((uint64_t)buf), "r"((uint64_t)n), "r"(off)
+        : "rax", "rdi", "rsi", "rdx", "r10", "memory");
+    return result;
+}
+
+static inline int64_t syscall_lseek(int fd, int64_t off, int whence)
+{
+    int64_t result;
+    __asm__ volatile(
+        "movq %1, %%rax\n"
+        "movq %2, %%rdi\n"
+        "movq %3, %%rsi\n"
+        "movq %4, %%rdx\n"
+        "syscall\n"
+        "movq %%rax, %0\n"
+        : "=r"(result)
+        : "i"((uint64_t)SYSCALL_LSEEK), "r"((uint64_t)fd), "r"((uint64_t)off), "r"((uint64_t)whence)
+        : "rax", "rdi", "rsi", "rdx", "memory");
+    return result;
+}
+
+static inline int syscall_ftruncate(int fd, uint64_t len)
+{
+    int64_t result;
+    __asm__ volatile(
+        "movq %1, %%rax\n"
+        "movq %2, %%rdi\n"
+        "movq %3, %%rsi\n"
+        "syscall\n"
+        "movq %%rax, %0\n"
+        : "=r"(result)
+        : "i"((uint64_t)SYSCALL_FTRUNCATE), "r"((uint64_t)fd), "r"(len)
+        : "rax", "rdi", "rsi", "memory");
+    return (int)result;
+}
+
 static inline int syscall_getchar(void)
 {
     int result;
@@ -3,7 +3,11 @@
 #include "../vga/vga.h"
 #include "../syscall/syscall.h"
 #include "../fat16/fs.h"
+#include "../block/bcache.h"
+#include "../sync/spinlock.h"
 #include "../malloc/user_malloc.h"
+#include "../vmm/pmm.h"
+#include "../vmm/vmm.h"
 
 typedef struct
 {
@@ -33,6 +37,34 @@ void zombie_reaper_task(void)
     }
 }
 
+/* Фоновое обнуление фреймов: пул для page fault и таблиц страниц,
+   резерв для роста стеков ядра.
+   Приоритетов у планировщика нет — задача делает небольшую пачку и
+   засыпает до следующего тика, поэтому занимает CPU только в простое. */
+void zero_page_task(void)
+{
+    for (;;)
+    {
+        pmm_zero_pool_refill(ZPOOL_BATCH);
+        vmm_kstack_refill();
+        asm volatile("hlt");
+    }
+}
+
+/* Отложенная запись: изменения FAT — в кэш, затем на устройство пачка
+   буферов, грязных дольше BCACHE_DIRTY_SECS */
+void bcache_flusher_task(void)
+{
+    for (;;)
+    {
+        unsigned long flags = local_irq_save();
+        fs_sync(0);
+        local_irq_restore(flags);
+        bcache_writeback(BCACHE_FLUSH_BATCH);
+        asm volatile("hlt");
+    }
+}
+
 void load_and_run_terminal(void)
 {
     // 1. Найти /bin
@@ -46,16 +78,8 @@ void load_and_run_terminal(void)
     if (file_idx < 0)
         return; // файл не найден
 
-    // 3. Выделить память для файла через user_malloc
-    void *user_mem = user_malloc(entry.size + 1024);
-    if (!user_mem)
-        return; // ошибка выделения памяти
-
-    // 4. Прочитать файл в user_mem
-    fs_read_file_in_dir("terminal", "bin", bin_idx, user_mem, entry.size, NULL);
-
-    // 5. Создать задачу и передать туда файл
-    uint64_t pid = utask_create((void (*)(void))user_mem, 0, user_mem, entry.size);
+    // 3. Задача с образом прямо из файла
+    utask_exec(file_idx, KSTACK_USER_SIZE);
 }
 
 /* Регистрация всех стартовых задач */
@@ -66,4 +90,9 @@ void tasks_init(void)
     load_and_run_terminal();
 
     task_create(zombie_reaper_task, 0);
+
+    task_create(zero_page_task, 0);
+
+    if (bcache_enabled())
+        task_create(bcache_flusher_task, 0);
 }
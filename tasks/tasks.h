@@ -4,6 +4,8 @@
 /* Объявления функций задач */
 void user_task1(void);
 void user_task2(void);
+void zero_page_task(void);
+void bcache_flusher_task(void);
 
 /* Инициализация задач при старте системы */
 void tasks_init(void);
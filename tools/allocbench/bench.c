@@ -0,0 +1,641 @@
+// bench.c — хостовые бенчмарки и рандомизированная проверка malloc.c/user_malloc.c
+//
+//   allocbench bench [ops] [seed]   — ops/sec, пиковый footprint, фрагментация
+//   allocbench check [ops] [seed]   — случайные операции (и memalign) + проверка содержимого,
+//                                     перекрытий и статистики; код возврата 1 при ошибке
+//
+// Ядровые malloc/free/realloc собраны под именами kmalloc/kfree/krealloc
+// (см. цель bench в Makefile), чтобы не конфликтовать с libc хоста.
+#define malloc kmalloc
+#define free kfree
+#define realloc krealloc
+#define memalign kmemalign
+#define aligned_alloc kaligned_alloc
+#include "../../malloc/malloc.h"
+#undef malloc
+#undef free
+#undef realloc
+#undef memalign
+#undef aligned_alloc
+#include "../../malloc/user_malloc.h"
+#include "../../vmm/vmm.h"
+#include "shim.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+extern char _heap_start;
+extern char _heap_end;
+extern char _user_start;
+extern char _user_end;
+
+/* ------------------------- аллокаторы ------------------------- */
+
+typedef struct allocator
+{
+    const char *name;
+    void (*begin)(void); /* перед прогоном: пустая куча */
+    void (*end)(void);   /* после прогона: всё освобождено */
+    void *(*alloc)(size_t size);
+    void (*release)(void *p);
+    void *(*resize)(void *p, size_t size);
+    void (*stats)(size_t *used, size_t *free_total, size_t *largest);
+    const char *lo, *hi; /* регион блочной кучи: для high-water */
+    void *(*aligned)(size_t align, size_t size); /* NULL — не поддерживается */
+} allocator_t;
+
+static void kernel_begin(void)
+{
+    malloc_init(&_heap_start, (size_t)(&_heap_end - &_heap_start));
+    malloc_large_init();
+    shim_frames_reset_peak();
+}
+
+static void kernel_end(void)
+{
+    if (shim_frames_in_use())
+        fprintf(stderr, "kmalloc: %zu large frames leaked\n", shim_frames_in_use());
+}
+
+static void kernel_stats(size_t *used, size_t *free_total, size_t *largest)
+{
+    kmalloc_stats_t st;
+    kmalloc_large_stats_t ls;
+    get_kmalloc_stats(&st);
+    get_kmalloc_large_stats(&ls);
+    *used = st.used_payload + ls.requested_bytes;
+    *free_total = st.free_payload;
+    *largest = st.largest_free;
+}
+
+/* Общая .user область не сбрасывается (user_malloc_init однократный) —
+   каждый прогон освобождает всё, и блоки сливаются обратно */
+static void user_begin(void)
+{
+    user_malloc_init();
+    shim_set_arena(NULL);
+}
+
+static void user_end(void) {}
+
+static void user_stats(size_t *used, size_t *free_total, size_t *largest)
+{
+    umalloc_stats_t st;
+    memset(&st, 0, sizeof(st));
+    get_usermalloc_stats(NULL, &st);
+    *used = st.used_payload;
+    *free_total = st.free_payload;
+    *largest = st.largest_free;
+}
+
+static user_arena_t *bench_arena = NULL;
+
+static void arena_begin(void)
+{
+    user_malloc_init();
+    bench_arena = user_arena_create(USER_ARENA_CHUNK);
+    shim_set_arena(bench_arena);
+}
+
+static void arena_end(void)
+{
+    shim_set_arena(NULL);
+    user_arena_destroy(bench_arena);
+    bench_arena = NULL;
+}
+
+static void arena_stats(size_t *used, size_t *free_total, size_t *largest)
+{
+    umalloc_stats_t st;
+    memset(&st, 0, sizeof(st));
+    get_usermalloc_stats(bench_arena, &st);
+    *used = st.used_payload;
+    *free_total = st.free_payload;
+    *largest = st.largest_free;
+}
+
+static allocator_t allocators[] = {
+    {"kmalloc", kernel_begin, kernel_end, kmalloc, kfree, krealloc, kernel_stats, &_heap_start, &_heap_end, kmemalign},
+    {"user_malloc", user_begin, user_end, user_malloc, user_free, user_realloc, user_stats, &_user_start, &_user_end, NULL},
+    {"user_arena", arena_begin, arena_end, user_malloc, user_free, user_realloc, arena_stats, &_user_start, &_user_end, NULL},
+};
+#define NUM_ALLOCATORS (sizeof(allocators) / sizeof(allocators[0]))
+
+/* ------------------------- учёт прогона ------------------------- */
+
+typedef struct
+{
+    const allocator_t *a;
+    uint64_t ops;
+    uint64_t failed;
+    size_t live;      /* запрошенные байты живых объектов */
+    size_t peak_live;
+    size_t high_water; /* максимальный конец блока в регионе кучи */
+    size_t frag_permille;
+} run_t;
+
+static uint64_t rng_state;
+
+static inline uint64_t rng(void)
+{
+    /* xorshift64*: воспроизводимо между платформами */
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+static inline size_t rng_range(size_t lo, size_t hi)
+{
+    return lo + (size_t)(rng() % (hi - lo + 1));
+}
+
+/* 80% мелких, 15% средних, 5% крупных (идут мимо списка блоков kmalloc) */
+static size_t rng_size(void)
+{
+    unsigned r = (unsigned)(rng() % 100);
+    if (r < 80)
+        return rng_range(8, 256);
+    if (r < 95)
+        return rng_range(257, 4096);
+    return rng_range(4097, 64 * 1024);
+}
+
+static void note_block(run_t *r, void *p, size_t size)
+{
+    const char *c = (const char *)p;
+    if (c >= r->a->lo && c < r->a->hi)
+    {
+        size_t end = (size_t)(c + size - r->a->lo);
+        if (end > r->high_water)
+            r->high_water = end;
+    }
+}
+
+static void *run_alloc(run_t *r, size_t size)
+{
+    r->ops++;
+    void *p = r->a->alloc(size);
+    if (!p)
+    {
+        r->failed++;
+        return NULL;
+    }
+    note_block(r, p, size);
+    r->live += size;
+    if (r->live > r->peak_live)
+        r->peak_live = r->live;
+    /* касаемся краёв — как реальный пользователь памяти */
+    ((volatile char *)p)[0] = 1;
+    ((volatile char *)p)[size - 1] = 1;
+    return p;
+}
+
+static void run_free(run_t *r, void *p, size_t size)
+{
+    r->ops++;
+    r->a->release(p);
+    r->live -= size;
+}
+
+static void *run_realloc(run_t *r, void *p, size_t old, size_t size)
+{
+    r->ops++;
+    void *np = r->a->resize(p, size);
+    if (!np)
+    {
+        r->failed++;
+        return NULL;
+    }
+    note_block(r, np, size);
+    r->live = r->live - old + size;
+    if (r->live > r->peak_live)
+        r->peak_live = r->live;
+    ((volatile char *)np)[size - 1] = 1;
+    return np;
+}
+
+/* Фрагментация как в kmalloc_profile: 1000 * (1 - largest_free / free_total) */
+static void sample_frag(run_t *r)
+{
+    size_t used, free_total, largest;
+    r->a->stats(&used, &free_total, &largest);
+    r->frag_permille = free_total ? 1000 - (largest * 1000) / free_total : 0;
+}
+
+/* ------------------------- нагрузки ------------------------- */
+
+#define LIVE_SLOTS 2048
+
+typedef struct
+{
+    void *p;
+    size_t size;
+} slot_t;
+
+static slot_t slots[LIVE_SLOTS];
+
+static void release_all(run_t *r)
+{
+    for (size_t i = 0; i < LIVE_SLOTS; ++i)
+    {
+        if (slots[i].p)
+            run_free(r, slots[i].p, slots[i].size);
+        slots[i].p = NULL;
+    }
+}
+
+/* Случайные alloc/free над фиксированным числом слотов */
+static void work_random(run_t *r, uint64_t ops)
+{
+    while (r->ops < ops)
+    {
+        slot_t *s = &slots[rng() % LIVE_SLOTS];
+        if (s->p)
+        {
+            run_free(r, s->p, s->size);
+            s->p = NULL;
+        }
+        else
+        {
+            s->size = rng_size();
+            s->p = run_alloc(r, s->size);
+        }
+    }
+    sample_frag(r);
+    release_all(r);
+}
+
+/* Производитель/потребитель: FIFO-очередь, освобождение в порядке выделения */
+static void work_prodcons(run_t *r, uint64_t ops)
+{
+    size_t head = 0, tail = 0; /* [tail, head) — в очереди */
+    while (r->ops < ops)
+    {
+        size_t burst = rng_range(1, 32);
+        for (size_t i = 0; i < burst && head - tail < LIVE_SLOTS; ++i, ++head)
+        {
+            slot_t *s = &slots[head % LIVE_SLOTS];
+            s->size = rng_range(16, 2048);
+            s->p = run_alloc(r, s->size);
+        }
+        burst = rng_range(1, 32);
+        for (size_t i = 0; i < burst && tail < head; ++i, ++tail)
+        {
+            slot_t *s = &slots[tail % LIVE_SLOTS];
+            if (s->p)
+                run_free(r, s->p, s->size);
+            s->p = NULL;
+        }
+    }
+    sample_frag(r);
+    release_all(r);
+}
+
+/* Растущие буферы (логи, массивы) вперемешку с мелкими объектами,
+   которые мешают росту на месте */
+#define GROW_BUFFERS 64
+#define GROW_LIMIT (1024 * 1024)
+
+static void work_realloc(run_t *r, uint64_t ops)
+{
+    while (r->ops < ops)
+    {
+        size_t i = (size_t)(rng() % GROW_BUFFERS);
+        slot_t *s = &slots[i];
+        if (!s->p)
+        {
+            s->size = rng_range(16, 256);
+            s->p = run_alloc(r, s->size);
+        }
+        else if (s->size >= GROW_LIMIT)
+        {
+            run_free(r, s->p, s->size);
+            s->p = NULL;
+        }
+        else
+        {
+            size_t ns = s->size + s->size / 4 + 16;
+            void *np = run_realloc(r, s->p, s->size, ns);
+            if (np)
+            {
+                s->p = np;
+                s->size = ns;
+            }
+        }
+
+        /* шум: мелкий объект живёт в одном из остальных слотов */
+        slot_t *n = &slots[GROW_BUFFERS + rng() % (LIVE_SLOTS - GROW_BUFFERS)];
+        if (n->p)
+            run_free(r, n->p, n->size);
+        n->size = rng_range(8, 128);
+        n->p = run_alloc(r, n->size);
+    }
+    sample_frag(r);
+    release_all(r);
+}
+
+typedef struct
+{
+    const char *name;
+    void (*fn)(run_t *r, uint64_t ops);
+} workload_t;
+
+static const workload_t workloads[] = {
+    {"random", work_random},
+    {"prodcons", work_prodcons},
+    {"realloc", work_realloc},
+};
+#define NUM_WORKLOADS (sizeof(workloads) / sizeof(workloads[0]))
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int cmd_bench(uint64_t ops, uint64_t seed)
+{
+    printf("%-12s %-9s %12s %11s %11s %6s %7s\n",
+           "allocator", "workload", "ops/sec", "peak KiB", "live KiB", "frag", "failed");
+    for (size_t ai = 0; ai < NUM_ALLOCATORS; ++ai)
+    {
+        for (size_t wi = 0; wi < NUM_WORKLOADS; ++wi)
+        {
+            run_t r;
+            memset(&r, 0, sizeof(r));
+            memset(slots, 0, sizeof(slots));
+            r.a = &allocators[ai];
+            rng_state = seed;
+
+            r.a->begin();
+            double t0 = now_sec();
+            workloads[wi].fn(&r, ops);
+            double t1 = now_sec();
+            size_t large_peak = (r.a->begin == kernel_begin) ? shim_frames_peak() * 4096 : 0;
+            r.a->end();
+
+            double rate = (t1 > t0) ? (double)r.ops / (t1 - t0) : 0.0;
+            printf("%-12s %-9s %12.0f %11zu %11zu %5zu‰ %7llu\n",
+                   r.a->name, workloads[wi].name, rate,
+                   (r.high_water + large_peak) / 1024, r.peak_live / 1024,
+                   r.frag_permille, (unsigned long long)r.failed);
+        }
+    }
+    return 0;
+}
+
+/* ------------------------- проверка ------------------------- */
+
+typedef struct
+{
+    void *p;
+    size_t size;
+    uint8_t tag;
+} check_slot_t;
+
+static check_slot_t cslots[LIVE_SLOTS];
+static check_slot_t *sorted[LIVE_SLOTS];
+
+static int check_failed(const allocator_t *a, uint64_t op, const char *what)
+{
+    fprintf(stderr, "%s: op %llu: %s\n", a->name, (unsigned long long)op, what);
+    return 1;
+}
+
+static int verify_fill(const check_slot_t *s, size_t n)
+{
+    const uint8_t *b = (const uint8_t *)s->p;
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (b[i] != (uint8_t)(s->tag + i))
+            return 0;
+    }
+    return 1;
+}
+
+static void fill(check_slot_t *s)
+{
+    uint8_t *b = (uint8_t *)s->p;
+    for (size_t i = 0; i < s->size; ++i)
+        b[i] = (uint8_t)(s->tag + i);
+}
+
+static int by_addr(const void *x, const void *y)
+{
+    uintptr_t a = (uintptr_t)(*(check_slot_t *const *)x)->p;
+    uintptr_t b = (uintptr_t)(*(check_slot_t *const *)y)->p;
+    return (a > b) - (a < b);
+}
+
+/* Полная сверка: содержимое, выравнивание, перекрытия, статистика */
+static int check_all(const allocator_t *a, uint64_t op)
+{
+    size_t n = 0, live = 0;
+    for (size_t i = 0; i < LIVE_SLOTS; ++i)
+    {
+        check_slot_t *s = &cslots[i];
+        if (!s->p)
+            continue;
+        if ((uintptr_t)s->p % 8)
+            return check_failed(a, op, "misaligned block");
+        if (!verify_fill(s, s->size))
+            return check_failed(a, op, "block contents corrupted");
+        sorted[n++] = s;
+        live += s->size;
+    }
+
+    qsort(sorted, n, sizeof(sorted[0]), by_addr);
+    for (size_t i = 1; i < n; ++i)
+    {
+        if ((char *)sorted[i - 1]->p + sorted[i - 1]->size > (char *)sorted[i]->p)
+            return check_failed(a, op, "overlapping blocks");
+    }
+
+    size_t used, free_total, largest;
+    a->stats(&used, &free_total, &largest);
+    if (used < live)
+        return check_failed(a, op, "stats report fewer used bytes than live");
+    if (largest > free_total)
+        return check_failed(a, op, "largest free block exceeds free total");
+    return 0;
+}
+
+static int check_allocator(const allocator_t *a, uint64_t ops)
+{
+    memset(cslots, 0, sizeof(cslots));
+    a->begin();
+
+    int rc = 0;
+    for (uint64_t op = 0; op < ops && !rc; ++op)
+    {
+        check_slot_t *s = &cslots[rng() % LIVE_SLOTS];
+        unsigned action = (unsigned)(rng() % 4);
+
+        if (!s->p)
+        {
+            s->size = rng_size();
+            s->tag = (uint8_t)rng();
+            size_t align = (a->aligned && action == 0) ? (size_t)16 << (rng() % 9) : 0;
+            s->p = align ? a->aligned(align, s->size) : a->alloc(s->size);
+            if (s->p && align && ((uintptr_t)s->p & (align - 1)))
+                rc = check_failed(a, op, "memalign returned a misaligned block");
+            if (s->p)
+                fill(s);
+        }
+        else if (action == 0)
+        {
+            /* realloc: префикс должен сохраниться */
+            size_t ns = rng_size();
+            size_t keep = (ns < s->size) ? ns : s->size;
+            void *np = a->resize(s->p, ns);
+            if (!np)
+                continue;
+            s->p = np;
+            if (!verify_fill(s, keep))
+                rc = check_failed(a, op, "realloc lost contents");
+            s->size = ns;
+            fill(s);
+        }
+        else
+        {
+            if (!verify_fill(s, s->size))
+                rc = check_failed(a, op, "block contents corrupted before free");
+            a->release(s->p);
+            s->p = NULL;
+        }
+
+        if (!rc && (op % 4096) == 4095)
+            rc = check_all(a, op);
+    }
+
+    if (!rc)
+        rc = check_all(a, ops);
+    for (size_t i = 0; i < LIVE_SLOTS; ++i)
+    {
+        if (cslots[i].p)
+            a->release(cslots[i].p);
+        cslots[i].p = NULL;
+    }
+
+    size_t used, free_total, largest;
+    a->stats(&used, &free_total, &largest);
+    if (!rc && a->begin != arena_begin && used != 0)
+        rc = check_failed(a, ops, "used bytes remain after freeing everything");
+    a->end();
+
+    printf("%-12s %s\n", a->name, rc ? "FAILED" : "ok");
+    return rc;
+}
+
+/* Крупный буфер перерастает свою серию слотов (2 MiB каждый): realloc должен
+   переехать перестановкой страниц и сохранить содержимое */
+static int check_large_move(void)
+{
+    const size_t from = 48u << 20, to = 200u << 20;
+    kmalloc_large_stats_t before, after;
+    kernel_begin();
+    get_kmalloc_large_stats(&before);
+
+    uint64_t *p = kmalloc(from);
+    int rc = !p;
+    for (size_t i = 0; !rc && i < from / 8; i += 512)
+        p[i] = i * 0x9E3779B97F4A7C15ULL;
+
+    uint64_t *np = rc ? NULL : krealloc(p, to);
+    if (!rc && !np)
+        rc = 1;
+    for (size_t i = 0; !rc && i < from / 8; i += 512)
+        if (np[i] != i * 0x9E3779B97F4A7C15ULL)
+            rc = 1;
+    if (!rc)
+    {
+        np[to / 8 - 1] = 1; /* новые страницы отображены */
+        get_kmalloc_large_stats(&after);
+        if (after.moves != before.moves + 1 || after.committed_bytes - before.committed_bytes != to)
+            rc = 1;
+    }
+    kfree(rc ? p : np);
+    get_kmalloc_large_stats(&after);
+    if (after.committed_bytes != before.committed_bytes)
+        rc = 1;
+    kernel_end();
+
+    printf("%-12s %s\n", "large move", rc ? "FAILED" : "ok");
+    return rc;
+}
+
+/* Окно не может дать объект: больше всего окна (нет серии слотов) или нет
+   фреймов. Запрос по силам куче должен уйти в список блоков, realloc —
+   переехать туда копированием, и оба случая посчитаны по отдельности */
+static int check_large_fallback(void)
+{
+    kmalloc_large_stats_t before, after;
+    kernel_begin();
+    get_kmalloc_large_stats(&before);
+
+    int rc = kmalloc((size_t)KWIN_LARGE_SIZE + 4096) != NULL; /* не помещается и в кучу */
+
+    uint64_t *big = kmalloc(64 * 1024);
+    shim_frames_limit(1);
+    uint64_t *p = kmalloc(64 * 1024);
+    if (!big || !p || shim_frames_in_use() != 16)
+        rc = 1;
+    for (size_t i = 0; !rc && i < 64 * 1024 / 8; ++i)
+        big[i] = p[i] = i * 0x9E3779B97F4A7C15ULL;
+
+    uint64_t *nb = rc ? NULL : krealloc(big, 512 * 1024);
+    if (!rc && !nb)
+        rc = 1;
+    for (size_t i = 0; !rc && i < 64 * 1024 / 8; ++i)
+        if (nb[i] != i * 0x9E3779B97F4A7C15ULL || p[i] != nb[i])
+            rc = 1;
+    shim_frames_limit(0);
+
+    get_kmalloc_large_stats(&after);
+    if (after.no_slots != before.no_slots + 1 || after.failed != before.failed + 2)
+        rc = 1;
+    if (!rc && shim_frames_in_use() != 0) /* старые страницы big сняты */
+        rc = 1;
+    kfree(rc ? big : nb);
+    kfree(p);
+    if (shim_frames_in_use())
+        rc = 1;
+    kernel_end();
+
+    printf("%-12s %s\n", "large heap", rc ? "FAILED" : "ok");
+    return rc;
+}
+
+static int cmd_check(uint64_t ops, uint64_t seed)
+{
+    int rc = check_large_move();
+    rc |= check_large_fallback();
+    for (size_t ai = 0; ai < NUM_ALLOCATORS; ++ai)
+    {
+        rng_state = seed;
+        rc |= check_allocator(&allocators[ai], ops);
+    }
+    return rc;
+}
+
+int main(int argc, char **argv)
+{
+    const char *cmd = (argc > 1) ? argv[1] : "bench";
+    uint64_t ops = (argc > 2) ? strtoull(argv[2], NULL, 0) : 1000000;
+    uint64_t seed = (argc > 3) ? strtoull(argv[3], NULL, 0) : 0x9E3779B97F4A7C15ULL;
+    if (seed == 0)
+        seed = 1; /* xorshift не выходит из нуля */
+
+    if (strcmp(cmd, "bench") == 0)
+        return cmd_bench(ops, seed);
+    if (strcmp(cmd, "check") == 0)
+        return cmd_check(ops, seed);
+
+    fprintf(stderr, "usage: %s bench|check [ops] [seed]\n", argv[0]);
+    return 2;
+}
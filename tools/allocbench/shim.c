@@ -0,0 +1,157 @@
+// shim.c — окружение ядра для хост-сборки malloc.c/user_malloc.c
+// Регионы из link.ld — bss-секции нужного размера, окно ядра — mmap-резерв,
+// VGA — заглушки. Только для tools/allocbench, в ядро не линкуется.
+#define _GNU_SOURCE /* mremap */
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+
+#include "../../vga/vga.h"
+#include "../../vmm/vmm.h"
+#include "../../multitask/multitask.h"
+#include "shim.h"
+
+/* .heap и .user: по 128 MiB, как в link.ld. Символы начала и конца кладём
+   вокруг одного .skip, чтобы &_user_end - &_user_start был размером региона. */
+#define SHIM_STR_(x) #x
+#define SHIM_STR(x) SHIM_STR_(x)
+#define SHIM_REGION(name, size)                          \
+    asm(".section .bss." #name ",\"aw\",@nobits\n"       \
+        ".balign 4096\n"                                 \
+        ".globl _" #name "_start\n_" #name "_start:\n"   \
+        ".skip " SHIM_STR(size) "\n"                     \
+        ".globl _" #name "_end\n_" #name "_end:\n"       \
+        ".previous")
+
+SHIM_REGION(heap, SHIM_HEAP_SIZE);
+SHIM_REGION(user, SHIM_USER_SIZE);
+
+/* ------------------------- фреймы и окно ядра ------------------------- */
+
+#define WIN_PAGES (KWIN_LARGE_SIZE / PAGE_SIZE)
+
+static uint64_t mapped[WIN_PAGES / 64]; /* 1 — страница окна отображена */
+static size_t frames_in_use = 0;
+static size_t frames_peak = 0;
+static size_t frames_limit = 0;
+static uint64_t next_frame = 1;
+static int window_ready = 0;
+
+static void window_reserve(void)
+{
+    if (window_ready)
+        return;
+    void *p = mmap((void *)(uintptr_t)KWIN_LARGE_BASE, KWIN_LARGE_SIZE, PROT_NONE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED_NOREPLACE, -1, 0);
+    if (p != (void *)(uintptr_t)KWIN_LARGE_BASE)
+    {
+        fprintf(stderr, "shim: cannot reserve kernel window at %#llx\n",
+                (unsigned long long)KWIN_LARGE_BASE);
+        exit(2);
+    }
+    window_ready = 1;
+}
+
+uint64_t pmm_alloc_frame(void)
+{
+    /* Физической памяти нет — фрейм это просто ненулевой жетон */
+    if (frames_limit && frames_in_use >= frames_limit)
+        return 0;
+    frames_in_use++;
+    if (frames_in_use > frames_peak)
+        frames_peak = frames_in_use;
+    return (next_frame++) << PAGE_SHIFT;
+}
+
+uint64_t pmm_alloc_zeroed_frame(void) { return pmm_alloc_frame(); }
+
+void pmm_free_frame(uint64_t phys)
+{
+    if (phys && frames_in_use)
+        frames_in_use--;
+}
+
+size_t pmm_total_frames(void) { return PMM_MAX_FRAMES; }
+size_t pmm_free_frames(void) { return PMM_MAX_FRAMES - frames_in_use; }
+
+int vmm_kmap(uint64_t va, uint64_t pa)
+{
+    window_reserve();
+    if (va < KWIN_LARGE_BASE || va >= KWIN_LARGE_BASE + KWIN_LARGE_SIZE)
+        return -1;
+    size_t idx = (size_t)((va - KWIN_LARGE_BASE) >> PAGE_SHIFT);
+    if (mprotect((void *)(uintptr_t)va, PAGE_SIZE, PROT_READ | PROT_WRITE) != 0)
+        return -1;
+    mapped[idx / 64] |= 1ULL << (idx % 64);
+    (void)pa;
+    return 0;
+}
+
+uint64_t vmm_kunmap(uint64_t va)
+{
+    if (va < KWIN_LARGE_BASE || va >= KWIN_LARGE_BASE + KWIN_LARGE_SIZE)
+        return 0;
+    size_t idx = (size_t)((va - KWIN_LARGE_BASE) >> PAGE_SHIFT);
+    if (!(mapped[idx / 64] & (1ULL << (idx % 64))))
+        return 0;
+    mapped[idx / 64] &= ~(1ULL << (idx % 64));
+    /* Отдаём страницу ОС и снова закрываем доступ — как снятый PTE */
+    madvise((void *)(uintptr_t)va, PAGE_SIZE, MADV_DONTNEED);
+    mprotect((void *)(uintptr_t)va, PAGE_SIZE, PROT_NONE);
+    return PAGE_SIZE; /* любой ненулевой жетон: pmm_free_frame его только считает */
+}
+
+int vmm_kmove(uint64_t from, uint64_t to)
+{
+    if (from < KWIN_LARGE_BASE || from >= KWIN_LARGE_BASE + KWIN_LARGE_SIZE ||
+        to < KWIN_LARGE_BASE || to >= KWIN_LARGE_BASE + KWIN_LARGE_SIZE)
+        return -1;
+    size_t fi = (size_t)((from - KWIN_LARGE_BASE) >> PAGE_SHIFT);
+    size_t ti = (size_t)((to - KWIN_LARGE_BASE) >> PAGE_SHIFT);
+    if (!(mapped[fi / 64] & (1ULL << (fi % 64))) || (mapped[ti / 64] & (1ULL << (ti % 64))))
+        return -1;
+    /* mremap переносит саму страницу, как перестановка PTE; на старом месте
+       остаётся дыра — закрываем её снова резервом PROT_NONE */
+    if (mremap((void *)(uintptr_t)from, PAGE_SIZE, PAGE_SIZE, MREMAP_MAYMOVE | MREMAP_FIXED,
+               (void *)(uintptr_t)to) != (void *)(uintptr_t)to)
+        return -1;
+    mmap((void *)(uintptr_t)from, PAGE_SIZE, PROT_NONE,
+         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+    mapped[fi / 64] &= ~(1ULL << (fi % 64));
+    mapped[ti / 64] |= 1ULL << (ti % 64);
+    return 0;
+}
+
+size_t shim_frames_in_use(void) { return frames_in_use; }
+size_t shim_frames_peak(void) { return frames_peak; }
+void shim_frames_reset_peak(void) { frames_peak = frames_in_use; }
+void shim_frames_limit(size_t n) { frames_limit = n ? frames_in_use + n : 0; }
+
+/* ------------------------- задачи ------------------------- */
+
+static task_t shim_task;
+
+task_t *get_current_task(void) { return &shim_task; }
+
+void shim_set_arena(struct user_arena *a) { shim_task.arena = a; }
+
+/* ------------------------- VGA ------------------------- */
+
+void print_string_position(const char *str, const unsigned int x, const unsigned int y,
+                           const uint8_t fore, const uint8_t back)
+{
+    (void)str;
+    (void)x;
+    (void)y;
+    (void)fore;
+    (void)back;
+}
+
+void print_string(const char *str, const uint8_t fore, const uint8_t back)
+{
+    (void)str;
+    (void)fore;
+    (void)back;
+}
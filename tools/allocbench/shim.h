@@ -0,0 +1,22 @@
+#ifndef ALLOCBENCH_SHIM_H
+#define ALLOCBENCH_SHIM_H
+
+#include <stddef.h>
+
+/* Размеры регионов как в link.ld (числом: подставляются в .skip) */
+#define SHIM_HEAP_SIZE 134217728
+#define SHIM_USER_SIZE 134217728
+
+struct user_arena;
+
+/* Фреймы, выданные пути крупных объектов kmalloc */
+size_t shim_frames_in_use(void);
+size_t shim_frames_peak(void);
+void shim_frames_reset_peak(void);
+/* Сколько фреймов можно выдать сверх занятых (0 — без ограничения) */
+void shim_frames_limit(size_t n);
+
+/* Арена "текущей задачи" для user_malloc (NULL — общая .user область) */
+void shim_set_arena(struct user_arena *a);
+
+#endif // ALLOCBENCH_SHIM_H
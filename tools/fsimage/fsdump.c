@@ -0,0 +1,259 @@
+// fsdump.c — посмотреть, проверить и сравнить образы тома (формат fat16/fs.h)
+//
+//   fsdump [-u] image            суперблок, заполненность и все записи
+//   fsdump [-u] -c image         проверка (fs_fsck без починки), код 1 — есть нарушения
+//   fsdump [-u] -r image         проверка с починкой, образ перезаписывается
+//   fsdump [-u] -d image1 image2 разница: записи только в одном образе, разные файлы
+//
+// -u — образ как неотображённое устройство, через кэш буферов.
+//
+// Том подключает тот же fat16/fs.c, что работает в ядре, и та же проверка,
+// что идёт при загрузке.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../fat16/fs.h"
+#include "shim.h"
+
+/* Запись тома, как её видит сравнение: полный путь и отпечаток данных */
+typedef struct
+{
+    char path[256];
+    int is_dir;
+    uint32_t size;
+    uint64_t hash;
+} dump_entry_t;
+
+static uint8_t *image_mem = NULL;
+static size_t image_size = 0;
+static int image_mapped = 1;
+
+static int load(const char *image, int repair, fs_fsck_t *report)
+{
+    free(image_mem);
+    image_mem = shim_read_file(image, &image_size);
+    if (!image_mem)
+    {
+        fprintf(stderr, "fsdump: cannot read %s\n", image);
+        return -1;
+    }
+    blkdev_t *dev = shim_image_dev(image_mem, image_size & ~(size_t)(BLK_SECTOR_SIZE - 1), image_mapped);
+    int found = dev ? fs_mount(dev, repair, report) : -1;
+    if (found < 0)
+        fprintf(stderr, "fsdump: %s: no volume (%d)\n", image, found);
+    return found;
+}
+
+static void append(char *out, size_t size, const char *s)
+{
+    size_t len = strlen(out);
+    if (len + 1 < size)
+        strncat(out, s, size - len - 1);
+}
+
+/* Путь от корня по родителям; у испорченного тома родители могут идти по
+   кругу или вести за таблицу — глубина ограничена, недошедший путь с '?' */
+#define PATH_DEPTH 32
+
+static void entry_path(int idx, char *out, size_t size)
+{
+    int chain[PATH_DEPTH];
+    int n = 0;
+    fs_entry_t e;
+    while (idx != FS_ROOT_IDX && n < PATH_DEPTH && fs_get_entry(idx, &e) == 0)
+    {
+        chain[n++] = idx;
+        idx = e.parent;
+    }
+
+    out[0] = '\0';
+    if (idx != FS_ROOT_IDX)
+        append(out, size, "?");
+    while (n-- > 0)
+    {
+        fs_get_entry(chain[n], &e);
+        append(out, size, "/");
+        append(out, size, e.name);
+        if (e.ext[0])
+        {
+            append(out, size, ".");
+            append(out, size, e.ext);
+        }
+    }
+    if (!out[0])
+        append(out, size, "/");
+}
+
+/* FNV-1a содержимого файла */
+static uint64_t file_hash(const fs_entry_t *e)
+{
+    uint64_t h = 14695981039346656037ULL;
+    uint8_t *buf = malloc(e->size ? e->size : 1);
+    if (!buf)
+        return 0;
+    size_t n = fs_read(e->first_cluster, buf, e->size);
+    for (size_t i = 0; i < n; ++i)
+        h = (h ^ buf[i]) * 1099511628211ULL;
+    free(buf);
+    return h;
+}
+
+/* Все записи подключённого тома в порядке индексов; count — сколько */
+static dump_entry_t *collect(int *count)
+{
+    dump_entry_t *list = calloc(FS_MAX_ENTRIES, sizeof(dump_entry_t));
+    int n = 0;
+    fs_entry_t e;
+    for (int i = 0; list && i < FS_MAX_ENTRIES; ++i)
+    {
+        if (fs_get_entry(i, &e) != 0)
+            continue;
+        entry_path(i, list[n].path, sizeof(list[n].path));
+        list[n].is_dir = e.is_dir;
+        list[n].size = e.size;
+        list[n].hash = e.is_dir ? 0 : file_hash(&e);
+        n++;
+    }
+    *count = n;
+    return list;
+}
+
+static void print_report(const char *image, int found, const fs_fsck_t *r, int repaired)
+{
+    printf("%s: %d problem%s%s\n", image, found, found == 1 ? "" : "s", found && repaired ? " repaired" : "");
+    if (!found)
+        return;
+    printf("  bad entries %u, orphans %u, duplicates %u, lost files %u\n", r->bad_entries, r->orphans,
+           r->duplicates, r->lost_files);
+    printf("  bad chains %u, cross-links %u, bad sizes %u, leaked clusters %u\n", r->bad_chains, r->cross_links,
+           r->bad_sizes, r->leaked);
+}
+
+static int cmd_dump(const char *image)
+{
+    fs_fsck_t r;
+    int found = load(image, 0, &r);
+    if (found < 0)
+        return 1;
+
+    const fs_super_t *sb = (const fs_super_t *)image_mem;
+    fs_statfs_t st;
+    fs_statfs(&st);
+    printf("%s: version %u, %llu bytes, FAT%u\n", image, sb->version, (unsigned long long)sb->volume_bytes,
+           st.fat_type);
+    printf("  dir @%llu, fat @%llu, data @%llu\n", (unsigned long long)sb->dir_off, (unsigned long long)sb->fat_off,
+           (unsigned long long)sb->data_off);
+    printf("  %u clusters of %u B, %u free; %u of %u entries\n", st.total_clusters, st.cluster_size,
+           st.free_clusters, st.used_entries, st.max_entries);
+
+    fs_entry_t e;
+    for (int i = 0; i < FS_MAX_ENTRIES; ++i)
+    {
+        if (fs_get_entry(i, &e) != 0)
+            continue;
+        char path[256];
+        entry_path(i, path, sizeof(path));
+        if (e.is_dir)
+            printf("%5d  dir  %10s  %8s  %s\n", i, "-", "-", path);
+        else
+            printf("%5d  file %10u  %8u  %s\n", i, e.size, e.first_cluster, path);
+    }
+    print_report(image, found, &r, 0);
+    return found ? 1 : 0;
+}
+
+static int cmd_check(const char *image, int repair)
+{
+    fs_fsck_t r;
+    int found = load(image, repair, &r);
+    if (found < 0)
+        return 1;
+    print_report(image, found, &r, repair);
+    if (repair && found)
+    {
+        if (fs_sync(1) != 0 || shim_write_file(image, image_mem, image_size) != 0)
+        {
+            fprintf(stderr, "fsdump: cannot write %s\n", image);
+            return 1;
+        }
+        return 0;
+    }
+    return found ? 1 : 0;
+}
+
+static const dump_entry_t *find_path(const dump_entry_t *list, int n, const char *path, int is_dir)
+{
+    for (int i = 0; i < n; ++i)
+        if (list[i].is_dir == is_dir && strcmp(list[i].path, path) == 0)
+            return &list[i];
+    return NULL;
+}
+
+static int cmd_diff(const char *image_a, const char *image_b)
+{
+    int na, nb;
+    if (load(image_a, 0, NULL) < 0)
+        return 2;
+    dump_entry_t *a = collect(&na);
+    if (load(image_b, 0, NULL) < 0)
+        return 2;
+    dump_entry_t *b = collect(&nb);
+    if (!a || !b)
+    {
+        fprintf(stderr, "fsdump: out of memory\n");
+        return 2;
+    }
+
+    int differ = 0;
+    for (int i = 0; i < na; ++i)
+    {
+        const dump_entry_t *o = find_path(b, nb, a[i].path, a[i].is_dir);
+        if (!o)
+            printf("- %s%s\n", a[i].path, a[i].is_dir ? "/" : "");
+        else if (o->size != a[i].size)
+            printf("~ %s: %u -> %u bytes\n", a[i].path, a[i].size, o->size);
+        else if (o->hash != a[i].hash)
+            printf("~ %s: contents differ\n", a[i].path);
+        else
+            continue;
+        differ = 1;
+    }
+    for (int i = 0; i < nb; ++i)
+    {
+        if (!find_path(a, na, b[i].path, b[i].is_dir))
+        {
+            printf("+ %s%s\n", b[i].path, b[i].is_dir ? "/" : "");
+            differ = 1;
+        }
+    }
+    free(a);
+    free(b);
+    return differ;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: fsdump [-u] image | [-u] -c image | [-u] -r image | [-u] -d image1 image2\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && strcmp(argv[1], "-u") == 0)
+    {
+        image_mapped = 0;
+        argv++;
+        argc--;
+    }
+    if (argc == 2 && argv[1][0] != '-')
+        return cmd_dump(argv[1]);
+    if (argc == 3 && strcmp(argv[1], "-c") == 0)
+        return cmd_check(argv[2], 0);
+    if (argc == 3 && strcmp(argv[1], "-r") == 0)
+        return cmd_check(argv[2], 1);
+    if (argc == 4 && strcmp(argv[1], "-d") == 0)
+        return cmd_diff(argv[2], argv[3]);
+    usage();
+    return 2;
+}
@@ -0,0 +1,179 @@
+// mkfs.c — собрать образ тома (формат fat16/fs.h) из файлов хоста
+//
+//   mkfs [-u] [-s size] [-c cluster] [-t 16|32] image [/dir/name.ext=hostfile ...]
+//
+// size и cluster — байты, можно с суффиксом K/M/G. -u — образ как
+// неотображённое устройство: всё идёт через кэш буферов, как с диском. Образ строит тот же
+// fat16/fs.c, что работает в ядре, поэтому формат у них общий по построению.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../fat16/fs.h"
+#include "shim.h"
+
+#define MKFS_DEFAULT_SIZE (16ULL * 1024 * 1024)
+
+static int parse_size(const char *s, uint64_t *out)
+{
+    char *end;
+    unsigned long long v = strtoull(s, &end, 0);
+    switch (*end)
+    {
+    case 'G':
+    case 'g':
+        v <<= 10; /* fallthrough */
+    case 'M':
+    case 'm':
+        v <<= 10; /* fallthrough */
+    case 'K':
+    case 'k':
+        v <<= 10;
+        end++;
+        break;
+    default:
+        break;
+    }
+    if (*end != '\0' || v == 0)
+        return -1;
+    *out = v;
+    return 0;
+}
+
+/* Каталоги пути создаются по мере надобности; файл — последний компонент,
+   расширение — после последней точки */
+static int add_file(const char *path, const char *host)
+{
+    size_t size;
+    uint8_t *data = shim_read_file(host, &size);
+    if (!data)
+    {
+        fprintf(stderr, "mkfs: cannot read %s\n", host);
+        return -1;
+    }
+
+    int dir = FS_ROOT_IDX;
+    const char *p = path;
+    for (;;)
+    {
+        while (*p == '/')
+            p++;
+        const char *slash = strchr(p, '/');
+        if (!slash)
+            break;
+        char name[FS_NAME_MAX];
+        size_t n = (size_t)(slash - p);
+        if (n == 0 || n >= FS_NAME_MAX)
+            goto bad_path;
+        memcpy(name, p, n);
+        name[n] = '\0';
+        fs_entry_t e;
+        int idx = fs_find_in_dir(name, NULL, dir, &e);
+        if (idx >= 0 && !e.is_dir)
+            goto bad_path;
+        dir = idx >= 0 ? idx : fs_mkdir(name, dir);
+        if (dir < 0)
+            goto bad_path;
+        p = slash + 1;
+    }
+
+    char name[FS_NAME_MAX];
+    const char *ext = "";
+    size_t n = strlen(p);
+    if (n == 0 || n >= FS_NAME_MAX)
+        goto bad_path;
+    memcpy(name, p, n + 1);
+    char *dot = strrchr(name, '.');
+    if (dot && dot != name)
+    {
+        *dot = '\0';
+        ext = dot + 1;
+    }
+
+    int rc = fs_write_file_in_dir(name, ext, dir, data, size);
+    free(data);
+    if (rc != 0)
+    {
+        fprintf(stderr, "mkfs: %s: write failed (%d)\n", path, rc);
+        return -1;
+    }
+    return 0;
+
+bad_path:
+    free(data);
+    fprintf(stderr, "mkfs: bad path %s\n", path);
+    return -1;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: mkfs [-u] [-s size] [-c cluster] [-t 16|32] image [/dir/name.ext=hostfile ...]\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t size = MKFS_DEFAULT_SIZE;
+    fs_geometry_t geo = {0, 0};
+    int mapped = 1;
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; ++i)
+    {
+        if (strcmp(argv[i], "-u") == 0)
+        {
+            mapped = 0;
+            continue;
+        }
+        if (i + 1 >= argc)
+            usage();
+        uint64_t v;
+        if (strcmp(argv[i], "-s") == 0 && parse_size(argv[i + 1], &v) == 0)
+            size = v;
+        else if (strcmp(argv[i], "-c") == 0 && parse_size(argv[i + 1], &v) == 0 && v <= FS_CLUSTER_MAX)
+            geo.cluster_size = (uint32_t)v;
+        else if (strcmp(argv[i], "-t") == 0 && (atoi(argv[i + 1]) == 16 || atoi(argv[i + 1]) == 32))
+            geo.fat_type = (uint8_t)atoi(argv[i + 1]);
+        else
+            usage();
+        ++i;
+    }
+    if (i >= argc)
+        usage();
+    const char *image = argv[i++];
+
+    size &= ~(uint64_t)(BLK_SECTOR_SIZE - 1);
+    uint8_t *mem = calloc(1, size);
+    if (!mem)
+    {
+        fprintf(stderr, "mkfs: out of memory\n");
+        return 1;
+    }
+    if (fs_format(shim_image_dev(mem, size, mapped), &geo) != 0)
+    {
+        fprintf(stderr, "mkfs: cannot format %llu bytes with this geometry\n", (unsigned long long)size);
+        return 1;
+    }
+
+    for (; i < argc; ++i)
+    {
+        char *eq = strchr(argv[i], '=');
+        if (!eq)
+            usage();
+        *eq = '\0';
+        if (add_file(argv[i], eq + 1) != 0)
+            return 1;
+    }
+
+    if (fs_sync(1) != 0 || shim_write_file(image, mem, size) != 0)
+    {
+        fprintf(stderr, "mkfs: cannot write %s\n", image);
+        return 1;
+    }
+
+    fs_statfs_t st;
+    fs_statfs(&st);
+    printf("%s: FAT%u, %u x %u B clusters, %u free, %u entries\n", image, st.fat_type, st.total_clusters,
+           st.cluster_size, st.free_clusters, st.used_entries);
+    free(mem);
+    return 0;
+}
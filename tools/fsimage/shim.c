@@ -0,0 +1,90 @@
+// shim.c — окружение ядра для хост-сборки fat16/fs.c (tools/fsimage)
+// Куча — malloc хоста, устройство — буфер в памяти. В ядро не линкуется.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "shim.h"
+#include "../../block/bcache.h"
+
+volatile uint32_t seconds = 0; /* время для кэша буферов (block/bcache.c) */
+
+void *kmalloc_flags(size_t size, int flags)
+{
+    (void)flags;
+    return calloc(1, size);
+}
+
+/* Образ — priv устройства: у каждого образа своё устройство, и буферы кэша
+   одного образа не достаются другому */
+static int image_read(blkdev_t *dev, uint64_t sector, uint32_t count, void *buf)
+{
+    memcpy(buf, (uint8_t *)dev->priv + sector * BLK_SECTOR_SIZE, (size_t)count * BLK_SECTOR_SIZE);
+    return 0;
+}
+
+static int image_write(blkdev_t *dev, uint64_t sector, uint32_t count, const void *buf)
+{
+    memcpy((uint8_t *)dev->priv + sector * BLK_SECTOR_SIZE, buf, (size_t)count * BLK_SECTOR_SIZE);
+    return 0;
+}
+
+static void *image_map(blkdev_t *dev, uint64_t sector)
+{
+    return (uint8_t *)dev->priv + sector * BLK_SECTOR_SIZE;
+}
+
+static const blkdev_ops_t image_ops = {image_read, image_write, image_map};
+static const blkdev_ops_t image_ops_unmapped = {image_read, image_write, NULL};
+
+blkdev_t *shim_image_dev(uint8_t *mem, uint64_t size, int mapped)
+{
+    blkdev_t *dev = calloc(1, sizeof(*dev));
+    if (!dev)
+        return NULL;
+    strcpy(dev->name, "img0");
+    dev->sectors = size / BLK_SECTOR_SIZE;
+    dev->ops = mapped ? &image_ops : &image_ops_unmapped;
+    dev->priv = mem;
+    if (!mapped && !bcache_enabled() && bcache_init(BCACHE_NBUFS) != 0)
+    {
+        free(dev);
+        return NULL;
+    }
+    return dev;
+}
+
+uint8_t *shim_read_file(const char *path, size_t *size)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return NULL;
+    uint8_t *buf = NULL;
+    long n = -1;
+    if (fseek(f, 0, SEEK_END) == 0)
+        n = ftell(f);
+    if (n >= 0 && fseek(f, 0, SEEK_SET) == 0)
+    {
+        buf = malloc(n ? (size_t)n : 1);
+        if (buf && fread(buf, 1, (size_t)n, f) != (size_t)n)
+        {
+            free(buf);
+            buf = NULL;
+        }
+    }
+    fclose(f);
+    if (buf)
+        *size = (size_t)n;
+    return buf;
+}
+
+int shim_write_file(const char *path, const void *data, size_t size)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        return -1;
+    int rc = fwrite(data, 1, size, f) == size ? 0 : -1;
+    if (fclose(f) != 0)
+        rc = -1;
+    return rc;
+}
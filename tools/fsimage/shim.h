@@ -0,0 +1,16 @@
+#ifndef FSIMAGE_SHIM_H
+#define FSIMAGE_SHIM_H
+
+#include <stdint.h>
+#include "../../block/blkdev.h"
+
+/* Образ тома в памяти хоста как блочное устройство: mapped — отображённое
+   (как RAM-диск), иначе только read/write, и ФС идёт через кэш буферов
+   (как с диском). Устройство не освобождается: новое на каждый образ */
+blkdev_t *shim_image_dev(uint8_t *mem, uint64_t size, int mapped);
+
+/* Прочитать файл целиком (malloc), NULL — ошибка */
+uint8_t *shim_read_file(const char *path, size_t *size);
+int shim_write_file(const char *path, const void *data, size_t size);
+
+#endif // FSIMAGE_SHIM_H
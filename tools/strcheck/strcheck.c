@@ -0,0 +1,349 @@
+// strcheck.c — хостовая рандомизированная проверка строковых функций libc/string.c
+//
+//   strcheck [ops] [seed]   — strlen/strnlen/strcmp/strncmp/memcmp/memchr против
+//                             побайтовых эталонов; код возврата 1 при ошибке
+//
+// Строки и буферы кончаются вплотную к странице PROT_NONE: чтение хоть на байт
+// дальше, чем позволяет функция, — SIGSEGV. Каждая функция проверяется в обоих
+// режимах str_sse2 (string_init по cpu_features). Функции ядра собраны под
+// именами kstrlen/kmemcmp/... (см. цель strcheck в Makefile).
+#define memcpy kmemcpy
+#define memset kmemset
+#define memcmp kmemcmp
+#define memchr kmemchr
+#define strlen kstrlen
+#define strnlen kstrnlen
+#define strcpy kstrcpy
+#define strncpy kstrncpy
+#define strcat kstrcat
+#define strcmp kstrcmp
+#define strncmp kstrncmp
+#define strchr kstrchr
+#define strrchr kstrrchr
+#define strncat kstrncat
+#include "../../libc/string.h"
+#undef memcpy
+#undef memset
+#undef memcmp
+#undef memchr
+#undef strlen
+#undef strnlen
+#undef strcpy
+#undef strncpy
+#undef strcat
+#undef strcmp
+#undef strncmp
+#undef strchr
+#undef strrchr
+#undef strncat
+#include "../../cpu/cpu.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+/* В ядре заполняет cpu_init; здесь режим выбирает проверка */
+cpu_features_t cpu_features;
+
+/* ------------------------- буферы у guard-страницы ------------------------- */
+
+#define PAGE 4096
+#define BUF_PAGES 3 /* строки до двух страниц с лишним: и слова, и весь цикл SSE2 */
+#define MAX_TAIL 63
+#define MAX_LEN (BUF_PAGES * PAGE - MAX_TAIL - 2) /* строка, NUL и хвост помещаются в буфер */
+
+typedef struct
+{
+    unsigned char *base; /* BUF_PAGES читаемых страниц, за ними PROT_NONE */
+    unsigned char *end;
+} guarded_t;
+
+static guarded_t bufs[2];
+
+static int guarded_init(guarded_t *g)
+{
+    unsigned char *p = mmap(NULL, (BUF_PAGES + 1) * PAGE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED || mprotect(p + BUF_PAGES * PAGE, PAGE, PROT_NONE) != 0)
+        return -1;
+    g->base = p;
+    g->end = p + BUF_PAGES * PAGE;
+    return 0;
+}
+
+/* n байт, последний — вплотную к guard-странице, или (tail != 0) на tail
+   байт раньше: так меняются и выравнивание начала, и расстояние до страницы */
+static unsigned char *place(guarded_t *g, size_t n, size_t tail)
+{
+    return g->end - tail - n;
+}
+
+/* ------------------------- эталоны ------------------------- */
+
+static size_t ref_strlen(const char *s)
+{
+    size_t n = 0;
+    while (s[n])
+        n++;
+    return n;
+}
+
+static size_t ref_strnlen(const char *s, size_t max)
+{
+    size_t n = 0;
+    while (n < max && s[n])
+        n++;
+    return n;
+}
+
+static int ref_strncmp(const char *a, const char *b, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        unsigned char ca = (unsigned char)a[i], cb = (unsigned char)b[i];
+        if (ca != cb || !ca)
+            return (int)ca - (int)cb;
+    }
+    return 0;
+}
+
+static int ref_memcmp(const void *a, const void *b, size_t n)
+{
+    const unsigned char *pa = a, *pb = b;
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (pa[i] != pb[i])
+            return (int)pa[i] - (int)pb[i];
+    }
+    return 0;
+}
+
+static const void *ref_memchr(const void *s, int c, size_t n)
+{
+    const unsigned char *p = s;
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (p[i] == (unsigned char)c)
+            return p + i;
+    }
+    return NULL;
+}
+
+static inline int sign(int v)
+{
+    return (v > 0) - (v < 0);
+}
+
+/* ------------------------- случайные данные ------------------------- */
+
+static uint64_t rng_state;
+
+static inline uint64_t rng(void)
+{
+    /* xorshift64*, как в allocbench */
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+/* Чаще короткие (словный префикс), реже за STR_WORD_PREFIX и через страницы */
+static size_t rng_len(void)
+{
+    unsigned r = (unsigned)(rng() % 100);
+    if (r < 40)
+        return (size_t)(rng() % 24);
+    if (r < 80)
+        return (size_t)(rng() % 256);
+    return (size_t)(rng() % (MAX_LEN + 1));
+}
+
+static size_t rng_tail(void)
+{
+    return (rng() % 2) ? 0 : (size_t)(rng() % (MAX_TAIL + 1));
+}
+
+/* Байты без нуля: узкий алфавит даёт длинные общие префиксы, 0x80+ —
+   проверку сравнения как unsigned char */
+static void fill_bytes(unsigned char *p, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        unsigned char c = (rng() % 4) ? (unsigned char)('a' + rng() % 3) : (unsigned char)rng();
+        p[i] = c ? c : 0xFF;
+    }
+}
+
+/* Строка длины len у guard-страницы буфера g */
+static char *make_str(guarded_t *g, size_t len, size_t tail)
+{
+    unsigned char *s = place(g, len + 1, tail);
+    fill_bytes(s, len);
+    s[len] = 0;
+    return (char *)s;
+}
+
+/* Вторая строка: копия первой (в другом буфере, со своим хвостом), где
+   одно из — другой байт, укороченная, удлинённая или такая же */
+static char *make_pair(const char *a, size_t len, size_t *out_len)
+{
+    size_t blen = len;
+    unsigned kind = (unsigned)(rng() % 4);
+    if (kind == 1 && len)
+        blen = (size_t)(rng() % len);
+    else if (kind == 2 && len < MAX_LEN - 64)
+        blen = len + 1 + (size_t)(rng() % 64);
+
+    unsigned char *b = place(&bufs[1], blen + 1, rng_tail());
+    size_t common = blen < len ? blen : len;
+    memcpy(b, a, common);
+    fill_bytes(b + common, blen - common);
+    b[blen] = 0;
+    if (kind == 0 && blen)
+    {
+        size_t i = (size_t)(rng() % blen);
+        b[i] = (unsigned char)(b[i] + 1 + rng() % 255);
+        if (!b[i])
+            b[i] = 1;
+    }
+    *out_len = blen;
+    return (char *)b;
+}
+
+/* ------------------------- проверка ------------------------- */
+
+enum
+{
+    FN_STRLEN,
+    FN_STRNLEN,
+    FN_STRCMP,
+    FN_STRNCMP,
+    FN_MEMCMP,
+    FN_MEMCHR,
+    FN_COUNT
+};
+
+static const char *fn_names[FN_COUNT] = {"strlen", "strnlen", "strcmp", "strncmp", "memcmp", "memchr"};
+
+static int check_failed(int fn, int sse2, uint64_t op, size_t len, const char *what)
+{
+    fprintf(stderr, "%s (%s): op %llu, len %zu: %s\n", fn_names[fn], sse2 ? "sse2" : "words",
+            (unsigned long long)op, len, what);
+    return 1;
+}
+
+static int check_one(int fn, int sse2, uint64_t op)
+{
+    size_t len = rng_len();
+    char *a = make_str(&bufs[0], len, rng_tail());
+
+    switch (fn)
+    {
+    case FN_STRLEN:
+        if (kstrlen(a) != ref_strlen(a))
+            return check_failed(fn, sse2, op, len, "length differs");
+        return 0;
+
+    case FN_STRNLEN:
+    {
+        /* Предел меньше, равен или больше длины; без NUL в пределах — только n байт у guard */
+        size_t n = (size_t)(rng() % (len + 16));
+        if (kstrnlen(a, n) != ref_strnlen(a, n))
+            return check_failed(fn, sse2, op, len, "length differs");
+        const char *raw = (const char *)place(&bufs[1], len, 0);
+        fill_bytes((unsigned char *)raw, len);
+        if (kstrnlen(raw, len) != len)
+            return check_failed(fn, sse2, op, len, "unterminated buffer: length differs");
+        return 0;
+    }
+
+    case FN_STRCMP:
+    case FN_STRNCMP:
+    {
+        size_t blen;
+        char *b = make_pair(a, len, &blen);
+        if (fn == FN_STRCMP)
+        {
+            if (sign(kstrcmp(a, b)) != sign(ref_strncmp(a, b, SIZE_MAX)) ||
+                sign(kstrcmp(b, a)) != sign(ref_strncmp(b, a, SIZE_MAX)))
+                return check_failed(fn, sse2, op, len, "order differs");
+            return 0;
+        }
+        size_t n = (size_t)(rng() % ((len > blen ? len : blen) + 16));
+        if (sign(kstrncmp(a, b, n)) != sign(ref_strncmp(a, b, n)))
+            return check_failed(fn, sse2, op, len, "order differs");
+        return 0;
+    }
+
+    case FN_MEMCMP:
+    {
+        /* Оба буфера по len байт у своих guard-страниц, различие в случайном месте */
+        unsigned char *b = place(&bufs[1], len, rng_tail());
+        memcpy(b, a, len);
+        if (len && rng() % 4)
+        {
+            size_t i = (size_t)(rng() % len);
+            b[i] = (unsigned char)(b[i] ^ (1u << (rng() % 8)));
+        }
+        if (sign(kmemcmp(a, b, len)) != sign(ref_memcmp(a, b, len)) ||
+            sign(kmemcmp(b, a, len)) != sign(ref_memcmp(b, a, len)))
+            return check_failed(fn, sse2, op, len, "order differs");
+        return 0;
+    }
+
+    case FN_MEMCHR:
+    {
+        /* len байт строки без NUL; искомый байт — из строки, 0 или случайный */
+        unsigned r = (unsigned)(rng() % 4);
+        int c = (r == 0 || !len) ? (int)(rng() & 0xFF) : (r == 1) ? 0 : (unsigned char)a[rng() % len];
+        if (r == 3)
+            c += 256; /* memchr берёт (unsigned char)c */
+        if (kmemchr(a, c, len) != ref_memchr(a, c, len))
+            return check_failed(fn, sse2, op, len, "match differs");
+        return 0;
+    }
+    }
+    return 0;
+}
+
+static int check_mode(int sse2, uint64_t ops, uint64_t seed)
+{
+    cpu_features.sse2 = (uint8_t)sse2;
+    string_init();
+
+    int rc = 0;
+    for (int fn = 0; fn < FN_COUNT; ++fn)
+    {
+        rng_state = seed;
+        int bad = 0;
+        for (uint64_t op = 0; op < ops && !bad; ++op)
+            bad = check_one(fn, sse2, op);
+        printf("%-8s %-6s %s\n", fn_names[fn], sse2 ? "sse2" : "words", bad ? "FAILED" : "ok");
+        rc |= bad;
+    }
+    return rc;
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t ops = (argc > 1) ? strtoull(argv[1], NULL, 0) : 100000;
+    uint64_t seed = (argc > 2) ? strtoull(argv[2], NULL, 0) : 0x9E3779B97F4A7C15ULL;
+    if (argc > 3)
+    {
+        fprintf(stderr, "usage: %s [ops] [seed]\n", argv[0]);
+        return 2;
+    }
+    if (seed == 0)
+        seed = 1; /* xorshift не выходит из нуля */
+
+    if (guarded_init(&bufs[0]) != 0 || guarded_init(&bufs[1]) != 0)
+    {
+        fprintf(stderr, "strcheck: cannot map guarded buffers\n");
+        return 2;
+    }
+
+    int rc = check_mode(0, ops, seed);
+    rc |= check_mode(1, ops, seed);
+    return rc;
+}
@@ -1,5 +0,0 @@
-unsigned char clear_bin[] = {
-  0xb8, 0x06, 0x00, 0x00, 0x00, 0xcd, 0x80, 0xb8, 0xcc, 0x00, 0x00, 0x00,
-  0x48, 0x31, 0xff, 0xcd, 0x80, 0xeb, 0xfe
-};
-unsigned int clear_bin_len = 19;
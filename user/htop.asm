@@ -1,7 +1,12 @@
 BITS 64
 
 %define SYSCALL_PRINT_STRING 3
+%define SYSCALL_MALLOC 10
+%define SYSCALL_FREE 12
 %define SYSCALL_KMALLOC_STATS 13
+%define SYSCALL_KMALLOC_PROFILE 16
+%define KPROF_CMD_REPORT 3
+%define REPORT_SIZE 1024
 
 %define SYSCALL_TASK_EXIT 204
 
@@ -49,6 +54,32 @@ _start:
     lea     rsi, [rel kmalloc_stats + 48]
     call    print_field
 
+    ; профиль кучи: ядро форматирует отчёт, мы его печатаем
+    ; (буфер из kernel heap — .bss программы ограничен 1 KiB)
+    mov     rdi, REPORT_SIZE
+    mov     rax, SYSCALL_MALLOC
+    int     0x80
+    test    rax, rax
+    jz      .exit
+    mov     rbx, rax
+
+    mov     rdi, KPROF_CMD_REPORT
+    mov     rsi, rbx
+    mov     rdx, REPORT_SIZE
+    mov     rax, SYSCALL_KMALLOC_PROFILE
+    int     0x80
+
+    mov     rdi, rbx
+    mov     rsi, fg_color
+    mov     rdx, bg_color
+    mov     rax, SYSCALL_PRINT_STRING
+    int     0x80
+
+    mov     rdi, rbx
+    mov     rax, SYSCALL_FREE
+    int     0x80
+
+.exit:
     ; завершение задачи: вернуть код 0
     mov     rax, SYSCALL_TASK_EXIT
     xor     rdi, rdi        ; exit code 0
@@ -1,43 +0,0 @@
-unsigned char htop_bin[] = {
-  0x48, 0x8d, 0x3d, 0xd1, 0x01, 0x00, 0x00, 0xb8, 0x0d, 0x00, 0x00, 0x00,
-  0xcd, 0x80, 0x48, 0x8d, 0x3d, 0x43, 0x01, 0x00, 0x00, 0x48, 0x8d, 0x35,
-  0xbc, 0x01, 0x00, 0x00, 0xe8, 0xd9, 0x00, 0x00, 0x00, 0x48, 0x8d, 0x3d,
-  0x40, 0x01, 0x00, 0x00, 0x48, 0x8d, 0x35, 0xb1, 0x01, 0x00, 0x00, 0xe8,
-  0xc6, 0x00, 0x00, 0x00, 0x48, 0x8d, 0x3d, 0x3f, 0x01, 0x00, 0x00, 0x48,
-  0x8d, 0x35, 0xa6, 0x01, 0x00, 0x00, 0xe8, 0xb3, 0x00, 0x00, 0x00, 0x48,
-  0x8d, 0x3d, 0x3e, 0x01, 0x00, 0x00, 0x48, 0x8d, 0x35, 0x9b, 0x01, 0x00,
-  0x00, 0xe8, 0xa0, 0x00, 0x00, 0x00, 0x48, 0x8d, 0x3d, 0x3d, 0x01, 0x00,
-  0x00, 0x48, 0x8d, 0x35, 0x90, 0x01, 0x00, 0x00, 0xe8, 0x8d, 0x00, 0x00,
-  0x00, 0x48, 0x8d, 0x3d, 0x3c, 0x01, 0x00, 0x00, 0x48, 0x8d, 0x35, 0x85,
-  0x01, 0x00, 0x00, 0xe8, 0x7a, 0x00, 0x00, 0x00, 0x48, 0x8d, 0x3d, 0x3b,
-  0x01, 0x00, 0x00, 0x48, 0x8d, 0x35, 0x7a, 0x01, 0x00, 0x00, 0xe8, 0x67,
-  0x00, 0x00, 0x00, 0xb8, 0xcc, 0x00, 0x00, 0x00, 0x48, 0x31, 0xff, 0xcd,
-  0x80, 0xeb, 0xfe, 0x53, 0x41, 0x54, 0x41, 0x55, 0x48, 0x8b, 0x07, 0x48,
-  0x83, 0xf8, 0x00, 0x75, 0x09, 0xc6, 0x06, 0x30, 0xc6, 0x46, 0x01, 0x00,
-  0xeb, 0x36, 0x48, 0x8d, 0x5e, 0x1f, 0x41, 0xbc, 0x00, 0x00, 0x00, 0x00,
-  0x48, 0x31, 0xd2, 0x41, 0xbd, 0x0a, 0x00, 0x00, 0x00, 0x49, 0xf7, 0xf5,
-  0x80, 0xc2, 0x30, 0x48, 0xff, 0xcb, 0x88, 0x13, 0x49, 0xff, 0xc4, 0x48,
-  0x83, 0xf8, 0x00, 0x75, 0xe3, 0x4c, 0x89, 0xe1, 0x48, 0x89, 0xf7, 0x48,
-  0x89, 0xde, 0xfc, 0xf3, 0xa4, 0xc6, 0x07, 0x00, 0x41, 0x5d, 0x41, 0x5c,
-  0x5b, 0xc3, 0xb8, 0x03, 0x00, 0x00, 0x00, 0xcd, 0x80, 0xc3, 0x55, 0x53,
-  0x41, 0x54, 0x48, 0x89, 0xf3, 0xb8, 0x03, 0x00, 0x00, 0x00, 0xbe, 0x0f,
-  0x00, 0x00, 0x00, 0xba, 0x00, 0x00, 0x00, 0x00, 0xcd, 0x80, 0x48, 0x89,
-  0xdf, 0x48, 0x8d, 0x35, 0xf4, 0x00, 0x00, 0x00, 0xe8, 0x7e, 0xff, 0xff,
-  0xff, 0x48, 0x8d, 0x3d, 0xe8, 0x00, 0x00, 0x00, 0xbe, 0x0f, 0x00, 0x00,
-  0x00, 0xba, 0x00, 0x00, 0x00, 0x00, 0xb8, 0x03, 0x00, 0x00, 0x00, 0xcd,
-  0x80, 0x48, 0x8d, 0x3d, 0x94, 0x00, 0x00, 0x00, 0xbe, 0x0f, 0x00, 0x00,
-  0x00, 0xba, 0x00, 0x00, 0x00, 0x00, 0xb8, 0x03, 0x00, 0x00, 0x00, 0xcd,
-  0x80, 0x41, 0x5c, 0x5b, 0x5d, 0xc3, 0x00, 0x00, 0x74, 0x6f, 0x74, 0x61,
-  0x6c, 0x5f, 0x6d, 0x61, 0x6e, 0x61, 0x67, 0x65, 0x64, 0x3a, 0x20, 0x00,
-  0x75, 0x73, 0x65, 0x64, 0x5f, 0x70, 0x61, 0x79, 0x6c, 0x6f, 0x61, 0x64,
-  0x3a, 0x20, 0x20, 0x20, 0x20, 0x00, 0x66, 0x72, 0x65, 0x65, 0x5f, 0x70,
-  0x61, 0x79, 0x6c, 0x6f, 0x61, 0x64, 0x3a, 0x20, 0x20, 0x20, 0x20, 0x00,
-  0x6c, 0x61, 0x72, 0x67, 0x65, 0x73, 0x74, 0x5f, 0x66, 0x72, 0x65, 0x65,
-  0x3a, 0x20, 0x20, 0x20, 0x20, 0x00, 0x6e, 0x75, 0x6d, 0x5f, 0x62, 0x6c,
-  0x6f, 0x63, 0x6b, 0x73, 0x3a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x00,
-  0x6e, 0x75, 0x6d, 0x5f, 0x75, 0x73, 0x65, 0x64, 0x3a, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x00, 0x6e, 0x75, 0x6d, 0x5f, 0x66, 0x72,
-  0x65, 0x65, 0x3a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x00,
-  0x0a, 0x00
-};
-unsigned int htop_bin_len = 470;
@@ -1,4 +0,0 @@
-unsigned char reboot_bin[] = {
-  0xb8, 0x65, 0x00, 0x00, 0x00, 0xcd, 0x80, 0xeb, 0xfe
-};
-unsigned int reboot_bin_len = 9;
@@ -1,4 +0,0 @@
-unsigned char shutdown_bin[] = {
-  0xb8, 0x64, 0x00, 0x00, 0x00, 0xcd, 0x80, 0xeb, 0xfe
-};
-unsigned int shutdown_bin_len = 9;
@@ -1,36 +0,0 @@
-unsigned char terminal_bin[] = {
-  0xbf, 0x00, 0x20, 0x00, 0x00, 0xb8, 0x0a, 0x00, 0x00, 0x00, 0xcd, 0x80,
-  0x48, 0x89, 0x05, 0x7d, 0x01, 0x00, 0x00, 0x48, 0xc7, 0x04, 0x25, 0x88,
-  0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x41, 0xbf, 0x00, 0x00, 0x00,
-  0x00, 0x48, 0x8d, 0x3d, 0x48, 0x01, 0x00, 0x00, 0xbe, 0x0f, 0x00, 0x00,
-  0x00, 0xba, 0x00, 0x00, 0x00, 0x00, 0xb8, 0x03, 0x00, 0x00, 0x00, 0xcd,
-  0x80, 0x48, 0x8d, 0x3d, 0x2c, 0x01, 0x00, 0x00, 0xbe, 0x0f, 0x00, 0x00,
-  0x00, 0xba, 0x00, 0x00, 0x00, 0x00, 0xb8, 0x03, 0x00, 0x00, 0x00, 0xcd,
-  0x80, 0xb8, 0x1e, 0x00, 0x00, 0x00, 0xcd, 0x80, 0x3c, 0x00, 0x0f, 0x84,
-  0xe9, 0x00, 0x00, 0x00, 0x3c, 0x20, 0x0f, 0x84, 0xe1, 0x00, 0x00, 0x00,
-  0x3c, 0x03, 0x75, 0x16, 0x49, 0x83, 0xff, 0x00, 0x74, 0x10, 0x4c, 0x89,
-  0xff, 0xb8, 0xca, 0x00, 0x00, 0x00, 0xcd, 0x80, 0x41, 0xbf, 0x00, 0x00,
-  0x00, 0x00, 0x3c, 0x0a, 0x75, 0x6c, 0x48, 0x8b, 0x1c, 0x25, 0x88, 0x01,
-  0x00, 0x00, 0x48, 0x8b, 0x3d, 0xf7, 0x00, 0x00, 0x00, 0xc6, 0x04, 0x1f,
-  0x00, 0xe8, 0xb1, 0x00, 0x00, 0x00, 0x48, 0xc7, 0x04, 0x25, 0x88, 0x01,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x8b, 0x3d, 0xdb, 0x00, 0x00,
-  0x00, 0xb8, 0xc8, 0x00, 0x00, 0x00, 0xcd, 0x80, 0x48, 0x83, 0xf8, 0x00,
-  0x74, 0x1a, 0x49, 0x89, 0xc7, 0xeb, 0x00, 0x4c, 0x89, 0xff, 0xb8, 0xcd,
-  0x00, 0x00, 0x00, 0xcd, 0x80, 0x48, 0x83, 0xf8, 0x00, 0x75, 0x02, 0xeb,
-  0x03, 0xf4, 0xeb, 0xeb, 0x48, 0x8d, 0x3d, 0x8d, 0x00, 0x00, 0x00, 0xbe,
-  0x0f, 0x00, 0x00, 0x00, 0xba, 0x00, 0x00, 0x00, 0x00, 0xb8, 0x03, 0x00,
-  0x00, 0x00, 0xcd, 0x80, 0xeb, 0x57, 0x3c, 0x08, 0x75, 0x1d, 0x48, 0x83,
-  0x3c, 0x25, 0x88, 0x01, 0x00, 0x00, 0x00, 0x74, 0x48, 0x48, 0x83, 0x2c,
-  0x25, 0x88, 0x01, 0x00, 0x00, 0x01, 0xb8, 0x04, 0x00, 0x00, 0x00, 0xcd,
-  0x80, 0xeb, 0x36, 0x3c, 0x01, 0x75, 0x02, 0xb0, 0x20, 0x48, 0x8b, 0x1c,
-  0x25, 0x88, 0x01, 0x00, 0x00, 0x48, 0x8b, 0x3d, 0x64, 0x00, 0x00, 0x00,
-  0x88, 0x04, 0x1f, 0x48, 0x83, 0x04, 0x25, 0x88, 0x01, 0x00, 0x00, 0x01,
-  0x48, 0x0f, 0xb6, 0xf8, 0xbe, 0x0f, 0x00, 0x00, 0x00, 0xba, 0x00, 0x00,
-  0x00, 0x00, 0xb8, 0x02, 0x00, 0x00, 0x00, 0xcd, 0x80, 0xf4, 0xe9, 0x02,
-  0xff, 0xff, 0xff, 0x48, 0x8d, 0x3c, 0x25, 0x0a, 0x00, 0x00, 0x00, 0xbe,
-  0x0f, 0x00, 0x00, 0x00, 0xba, 0x00, 0x00, 0x00, 0x00, 0xb8, 0x02, 0x00,
-  0x00, 0x00, 0xcd, 0x80, 0xc3, 0x00, 0x00, 0x00, 0x24, 0x3a, 0x20, 0x00,
-  0x53, 0x69, 0x6d, 0x70, 0x6c, 0x65, 0x54, 0x65, 0x72, 0x6d, 0x20, 0x76,
-  0x30, 0x2e, 0x31, 0x0a, 0x00
-};
-unsigned int terminal_bin_len = 389;
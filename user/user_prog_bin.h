@@ -1,9 +0,0 @@
-unsigned char user_prog_bin[] = {
-  0x48, 0x8d, 0x3d, 0x29, 0x00, 0x00, 0x00, 0xbe, 0x0a, 0x00, 0x00, 0x00,
-  0xba, 0x03, 0x00, 0x00, 0x00, 0x41, 0xba, 0x0e, 0x00, 0x00, 0x00, 0x41,
-  0xb8, 0x00, 0x00, 0x00, 0x00, 0xb8, 0x01, 0x00, 0x00, 0x00, 0xcd, 0x80,
-  0xb9, 0x10, 0x27, 0x00, 0x00, 0xe2, 0xfe, 0xeb, 0xd3, 0x00, 0x00, 0x00,
-  0x48, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x66, 0x72, 0x6f, 0x6d, 0x20, 0x75,
-  0x73, 0x65, 0x72, 0x20, 0x6d, 0x6f, 0x64, 0x65, 0x21, 0x00
-};
-unsigned int user_prog_bin_len = 70;
@@ -0,0 +1,243 @@
+// pmm.c — аллокатор физических фреймов 4 KiB (bitmap + next-fit)
+#include "pmm.h"
+#include "../libc/string.h"
+#include "../sync/spinlock.h"
+
+/* Символы из link.ld (.pages section) */
+extern char _pages_start;
+extern char _pages_end;
+
+/* 1 бит на фрейм: 1 — занят, 0 — свободен */
+static uint64_t frame_bitmap[PMM_MAX_FRAMES / 64];
+static uint64_t pages_base = 0; /* физический адрес фрейма с индексом 0 */
+static size_t total_frames = 0;
+static size_t free_frames = 0;
+static size_t next_hint = 0; /* индекс слова bitmap, с которого начинаем поиск */
+
+/* Пул заранее обнулённых фреймов (стек). Пополняется фоновой задачей,
+   в bitmap его фреймы числятся занятыми. */
+static uint64_t zero_pool[ZPOOL_CAPACITY];
+static size_t zero_pool_count = 0;
+static uint64_t zero_pool_hits = 0;
+static uint64_t zero_pool_misses = 0;
+
+/* Фреймы выделяются и из ISR (page fault), и из задач — короткая секция под замком */
+static spinlock_t pmm_lock = SPINLOCK_INIT;
+
+void pmm_init(void)
+{
+    uint64_t start = ((uint64_t)(uintptr_t)&_pages_start + PAGE_SIZE - 1) & ~(uint64_t)(PAGE_SIZE - 1);
+    uint64_t end = (uint64_t)(uintptr_t)&_pages_end & ~(uint64_t)(PAGE_SIZE - 1);
+
+    pages_base = start;
+    total_frames = (end > start) ? (size_t)((end - start) >> PAGE_SHIFT) : 0;
+    if (total_frames > PMM_MAX_FRAMES)
+        total_frames = PMM_MAX_FRAMES;
+    free_frames = total_frames;
+    next_hint = 0;
+    zero_pool_count = 0;
+
+    memset(frame_bitmap, 0, sizeof(frame_bitmap));
+
+    /* Хвост bitmap за пределами пула помечаем занятым, чтобы поиск его не выдал */
+    for (size_t i = total_frames; i < PMM_MAX_FRAMES; ++i)
+        frame_bitmap[i / 64] |= 1ULL << (i % 64);
+}
+
+/* Фрейм из bitmap; вызывается под pmm_lock */
+static uint64_t bitmap_alloc(void)
+{
+    const size_t words = PMM_MAX_FRAMES / 64;
+
+    if (free_frames == 0)
+        return 0;
+
+    for (size_t n = 0; n < words; ++n)
+    {
+        size_t w = (next_hint + n) % words;
+        if (frame_bitmap[w] == ~0ULL)
+            continue;
+
+        /* первый нулевой бит слова — 64 фрейма за одну инструкцию */
+        size_t bit = (size_t)__builtin_ctzll(~frame_bitmap[w]);
+        frame_bitmap[w] |= 1ULL << bit;
+        free_frames--;
+        next_hint = w;
+        return pages_base + ((uint64_t)(w * 64 + bit) << PAGE_SHIFT);
+    }
+    return 0;
+}
+
+uint64_t pmm_alloc_frame(void)
+{
+    unsigned long flags = spin_lock_irqsave(&pmm_lock);
+    uint64_t phys = bitmap_alloc();
+    /* bitmap пуст — забираем фрейм из пула обнулённых, лишь бы не отказать */
+    if (!phys && zero_pool_count)
+        phys = zero_pool[--zero_pool_count];
+    spin_unlock_irqrestore(&pmm_lock, flags);
+    return phys;
+}
+
+/* Обнуление в обход кэша: страница понадобится не сразу и не этому CPU,
+   вытеснять ради неё рабочие данные незачем */
+static void zero_frame_nt(uint64_t phys)
+{
+    uint64_t *p = (uint64_t *)(uintptr_t)phys;
+    uint64_t zero = 0;
+    for (size_t i = 0; i < PAGE_SIZE / sizeof(uint64_t); i += 8)
+    {
+        asm volatile("movnti %1, 0(%0)\n\t"
+                     "movnti %1, 8(%0)\n\t"
+                     "movnti %1, 16(%0)\n\t"
+                     "movnti %1, 24(%0)\n\t"
+                     "movnti %1, 32(%0)\n\t"
+                     "movnti %1, 40(%0)\n\t"
+                     "movnti %1, 48(%0)\n\t"
+                     "movnti %1, 56(%0)" ::"r"(p + i),
+                     "r"(zero)
+                     : "memory");
+    }
+    asm volatile("sfence" ::: "memory");
+}
+
+uint64_t pmm_alloc_zeroed_frame(void)
+{
+    unsigned long flags = spin_lock_irqsave(&pmm_lock);
+    if (zero_pool_count)
+    {
+        uint64_t phys = zero_pool[--zero_pool_count];
+        zero_pool_hits++;
+        spin_unlock_irqrestore(&pmm_lock, flags);
+        return phys;
+    }
+    zero_pool_misses++;
+    spin_unlock_irqrestore(&pmm_lock, flags);
+
+    /* Пул пуст — обнуляем на месте: страница нужна прямо сейчас, пусть будет в кэше */
+    uint64_t phys = pmm_alloc_frame();
+    if (phys)
+        memset((void *)(uintptr_t)phys, 0, PAGE_SIZE);
+    return phys;
+}
+
+size_t pmm_zero_pool_refill(size_t max)
+{
+    size_t added = 0;
+    while (added < max)
+    {
+        /* Не копим в пуле больше половины оставшейся памяти */
+        unsigned long flags = spin_lock_irqsave(&pmm_lock);
+        uint64_t phys = 0;
+        if (zero_pool_count < ZPOOL_CAPACITY && free_frames > zero_pool_count)
+            phys = bitmap_alloc();
+        spin_unlock_irqrestore(&pmm_lock, flags);
+        if (!phys)
+            break;
+
+        /* Обнуление — с разрешёнными прерываниями: фрейм ещё ничей */
+        zero_frame_nt(phys);
+
+        flags = spin_lock_irqsave(&pmm_lock);
+        if (zero_pool_count < ZPOOL_CAPACITY)
+        {
+            zero_pool[zero_pool_count++] = phys;
+            phys = 0;
+        }
+        spin_unlock_irqrestore(&pmm_lock, flags);
+        if (phys)
+        {
+            pmm_free_frame(phys);
+            break;
+        }
+        added++;
+    }
+    return added;
+}
+
+void pmm_zero_pool_stats(size_t *count, uint64_t *hits, uint64_t *misses)
+{
+    unsigned long flags = spin_lock_irqsave(&pmm_lock);
+    if (count)
+        *count = zero_pool_count;
+    if (hits)
+        *hits = zero_pool_hits;
+    if (misses)
+        *misses = zero_pool_misses;
+    spin_unlock_irqrestore(&pmm_lock, flags);
+}
+
+static inline int frame_used(size_t idx)
+{
+    return (frame_bitmap[idx / 64] >> (idx % 64)) & 1;
+}
+
+uint64_t pmm_alloc_contig(size_t count, size_t align_frames)
+{
+    if (count == 0)
+        return 0;
+    if (align_frames == 0 || (align_frames & (align_frames - 1)))
+        align_frames = 1;
+
+    /* Индексы считаются от pages_base (он выровнен на страницу): для align
+       больше страницы дополнительно выравниваем физический адрес */
+    uint64_t align_bytes = (uint64_t)align_frames << PAGE_SHIFT;
+    size_t first = (size_t)(((pages_base + align_bytes - 1) & ~(align_bytes - 1)) - pages_base) >> PAGE_SHIFT;
+
+    unsigned long flags = spin_lock_irqsave(&pmm_lock);
+    size_t idx = first;
+    while (idx + count <= total_frames)
+    {
+        /* Целиком занятые слова пропускаем сразу */
+        if (frame_bitmap[idx / 64] == ~0ULL)
+        {
+            idx = (idx / 64 + 1) * 64;
+            idx = first + ((idx - first + align_frames - 1) & ~(align_frames - 1));
+            continue;
+        }
+
+        size_t n = 0;
+        while (n < count && !frame_used(idx + n))
+            n++;
+        if (n == count)
+        {
+            for (size_t i = idx; i < idx + count; ++i)
+                frame_bitmap[i / 64] |= 1ULL << (i % 64);
+            free_frames -= count;
+            spin_unlock_irqrestore(&pmm_lock, flags);
+            return pages_base + ((uint64_t)idx << PAGE_SHIFT);
+        }
+        /* Следующий кандидат — за занятым фреймом, на границе выравнивания */
+        idx += n + 1;
+        idx = first + ((idx - first + align_frames - 1) & ~(align_frames - 1));
+    }
+    spin_unlock_irqrestore(&pmm_lock, flags);
+    return 0;
+}
+
+void pmm_free_contig(uint64_t phys, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        pmm_free_frame(phys + ((uint64_t)i << PAGE_SHIFT));
+}
+
+void pmm_free_frame(uint64_t phys)
+{
+    if (phys < pages_base)
+        return;
+    size_t idx = (size_t)((phys - pages_base) >> PAGE_SHIFT);
+    if (idx >= total_frames)
+        return;
+
+    unsigned long flags = spin_lock_irqsave(&pmm_lock);
+    uint64_t mask = 1ULL << (idx % 64);
+    if (frame_bitmap[idx / 64] & mask) /* защита от двойного освобождения */
+    {
+        frame_bitmap[idx / 64] &= ~mask;
+        free_frames++;
+    }
+    spin_unlock_irqrestore(&pmm_lock, flags);
+}
+
+size_t pmm_total_frames(void) { return total_frames; }
+size_t pmm_free_frames(void) { return free_frames; }
@@ -0,0 +1,43 @@
+#ifndef PMM_H
+#define PMM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define PAGE_SIZE 4096
+#define PAGE_SHIFT 12
+
+/* Пул фреймов лежит в identity-map (первый 1 GiB), поэтому phys == virt */
+#define PMM_MAX_FRAMES ((128 * 1024 * 1024) / PAGE_SIZE)
+
+/* Пул заранее обнулённых фреймов */
+#define ZPOOL_CAPACITY 512 /* 2 MiB */
+#define ZPOOL_BATCH 16     /* фреймов за один проход фоновой задачи */
+
+/* Инициализация аллокатора фреймов по линкер-символам _pages_start/_pages_end */
+void pmm_init(void);
+
+/* Выделить один фрейм (4 KiB). Возвращает физический адрес или 0 при исчерпании */
+uint64_t pmm_alloc_frame(void);
+
+/* То же, но фрейм гарантированно заполнен нулями: сначала из пула,
+   при пустом пуле — обнуляется на месте */
+uint64_t pmm_alloc_zeroed_frame(void);
+
+/* Дообнулить до max фреймов в пул (non-temporal stores). Возвращает, сколько добавлено */
+size_t pmm_zero_pool_refill(size_t max);
+void pmm_zero_pool_stats(size_t *count, uint64_t *hits, uint64_t *misses);
+
+/* Вернуть фрейм в пул */
+void pmm_free_frame(uint64_t phys);
+
+/* count физически смежных фреймов, начало выровнено на align_frames фреймов
+   (степень двойки). Возвращает физический адрес первого или 0. */
+uint64_t pmm_alloc_contig(size_t count, size_t align_frames);
+void pmm_free_contig(uint64_t phys, size_t count);
+
+/* Статистика */
+size_t pmm_total_frames(void);
+size_t pmm_free_frames(void);
+
+#endif // PMM_H
@@ -0,0 +1,761 @@
+// vmm.c — адресные пространства задач, 4 KiB страницы, demand-zero page faults
+#include "vmm.h"
+#include "../malloc/malloc.h"
+#include "../libc/string.h"
+#include "../vga/vga.h"
+#include "../libc/kprintf.h"
+#include "../cpu/cpu.h"
+#include "../sync/spinlock.h"
+#include "../multitask/multitask.h"
+
+/* Биты error code #PF */
+#define PF_PRESENT 0x1 /* 0 — страница отсутствует, 1 — нарушение прав */
+#define PF_WRITE 0x2
+
+#define CR0_WP (1ULL << 16)
+#define CR4_PGE (1ULL << 7)
+#define CR4_PCIDE (1ULL << 17)
+
+static address_space_t kernel_space;
+static address_space_t *current_space = NULL;
+
+/* PCID раздаются по возрастанию; при исчерпании начинается новое поколение */
+static int pcid_enabled = 0;
+static uint64_t pcid_generation = 1;
+static uint16_t next_pcid = 1;
+
+/* Таблицы окна ядра общие для всех пространств: достраиваются под замком */
+static spinlock_t kwin_lock = SPINLOCK_INIT;
+
+static inline uint64_t read_cr2(void)
+{
+    uint64_t v;
+    asm volatile("mov %%cr2, %0" : "=r"(v));
+    return v;
+}
+
+static inline uint64_t read_cr3(void)
+{
+    uint64_t v;
+    asm volatile("mov %%cr3, %0" : "=r"(v));
+    return v;
+}
+
+static inline void write_cr3(uint64_t v)
+{
+    asm volatile("mov %0, %%cr3" ::"r"(v) : "memory");
+}
+
+static inline uint64_t read_cr0(void)
+{
+    uint64_t v;
+    asm volatile("mov %%cr0, %0" : "=r"(v));
+    return v;
+}
+
+static inline void write_cr0(uint64_t v)
+{
+    asm volatile("mov %0, %%cr0" ::"r"(v) : "memory");
+}
+
+static inline uint64_t read_cr4(void)
+{
+    uint64_t v;
+    asm volatile("mov %%cr4, %0" : "=r"(v));
+    return v;
+}
+
+static inline void write_cr4(uint64_t v)
+{
+    asm volatile("mov %0, %%cr4" ::"r"(v) : "memory");
+}
+
+static inline void invlpg(uint64_t va)
+{
+    asm volatile("invlpg (%0)" ::"r"(va) : "memory");
+}
+
+static inline uint64_t page_down(uint64_t a) { return a & ~(uint64_t)(PAGE_SIZE - 1); }
+static inline uint64_t page_up(uint64_t a) { return (a + PAGE_SIZE - 1) & ~(uint64_t)(PAGE_SIZE - 1); }
+
+void vmm_init(void)
+{
+    memset(&kernel_space, 0, sizeof(kernel_space));
+    /* PML4 из kernel.asm: identity map первого 1 GiB страницами по 2 MiB */
+    kernel_space.pml4 = (uint64_t *)phys_to_virt(read_cr3() & PTE_ADDR_MASK);
+    current_space = &kernel_space;
+
+    /* Программы работают в ring 0: без CR0.WP запись в read-only страницу
+       copy-on-write прошла бы мимо #PF */
+    write_cr0(read_cr0() | CR0_WP);
+
+    /* CR4.PCIDE можно включить только при CR3[11:0] == 0 — так и есть после kernel.asm */
+    if (cpu_features.pcid)
+    {
+        write_cr4(read_cr4() | CR4_PCIDE);
+        pcid_enabled = 1;
+    }
+
+    /* PDPT окна ядра заводим сразу: vmm_create_space копирует запись PML4,
+       и все таблицы ниже неё становятся общими */
+    uint64_t *kwin = &kernel_space.pml4[KERNEL_WIN_PML4_SLOT];
+    if (!(*kwin & PTE_PRESENT))
+    {
+        uint64_t frame = pmm_alloc_zeroed_frame();
+        if (frame)
+            *kwin = frame | PTE_PRESENT | PTE_WRITE;
+    }
+}
+
+/* Сброс всего TLB, включая глобальные записи */
+static void flush_tlb_all(void)
+{
+    uint64_t cr4 = read_cr4();
+    write_cr4(cr4 & ~CR4_PGE);
+    write_cr4(cr4);
+}
+
+/* Выдать пространству PCID текущего поколения. Возвращает 1, если PCID новый
+   и его записи в TLB надо считать недействительными. */
+static int assign_pcid(address_space_t *as)
+{
+    if (as == &kernel_space)
+        return 0; /* PCID 0, все его изменения сопровождаются invlpg */
+    if (as->pcid_gen == pcid_generation)
+        return 0;
+
+    if (next_pcid >= PCID_COUNT)
+    {
+        /* Поколение исчерпано: все старые ASID разом становятся недействительными */
+        pcid_generation++;
+        next_pcid = 1;
+        flush_tlb_all();
+    }
+    as->pcid = next_pcid++;
+    as->pcid_gen = pcid_generation;
+    return 1;
+}
+
+address_space_t *vmm_kernel_space(void) { return &kernel_space; }
+address_space_t *vmm_current_space(void) { return current_space; }
+
+/* Пройти по таблицам до PTE. create=1 — достраивать недостающие уровни */
+static uint64_t *walk(uint64_t *pml4, uint64_t va, int create)
+{
+    uint64_t *table = pml4;
+    for (int level = 3; level > 0; --level)
+    {
+        size_t idx = (size_t)((va >> (PAGE_SHIFT + 9 * level)) & 0x1FF);
+        uint64_t e = table[idx];
+        if (!(e & PTE_PRESENT))
+        {
+            if (!create)
+                return NULL;
+            uint64_t frame = pmm_alloc_zeroed_frame();
+            if (!frame)
+                return NULL;
+            table[idx] = frame | PTE_PRESENT | PTE_WRITE | PTE_USER;
+            e = table[idx];
+        }
+        else if (e & PTE_HUGE)
+        {
+            return NULL; /* 2 MiB страница ядра — внутрь не спускаемся */
+        }
+        table = (uint64_t *)phys_to_virt(e & PTE_ADDR_MASK);
+    }
+    return &table[(va >> PAGE_SHIFT) & 0x1FF];
+}
+
+address_space_t *vmm_create_space(void)
+{
+    address_space_t *as = (address_space_t *)malloc(sizeof(address_space_t));
+    if (!as)
+        return NULL;
+    memset(as, 0, sizeof(*as));
+
+    uint64_t frame = pmm_alloc_zeroed_frame();
+    if (!frame)
+    {
+        free(as);
+        return NULL;
+    }
+    as->pml4 = (uint64_t *)phys_to_virt(frame);
+
+    /* Верхние уровни ядра разделяются: копируем записи PML4, кроме пользовательского окна */
+    for (int i = 0; i < 512; ++i)
+    {
+        if (i != USER_PML4_SLOT)
+            as->pml4[i] = kernel_space.pml4[i];
+    }
+
+    /* Регион 0 — heap, растёт через vmm_sbrk */
+    as->brk_start = as->brk = USER_HEAP_BASE;
+    as->regions[0].start = USER_HEAP_BASE;
+    as->regions[0].end = USER_HEAP_BASE;
+    as->regions[0].flags = PTE_PRESENT | PTE_WRITE | PTE_USER;
+    as->nregions = 1;
+    return as;
+}
+
+/* Рекурсивно освободить поддерево пользовательского окна */
+static void free_table(uint64_t *table, int level)
+{
+    for (int i = 0; i < 512; ++i)
+    {
+        uint64_t e = table[i];
+        if (!(e & PTE_PRESENT))
+            continue;
+        if (level == 0)
+        {
+            if (e & PTE_OWNED)
+                pmm_free_frame(e & PTE_ADDR_MASK);
+        }
+        else
+        {
+            free_table((uint64_t *)phys_to_virt(e & PTE_ADDR_MASK), level - 1);
+        }
+    }
+    pmm_free_frame((uint64_t)(uintptr_t)table);
+}
+
+void vmm_destroy_space(address_space_t *as)
+{
+    if (!as || as == &kernel_space)
+        return;
+    if (as == current_space)
+        vmm_switch(&kernel_space);
+
+    uint64_t e = as->pml4[USER_PML4_SLOT];
+    if (e & PTE_PRESENT)
+        free_table((uint64_t *)phys_to_virt(e & PTE_ADDR_MASK), 2);
+
+    pmm_free_frame((uint64_t)(uintptr_t)as->pml4);
+    free(as);
+}
+
+int vmm_map_page(address_space_t *as, uint64_t va, uint64_t pa, uint64_t flags)
+{
+    if (!as)
+        return -1;
+    uint64_t *pte = walk(as->pml4, va, 1);
+    if (!pte)
+        return -1;
+    uint64_t old = *pte;
+    *pte = (pa & PTE_ADDR_MASK) | flags | PTE_PRESENT;
+    if (old & PTE_PRESENT)
+    {
+        if (as == current_space)
+            invlpg(va);
+        else
+            as->tlb_stale = 1;
+    }
+    return 0;
+}
+
+int vmm_unmap_page(address_space_t *as, uint64_t va)
+{
+    if (!as)
+        return -1;
+    uint64_t *pte = walk(as->pml4, va, 0);
+    if (!pte || !(*pte & PTE_PRESENT))
+        return -1;
+    uint64_t e = *pte;
+    *pte = 0;
+    if (as == current_space)
+        invlpg(va);
+    else
+        as->tlb_stale = 1;
+    if (e & PTE_OWNED)
+    {
+        pmm_free_frame(e & PTE_ADDR_MASK);
+        as->committed_pages--;
+    }
+    return 0;
+}
+
+int vmm_kmap(uint64_t va, uint64_t pa)
+{
+    if (va < KERNEL_WIN_BASE)
+        return -1;
+    unsigned long irq = spin_lock_irqsave(&kwin_lock);
+    uint64_t *pte = walk(kernel_space.pml4, va, 1);
+    if (!pte)
+    {
+        spin_unlock_irqrestore(&kwin_lock, irq);
+        return -1;
+    }
+    uint64_t old = *pte;
+    *pte = (pa & PTE_ADDR_MASK) | PTE_PRESENT | PTE_WRITE | PTE_GLOBAL;
+    if (old & PTE_PRESENT)
+        invlpg(va); /* invlpg снимает и глобальную запись, независимо от PCID */
+    spin_unlock_irqrestore(&kwin_lock, irq);
+    return 0;
+}
+
+uint64_t vmm_kunmap(uint64_t va)
+{
+    if (va < KERNEL_WIN_BASE)
+        return 0;
+    unsigned long irq = spin_lock_irqsave(&kwin_lock);
+    uint64_t *pte = walk(kernel_space.pml4, va, 0);
+    uint64_t pa = 0;
+    if (pte && (*pte & PTE_PRESENT))
+    {
+        pa = *pte & PTE_ADDR_MASK;
+        *pte = 0;
+        invlpg(va);
+    }
+    spin_unlock_irqrestore(&kwin_lock, irq);
+    return pa;
+}
+
+int vmm_kmove(uint64_t from, uint64_t to)
+{
+    if (from < KERNEL_WIN_BASE || to < KERNEL_WIN_BASE)
+        return -1;
+    unsigned long irq = spin_lock_irqsave(&kwin_lock);
+    uint64_t *src = walk(kernel_space.pml4, from, 0);
+    uint64_t *dst = (src && (*src & PTE_PRESENT)) ? walk(kernel_space.pml4, to, 1) : NULL;
+    if (!dst || (*dst & PTE_PRESENT))
+    {
+        spin_unlock_irqrestore(&kwin_lock, irq);
+        return -1;
+    }
+    *dst = *src;
+    *src = 0;
+    invlpg(from); /* to не был отображён — старой записи в TLB нет */
+    spin_unlock_irqrestore(&kwin_lock, irq);
+    return 0;
+}
+
+uint64_t vmm_translate(address_space_t *as, uint64_t va)
+{
+    if (!as)
+        return 0;
+    uint64_t *pte = walk(as->pml4, va, 0);
+    if (!pte || !(*pte & PTE_PRESENT))
+        return 0;
+    return (*pte & PTE_ADDR_MASK) | (va & (PAGE_SIZE - 1));
+}
+
+uint64_t vmm_map_image(address_space_t *as, void *image, size_t size)
+{
+    if (!as || !image || size == 0)
+        return 0;
+
+    /* Буфер не обязан быть выровнен: отображаем покрывающие его страницы */
+    uint64_t start = page_down((uint64_t)(uintptr_t)image);
+    uint64_t end = page_up((uint64_t)(uintptr_t)image + size);
+    for (uint64_t pa = start; pa < end; pa += PAGE_SIZE)
+    {
+        if (vmm_map_page(as, USER_IMAGE_BASE + (pa - start), pa, PTE_WRITE | PTE_USER) != 0)
+            return 0;
+    }
+    return USER_IMAGE_BASE + ((uint64_t)(uintptr_t)image - start);
+}
+
+uint64_t vmm_map_image_cow(address_space_t *as, const void *image, size_t size, size_t bss)
+{
+    /* С середины страницы отобразились бы и данные перед образом */
+    if (!as || !image || size == 0 || ((uintptr_t)image & (PAGE_SIZE - 1)))
+        return 0;
+
+    uint64_t start = (uint64_t)(uintptr_t)image;
+    uint64_t file_end = (uint64_t)(uintptr_t)image + size;
+    uint64_t shared_end = page_down(file_end);
+
+    /* Целые страницы файла — общие, только чтение, копия при первой записи */
+    for (uint64_t pa = start; pa < shared_end; pa += PAGE_SIZE)
+    {
+        if (vmm_map_page(as, USER_IMAGE_BASE + (pa - start), pa, PTE_USER | PTE_COW) != 0)
+            return 0;
+    }
+
+    /* Хвост файла делит страницу с чужими данными: своя копия с нулями за
+       концом — отсюда начинается .bss */
+    uint64_t va = USER_IMAGE_BASE + (shared_end - start);
+    if (file_end > shared_end)
+    {
+        uint64_t frame = pmm_alloc_zeroed_frame();
+        if (!frame)
+            return 0;
+        memcpy(phys_to_virt(frame), (const void *)(uintptr_t)shared_end, (size_t)(file_end - shared_end));
+        if (vmm_map_page(as, va, frame, PTE_WRITE | PTE_USER | PTE_OWNED) != 0)
+        {
+            pmm_free_frame(frame);
+            return 0;
+        }
+        as->committed_pages++;
+        va += PAGE_SIZE;
+    }
+
+    /* Остаток .bss — нулевые страницы по первому касанию */
+    uint64_t bss_end = USER_IMAGE_BASE + (file_end - start) + bss;
+    if (bss_end > va && vmm_reserve(as, va, (size_t)(bss_end - va), PTE_WRITE | PTE_USER) != 0)
+        return 0;
+
+    return USER_IMAGE_BASE + ((uint64_t)(uintptr_t)image - start);
+}
+
+/* Запись в страницу copy-on-write: своя копия вместо общей */
+static int cow_fault(address_space_t *as, uint64_t addr)
+{
+    uint64_t *pte = walk(as->pml4, addr, 0);
+    if (!pte || (*pte & (PTE_PRESENT | PTE_COW)) != (PTE_PRESENT | PTE_COW))
+        return 0;
+
+    uint64_t frame = pmm_alloc_frame();
+    if (!frame)
+        return 0;
+    memcpy(phys_to_virt(frame), phys_to_virt(*pte & PTE_ADDR_MASK), PAGE_SIZE);
+    uint64_t flags = (*pte & ~(PTE_ADDR_MASK | PTE_COW | PTE_ACCESSED | PTE_DIRTY)) | PTE_WRITE | PTE_OWNED;
+    *pte = frame | flags;
+    invlpg(page_down(addr));
+    as->committed_pages++;
+    return 1;
+}
+
+int vmm_reserve(address_space_t *as, uint64_t start, size_t size, uint64_t flags)
+{
+    if (!as || as->nregions >= VMM_MAX_REGIONS || size == 0)
+        return -1;
+    vm_region_t *r = &as->regions[as->nregions++];
+    r->start = page_down(start);
+    r->end = page_up(start + size);
+    r->flags = flags | PTE_PRESENT;
+    return 0;
+}
+
+uint64_t vmm_sbrk(address_space_t *as, int64_t increment)
+{
+    if (!as || as == &kernel_space)
+        return (uint64_t)-1;
+
+    uint64_t old = as->brk;
+    uint64_t nb = old + (uint64_t)increment;
+    if (nb < as->brk_start || nb > as->brk_start + USER_HEAP_RESERVE)
+        return (uint64_t)-1;
+
+    /* При уменьшении сразу возвращаем страницы целиком выше нового break */
+    for (uint64_t va = page_up(nb); va < page_up(old); va += PAGE_SIZE)
+        vmm_unmap_page(as, va);
+
+    as->brk = nb;
+    as->regions[0].end = page_up(nb);
+    return old;
+}
+
+void vmm_switch(address_space_t *as)
+{
+    if (!as)
+        as = &kernel_space;
+    if (as == current_space)
+        return;
+    current_space = as;
+
+    uint64_t cr3 = (uint64_t)(uintptr_t)as->pml4;
+    if (pcid_enabled)
+    {
+        /* Без сброса TLB, если ASID не новый и таблицы не менялись в фоне */
+        int fresh = assign_pcid(as);
+        cr3 |= as->pcid;
+        if (!fresh && !as->tlb_stale)
+            cr3 |= CR3_NOFLUSH;
+    }
+    as->tlb_stale = 0;
+    write_cr3(cr3);
+}
+
+/* ------------------------- kernel stacks ------------------------- */
+
+static uint64_t kstack_used[KSTACK_SLOTS / 64]; /* 1 — слот занят */
+static uint8_t kstack_limit[KSTACK_SLOTS];      /* лимит слота в страницах */
+static uint8_t kstack_pages[KSTACK_SLOTS];      /* отображено страниц */
+static size_t kstack_hint = 0;
+static spinlock_t kstack_lock = SPINLOCK_INIT;
+
+/* Фреймы для #PF: обработчик не должен заходить в PMM, которого стек мог
+   коснуться посреди его же работы */
+static uint64_t kstack_reserve[KSTACK_RESERVE];
+static volatile size_t kstack_reserve_count = 0;
+
+static inline uint64_t kstack_top(size_t slot)
+{
+    return KWIN_KSTACK_BASE + (uint64_t)(slot + 1) * KSTACK_SLOT_SIZE;
+}
+
+static long kstack_slot_of(uint64_t addr)
+{
+    if (addr < KWIN_KSTACK_BASE || addr >= KWIN_KSTACK_END)
+        return -1;
+    return (long)((addr - KWIN_KSTACK_BASE) / KSTACK_SLOT_SIZE);
+}
+
+void vmm_kstack_refill(void)
+{
+    while (kstack_reserve_count < KSTACK_RESERVE)
+    {
+        uint64_t frame = pmm_alloc_zeroed_frame();
+        if (!frame)
+            return;
+        unsigned long flags = local_irq_save();
+        if (kstack_reserve_count < KSTACK_RESERVE)
+        {
+            kstack_reserve[kstack_reserve_count++] = frame;
+            frame = 0;
+        }
+        local_irq_restore(flags);
+        if (frame)
+            pmm_free_frame(frame);
+    }
+}
+
+void *vmm_kstack_alloc(size_t limit)
+{
+    limit = (size_t)page_up(limit);
+    if (limit == 0 || limit > KSTACK_MAX_LIMIT)
+        return NULL;
+
+    unsigned long irq = spin_lock_irqsave(&kstack_lock);
+    long slot = -1;
+    for (size_t n = 0; n < KSTACK_SLOTS; ++n)
+    {
+        size_t i = (kstack_hint + n) % KSTACK_SLOTS;
+        if (!(kstack_used[i / 64] & (1ULL << (i % 64))))
+        {
+            kstack_used[i / 64] |= 1ULL << (i % 64);
+            kstack_limit[i] = (uint8_t)(limit / PAGE_SIZE);
+            kstack_pages[i] = 1;
+            kstack_hint = i + 1;
+            slot = (long)i;
+            break;
+        }
+    }
+    spin_unlock_irqrestore(&kstack_lock, irq);
+    if (slot < 0)
+        return NULL;
+
+    /* Верхняя страница сразу: на ней начальный кадр задачи. Заодно vmm_kmap
+       строит таблицу страниц слота, и #PF остаётся только записать PTE. */
+    uint64_t top = kstack_top((size_t)slot);
+    uint64_t frame = pmm_alloc_zeroed_frame();
+    if (!frame || vmm_kmap(top - PAGE_SIZE, frame) != 0)
+    {
+        if (frame)
+            pmm_free_frame(frame);
+        irq = spin_lock_irqsave(&kstack_lock);
+        kstack_used[slot / 64] &= ~(1ULL << (slot % 64));
+        spin_unlock_irqrestore(&kstack_lock, irq);
+        return NULL;
+    }
+
+    vmm_kstack_refill();
+    return (void *)(uintptr_t)(top - limit);
+}
+
+void vmm_kstack_free(void *base)
+{
+    long slot = kstack_slot_of((uint64_t)(uintptr_t)base);
+    if (slot < 0)
+        return;
+
+    uint64_t top = kstack_top((size_t)slot);
+    uint64_t bottom = top - (uint64_t)kstack_limit[slot] * PAGE_SIZE;
+    for (uint64_t va = bottom; va < top; va += PAGE_SIZE)
+    {
+        uint64_t frame = vmm_kunmap(va);
+        if (frame)
+            pmm_free_frame(frame);
+    }
+
+    unsigned long irq = spin_lock_irqsave(&kstack_lock);
+    kstack_used[slot / 64] &= ~(1ULL << (slot % 64));
+    kstack_limit[slot] = 0;
+    kstack_pages[slot] = 0;
+    if ((size_t)slot < kstack_hint)
+        kstack_hint = (size_t)slot;
+    spin_unlock_irqrestore(&kstack_lock, irq);
+}
+
+size_t vmm_kstack_committed(const void *base)
+{
+    long slot = kstack_slot_of((uint64_t)(uintptr_t)base);
+    return slot < 0 ? 0 : (size_t)kstack_pages[slot] * PAGE_SIZE;
+}
+
+/* Рост стека из #PF (IST, IF=0). 1 — страница добавлена, 0 — адрес вне
+   лимита (guard) или резерв пуст. В PMM отсюда не заходим: исключение могло
+   прервать ту же задачу посреди выделения фрейма. */
+static int kstack_grow(uint64_t addr)
+{
+    long slot = kstack_slot_of(addr);
+    if (slot < 0 || !kstack_limit[slot])
+        return 0;
+    uint64_t top = kstack_top((size_t)slot);
+    if (addr < top - (uint64_t)kstack_limit[slot] * PAGE_SIZE)
+        return 0;
+
+    /* Таблица страниц слота есть с vmm_kstack_alloc: kwin_lock не нужен */
+    uint64_t *pte = walk(kernel_space.pml4, addr, 0);
+    if (!pte || !kstack_reserve_count)
+        return 0;
+    uint64_t frame = kstack_reserve[--kstack_reserve_count];
+    *pte = frame | PTE_PRESENT | PTE_WRITE | PTE_GLOBAL;
+    kstack_pages[slot]++;
+    return 1;
+}
+
+/* ------------------------- benchmark ------------------------- */
+
+#ifdef DEBUG
+#define BENCH_PAGES 64
+#define BENCH_ROUNDS 1000
+
+/* Пинг-понг между двумя пространствами, каждое касается BENCH_PAGES страниц.
+   force_flush=1 — CR3 пишется без бита NOFLUSH (как без PCID). */
+static uint64_t bench_round_trip(address_space_t *a, address_space_t *b, int force_flush)
+{
+    address_space_t *spaces[2] = {a, b};
+    volatile uint8_t sink = 0;
+
+    uint64_t t0 = rdtsc();
+    for (int r = 0; r < BENCH_ROUNDS; ++r)
+    {
+        address_space_t *as = spaces[r & 1];
+        if (force_flush)
+            as->tlb_stale = 1;
+        vmm_switch(as);
+        for (int p = 0; p < BENCH_PAGES; ++p)
+            sink += *(volatile uint8_t *)(uintptr_t)(USER_HEAP_BASE + (uint64_t)p * PAGE_SIZE);
+    }
+    uint64_t t1 = rdtsc();
+    (void)sink;
+    return (t1 - t0) / BENCH_ROUNDS;
+}
+
+void vmm_bench_switch(void)
+{
+    unsigned long flags = local_irq_save();
+
+    address_space_t *saved = current_space;
+    address_space_t *a = vmm_create_space();
+    address_space_t *b = vmm_create_space();
+    if (!a || !b)
+        goto out;
+
+    for (int p = 0; p < BENCH_PAGES; ++p)
+    {
+        uint64_t va = USER_HEAP_BASE + (uint64_t)p * PAGE_SIZE;
+        uint64_t fa = pmm_alloc_zeroed_frame();
+        uint64_t fb = pmm_alloc_zeroed_frame();
+        if (!fa || !fb)
+            goto out;
+        vmm_map_page(a, va, fa, PTE_WRITE | PTE_OWNED);
+        vmm_map_page(b, va, fb, PTE_WRITE | PTE_OWNED);
+    }
+
+    uint64_t with_flush = bench_round_trip(a, b, 1);
+    uint64_t with_pcid = bench_round_trip(a, b, 0);
+
+    kprintf_at(0, 20, WHITE, BLACK, "CR3 switch + 64 pages, cycles:\nflush: %-13lu", with_flush);
+    if (pcid_enabled)
+        kprintf_at(20, 21, WHITE, BLACK, "pcid: %lu", with_pcid);
+    else
+        kprintf_at(20, 21, WHITE, BLACK, "pcid: n/a");
+
+out:
+    vmm_switch(saved);
+    vmm_destroy_space(a);
+    vmm_destroy_space(b);
+    local_irq_restore(flags);
+}
+#endif // DEBUG
+
+/* ------------------------- page fault ------------------------- */
+
+static void __attribute__((noreturn)) fault_panic(const char *what, uint64_t addr, uint64_t err_code, uint64_t rip)
+{
+    /* Без kprintf_at: исключение могло прийти, пока его буфер занят */
+    char buf[32];
+    print_string_position(what, 20, 2, WHITE, RED);
+    ksnprintf(buf, sizeof(buf), "addr: 0x%016lX", addr);
+    print_string_position(buf, 20, 3, WHITE, RED);
+    ksnprintf(buf, sizeof(buf), "rip:  0x%016lX", rip);
+    print_string_position(buf, 20, 4, WHITE, RED);
+    ksnprintf(buf, sizeof(buf), "err:  0x%016lX", err_code);
+    print_string_position(buf, 20, 5, WHITE, RED);
+    asm volatile("cli; hlt");
+    __builtin_unreachable();
+}
+
+/* Ошибка задачи в её окне (чужой адрес, нет фреймов под demand-zero или
+   COW) — задача завершается, ядро живёт дальше. Обработчик сидит на
+   IST-стеке: задача-зомби ждёт здесь тика таймера и больше не запускается */
+static void __attribute__((noreturn)) fault_kill(task_t *t, uint64_t addr, uint64_t rip)
+{
+    char buf[80];
+    ksnprintf(buf, sizeof(buf), "pid %d killed: page fault at 0x%lX (rip 0x%lX)", t->pid, addr, rip);
+    print_string_position(buf, 20, 2, YELLOW, BLACK);
+    task_exit(-1);
+    for (;;)
+        asm volatile("sti; hlt");
+}
+
+static vm_region_t *find_region(address_space_t *as, uint64_t addr)
+{
+    for (int i = 0; i < as->nregions; ++i)
+    {
+        if (addr >= as->regions[i].start && addr < as->regions[i].end)
+            return &as->regions[i];
+    }
+    return NULL;
+}
+
+void page_fault_handler(uint64_t err_code, uint64_t rip)
+{
+    uint64_t addr = read_cr2();
+    address_space_t *as = current_space;
+
+    /* Demand-zero: страница региона ещё не выделена */
+    if (!(err_code & PF_PRESENT) && as && as != &kernel_space)
+    {
+        vm_region_t *r = find_region(as, addr);
+        if (r)
+        {
+            uint64_t frame = pmm_alloc_zeroed_frame();
+            if (frame && vmm_map_page(as, page_down(addr), frame, r->flags | PTE_OWNED) == 0)
+            {
+                as->committed_pages++;
+                return;
+            }
+            if (frame)
+                pmm_free_frame(frame);
+        }
+    }
+
+    /* Copy-on-write: запись (из программы или из syscall) в общую страницу образа */
+    if ((err_code & (PF_PRESENT | PF_WRITE)) == (PF_PRESENT | PF_WRITE) && as && as != &kernel_space &&
+        addr >= USER_BASE && cow_fault(as, addr))
+        return;
+
+    /* Стек ядра: рост до лимита, ниже — guard */
+    if (addr >= KWIN_KSTACK_BASE && addr < KWIN_KSTACK_END)
+    {
+        if (!(err_code & PF_PRESENT) && kstack_grow(addr))
+            return;
+        fault_panic("KERNEL STACK OVERFLOW", addr, err_code, rip);
+    }
+
+    /* Окно задачи: виновата задача (init не завершается — паника) */
+    task_t *t = get_current_task();
+    if (addr >= USER_BASE && addr < USER_END && as && as != &kernel_space && t && t->pid != 0)
+        fault_kill(t, addr, rip);
+
+    fault_panic("PAGE FAULT", addr, err_code, rip);
+}
+
+void double_fault_handler(uint64_t rip)
+{
+    /* Чаще всего — исключение, которому некуда положить кадр: CR2 подскажет */
+    fault_panic("DOUBLE FAULT", read_cr2(), 0, rip);
+}
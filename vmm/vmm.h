@@ -0,0 +1,140 @@
+#ifndef VMM_H
+#define VMM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "pmm.h"
+
+/* Флаги PTE (x86_64, 4-level paging) */
+#define PTE_PRESENT 0x001ULL
+#define PTE_WRITE 0x002ULL
+#define PTE_USER 0x004ULL
+#define PTE_ACCESSED 0x020ULL
+#define PTE_DIRTY 0x040ULL
+#define PTE_HUGE 0x080ULL
+#define PTE_GLOBAL 0x100ULL
+#define PTE_OWNED 0x200ULL /* AVL-бит: фрейм принадлежит адресному пространству и освобождается вместе с ним */
+#define PTE_COW 0x400ULL   /* AVL-бит: общая страница только для чтения, при записи копируется */
+#define PTE_ADDR_MASK 0x000FFFFFFFFFF000ULL
+
+/* Первый 1 GiB — identity map ядра, phys == virt */
+#ifndef phys_to_virt
+#define phys_to_virt(p) ((void *)(uintptr_t)(p))
+#endif
+
+/* Пользовательское окно: PML4[1], своё для каждой задачи.
+   Остальные слоты PML4 разделяются всеми адресными пространствами. */
+#define USER_PML4_SLOT 1
+#define USER_BASE 0x0000008000000000ULL
+#define USER_END (USER_BASE + (1ULL << 39))              /* конец PML4[1]: 512 GiB */
+#define USER_IMAGE_BASE USER_BASE                        /* образ программы */
+#define USER_HEAP_BASE (USER_BASE + 0x40000000ULL)       /* +1 GiB: heap (sbrk) */
+#define USER_HEAP_RESERVE (256ULL * 1024 * 1024)         /* резерв heap, коммитится по первому касанию */
+
+/* Окно ядра: PML4[256], общее для всех адресных пространств (PDPT создаётся
+   в vmm_init до первой задачи). Страницы глобальные, identity не требуется. */
+#define KERNEL_WIN_PML4_SLOT 256
+#ifndef KERNEL_WIN_BASE /* хост-сборка (tools/allocbench) кладёт окно в userland */
+#define KERNEL_WIN_BASE 0xFFFF800000000000ULL
+#endif
+#define KWIN_LARGE_BASE KERNEL_WIN_BASE               /* крупные объекты kmalloc */
+#define KWIN_LARGE_SIZE (64ULL * 1024 * 1024 * 1024) /* 64 GiB виртуального резерва */
+
+/* Стеки ядра задач: слот на стек, сверху вниз — закоммиченные страницы, ещё
+   не тронутые страницы до лимита и неотображаемый guard. Растут по #PF. */
+#define KWIN_KSTACK_BASE (KWIN_LARGE_BASE + KWIN_LARGE_SIZE)
+#define KSTACK_SLOT_SIZE (64 * 1024)
+#define KSTACK_SLOTS 4096
+#define KSTACK_MAX_LIMIT (KSTACK_SLOT_SIZE - PAGE_SIZE) /* минимум одна guard-страница */
+#define KWIN_KSTACK_END (KWIN_KSTACK_BASE + (uint64_t)KSTACK_SLOTS * KSTACK_SLOT_SIZE)
+#define KSTACK_RESERVE 16 /* фреймы для роста стека прямо из #PF */
+
+#define VMM_MAX_REGIONS 8
+
+/* PCID: 12 бит в CR3; 0 зарезервирован за ядром */
+#define PCID_COUNT 4096
+#define CR3_NOFLUSH (1ULL << 63)
+
+/* Регион, страницы которого выделяются нулевыми при первом обращении */
+typedef struct vm_region
+{
+    uint64_t start;
+    uint64_t end;
+    uint64_t flags; /* PTE-флаги для новых страниц */
+} vm_region_t;
+
+typedef struct address_space
+{
+    uint64_t *pml4; /* физический адрес == виртуальный (identity) */
+    vm_region_t regions[VMM_MAX_REGIONS];
+    int nregions;
+    uint64_t brk_start; /* heap: [brk_start, brk) */
+    uint64_t brk;
+    size_t committed_pages; /* страницы, выделенные по page fault */
+    uint16_t pcid;          /* ASID, действителен только в поколении pcid_gen */
+    uint64_t pcid_gen;
+    int tlb_stale; /* таблицы менялись, пока пространство не было активно */
+} address_space_t;
+
+void vmm_init(void);
+address_space_t *vmm_kernel_space(void);
+address_space_t *vmm_current_space(void);
+
+/* Новое адресное пространство: ядро общее, пользовательское окно пустое */
+address_space_t *vmm_create_space(void);
+void vmm_destroy_space(address_space_t *as);
+
+/* Отобразить/снять одну страницу 4 KiB. Возвращают 0 при успехе. */
+int vmm_map_page(address_space_t *as, uint64_t va, uint64_t pa, uint64_t flags);
+int vmm_unmap_page(address_space_t *as, uint64_t va);
+/* Физический адрес для va или 0, если не отображено */
+uint64_t vmm_translate(address_space_t *as, uint64_t va);
+
+/* Страницы окна ядра: видны во всех пространствах, TLB сбрасывается сразу.
+   vmm_kmap возвращает 0 при успехе, vmm_kunmap — снятый фрейм или 0. */
+int vmm_kmap(uint64_t va, uint64_t pa);
+uint64_t vmm_kunmap(uint64_t va);
+/* Перенести отображение страницы окна from -> to без копирования данных.
+   to должен быть свободен. 0 при успехе. */
+int vmm_kmove(uint64_t from, uint64_t to);
+
+/* Стек ядра с лимитом limit байт (до KSTACK_MAX_LIMIT). Отображена только
+   верхняя страница, остальные добавляет #PF. Возвращает нижнюю границу:
+   вершина стека — base + limit. */
+void *vmm_kstack_alloc(size_t limit);
+void vmm_kstack_free(void *base);
+/* Отображённая часть стека в байтах */
+size_t vmm_kstack_committed(const void *base);
+/* Пополнить резерв фреймов для #PF (вне обработчика прерываний) */
+void vmm_kstack_refill(void);
+
+/* Отобразить уже существующий буфер ядра (identity) в USER_IMAGE_BASE.
+   Возвращает виртуальный адрес, соответствующий началу image (или 0). */
+uint64_t vmm_map_image(address_space_t *as, void *image, size_t size);
+
+/* Образ программы прямо из памяти файла (identity), без копирования:
+   целые страницы — общие copy-on-write, страница с концом файла — своя
+   копия, дальше bss байт нулей по требованию. image — с начала страницы.
+   Адрес начала image или 0. */
+uint64_t vmm_map_image_cow(address_space_t *as, const void *image, size_t size, size_t bss);
+
+/* Зарезервировать регион с выделением страниц по требованию */
+int vmm_reserve(address_space_t *as, uint64_t start, size_t size, uint64_t flags);
+
+/* Сдвинуть heap break. Возвращает старое значение или (uint64_t)-1 */
+uint64_t vmm_sbrk(address_space_t *as, int64_t increment);
+
+/* Переключить CR3 (вызывается планировщиком) */
+void vmm_switch(address_space_t *as);
+
+#ifdef DEBUG
+/* Микробенчмарк: стоимость переключения CR3 + TLB-промахов с PCID и без */
+void vmm_bench_switch(void);
+#endif
+
+/* Обработчик #PF (вызывается из interrupt/isr14.asm) */
+void page_fault_handler(uint64_t err_code, uint64_t rip);
+/* Обработчик #DF (interrupt/isr8.asm): на своём стеке IST, только паника */
+void double_fault_handler(uint64_t rip);
+
+#endif // VMM_H